@@ -0,0 +1,129 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_BIDI_DICT_H_
+#define _WORDDICT_WORDDICT_BIDI_DICT_H_
+
+#include <string_view>
+
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Pair of dictionaries over the same keys: the forward one and the
+ *          one over reversed keys, which answers suffix queries by the
+ *          walk from the end of the key.
+ *
+ *  If values are packed, the reverse dictionary uses the packed values of
+ *  the forward one.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class bidi_dict final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<TChar, TBase, TValue>;
+
+    bidi_dict() {}
+
+    void clear()
+    {
+        m_reverse.clear();
+        m_forward.clear();
+    }
+
+    bool empty() const { return m_forward.empty(); }
+
+    value_type find(const std::basic_string_view<char_type>& key) const { return m_forward.find(key); }
+
+    /*
+     *  \brief  Reports keys which are prefixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, value).
+     */
+    template<typename TCallback>
+    void common_prefix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        m_forward.common_prefix_search(key, std::forward<TCallback>(callback));
+    }
+
+    /*
+     *  \brief  Reports keys which are suffixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, value).
+     */
+    template<typename TCallback>
+    void common_suffix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        base_type idx = m_reverse.root();
+        for (size_type i = 0; (i < key.length()) && ! m_reverse.empty(); ++i) {
+            if (! m_reverse.follow(key[key.length() - 1 - i], idx)) {
+                return;
+            }
+            if (m_reverse.has_value(idx)) {
+                callback(i + 1, m_reverse.value(idx));
+            }
+        }
+    }
+
+    /*
+     *  \brief  Returns true if some key starts with the prefix.
+     */
+    bool has_prefix(const std::basic_string_view<char_type>& prefix) const
+    {
+        base_type idx = m_forward.root();
+        return ! m_forward.empty() && m_forward.follow(prefix, idx);
+    }
+
+    /*
+     *  \brief  Returns true if some key ends with the suffix.
+     */
+    bool has_suffix(const std::basic_string_view<char_type>& suffix) const
+    {
+        base_type idx = m_reverse.root();
+        if (m_reverse.empty()) {
+            return false;
+        }
+        for (size_type i = suffix.length(); i > 0; --i) {
+            if (! m_reverse.follow(suffix[i - 1], idx)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const dict_type& forward() const { return m_forward; }
+
+    const dict_type& reverse() const { return m_reverse; }
+
+private:
+    dict_type m_forward;
+    dict_type m_reverse;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_BIDI_DICT_H_ */
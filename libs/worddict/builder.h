@@ -19,44 +19,763 @@
 #ifndef _WORDDICT_WORDDICT_BUILDER_H_
 #define _WORDDICT_WORDDICT_BUILDER_H_
 
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "worddict/bidi_dict.h"
+#include "worddict/fst_dict.h"
+#include "worddict/guide.h"
+#include "worddict/payload_dict.h"
+#include "worddict/scanner.h"
+#include "worddict/union_dict.h"
 #include "worddict/worddict.h"
 #include "worddict/details/dawg_builder.h"
 #include "worddict/details/dawg_dict.h"
+#include "worddict/details/dict_builder.h"
 #include "worddict/details/dictraits.h"
+#include "worddict/details/guide_builder.h"
+#include "worddict/details/label_codec.h"
+#include "worddict/details/packed_values.h"
+#include "worddict/details/payload_heap.h"
+#include "worddict/details/scanner_builder.h"
+#include "worddict/details/xor_filter.h"
 
 namespace wstux {
 namespace wd {
 
-template<typename TChar>
+/*
+ *  \brief  Stage of the build reported by the progress callback.
+ */
+enum class build_stage
+{
+    inserting,  ///< Keys are inserted, their total is unknown.
+    minimizing, ///< The DAWG is finished.
+    packing,    ///< States of the DAWG are arranged in the double-array.
+    done
+};
+
+/*
+ *  \brief  Report of the last build: where the time goes and how well the
+ *          DAWG is minimized and the double-array is packed. The bidirectional
+ *          build reports the sums over both dictionaries.
+ */
+struct build_report final
+{
+    uint64_t keys_count = 0;               ///< Inserted keys, including repeated ones.
+    uint64_t states_count = 0;             ///< States of the minimal DAWG.
+    uint64_t transitions_count = 0;        ///< Transitions of the minimal DAWG.
+    uint64_t merged_states_count = 0;
+    uint64_t merged_transitions_count = 0;
+    uint64_t merging_states_count = 0;
+    uint64_t register_lookups = 0;         ///< Lookups of states in the register of minimal states.
+    uint64_t register_hits = 0;            ///< States merged with the equal registered ones.
+    uint64_t units_count = 0;              ///< Units of the double-array.
+    uint64_t unused_units_count = 0;       ///< Units of the double-array left empty.
+    uint64_t peak_rss_bytes = 0;           ///< Peak resident memory of the process.
+
+    /// Inserting of keys (from the first key to the build), which includes
+    /// the incremental minimization of the DAWG.
+    double insert_seconds = 0;
+    double minimize_seconds = 0;           ///< Finishing of the DAWG.
+    double pack_seconds = 0;               ///< Arranging of the double-array.
+    double extras_seconds = 0;             ///< Values, the profile, the guide and the scanner.
+
+    double keys_per_second() const { return (insert_seconds > 0) ? (keys_count / insert_seconds) : 0; }
+
+    double register_hit_rate() const
+    {
+        return (register_lookups != 0) ? (double(register_hits) / register_lookups) : 0;
+    }
+
+    /*
+     *  \brief  Returns the share of the used units of the double-array.
+     */
+    double packing_density() const
+    {
+        return (units_count != 0) ? (1.0 - double(unused_units_count) / units_count) : 0;
+    }
+};
+
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
 class builder final
 {
 public:
-    using base_type  = typename details::traits<TChar>::base_type;
-    using char_type  = typename details::traits<TChar>::char_type;
-    using size_type  = typename details::traits<TChar>::size_type;
-    using uchar_type = typename details::traits<TChar>::uchar_type;
-    using value_type = typename details::traits<TChar>::value_type;
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type         = word_dict<char_type, base_type, value_type>;
+    using bidi_dict_type    = bidi_dict<char_type, base_type, value_type>;
+    using guide_type        = guide<char_type, base_type, value_type>;
+    using scanner_type      = scanner<char_type, base_type, value_type>;
+    using union_dict_type   = union_dict<char_type, base_type, value_type>;
+    using payload_dict_type = payload_dict<char_type, base_type, value_type>;
+    using fst_dict_type     = fst_dict<char_type, base_type, value_type>;
+
+    /// Keys and values of the source dictionary of the union in any order.
+    using key_set = std::vector<std::pair<std::basic_string<char_type>, value_type>>;
 
-    builder() {}
+    /// Frequencies of the keys, e.g. counted over a sample of the query log.
+    using profile_type = std::map<std::basic_string<char_type>, size_type>;
 
-    bool build(word_dict<char_type>& /*dict*/)
+    /// Callable as progress(stage, done, total); total is 0 if it is unknown.
+    using progress_type = std::function<void(build_stage, size_type, size_type)>;
+
+    /*
+     *  \param  coding - coding of the values of the built dictionary. Values
+     *          are stored in the packed array regardless of the coding if
+     *          some of them do not fit the leaf unit. The builder of
+     *          value_coding::transitions builds fst_dict only.
+     *  \param  norm - normalization of inserted keys, which is applied to
+     *          queried keys by the built dictionary and the scanner.
+     */
+    explicit builder(const value_coding coding = value_coding::inline_units,
+                     const normalization norm = normalization::none)
+        : m_builder(norm)
+        , m_coding(coding)
+        , m_normalization(norm)
     {
-        details::dawg_dict<char_type> inter;
-        if (! m_builder.finish(inter)) {
+        m_builder.set_output_pushing(coding == value_coding::transitions);
+    }
+
+    bool build(dict_type& dict) { return build(dict, nullptr, nullptr, nullptr); }
+
+    /*
+     *  \brief  Builds the dictionary with the layout optimized for the
+     *          profile: states on the paths of frequent keys are packed
+     *          contiguously near the root.
+     */
+    bool build(dict_type& dict, const profile_type& profile) { return build(dict, &profile, nullptr, nullptr); }
+
+    /*
+     *  \brief  Builds the dictionary and the Aho-Corasick automaton over
+     *          the same keys.
+     */
+    bool build(dict_type& dict, scanner_type& scanner) { return build(dict, nullptr, &scanner, nullptr); }
+
+    /*
+     *  \brief  Builds the dictionary and the guide of its transitions,
+     *          which is used to enumerate keys, e.g. by the pattern.
+     */
+    bool build(dict_type& dict, guide_type& guide) { return build(dict, nullptr, nullptr, &guide); }
+
+    /*
+     *  \brief  Builds the forward dictionary and the dictionary over the
+     *          reversed keys.
+     */
+    bool build(bidi_dict_type& dict)
+    {
+        if (m_coding == value_coding::transitions) {
             return false;
         }
+        begin_report();
+        dawg_type inter;
+        if (! finish(m_builder, inter)) {
+            return false;
+        }
+
+        // Keys are reversed by characters, so the codes of characters
+        // split into several labels are kept.
+        std::vector<std::pair<std::basic_string<char_type>, value_type>> keys;
+        for_each_key(inter, [&keys](const std::vector<label_type>& labels, const value_type value) {
+            keys.emplace_back(std::basic_string<char_type>(), value);
+            details::label_codec<TChar, TBase, TValue>::decode(labels.data(), labels.size(), keys.back().first);
+            std::reverse(keys.back().first.begin(), keys.back().first.end());
+        });
+        std::sort(keys.begin(), keys.end(), [](const auto& lhs, const auto& rhs) {
+            return std::lexicographical_compare(lhs.first.cbegin(), lhs.first.cend(), rhs.first.cbegin(), rhs.first.cend(),
+                                                [](const char_type l, const char_type r) {
+                                                    return static_cast<uchar_type>(l) < static_cast<uchar_type>(r);
+                                                });
+        });
 
-        m_builder.clear();
-        return false;
+        details::dawg_builder<char_type, base_type, value_type> reverse_builder;
+        for (const std::pair<std::basic_string<char_type>, value_type>& key : keys) {
+            if (! reverse_builder.insert(key.first, key.second)) {
+                return false;
+            }
+        }
+        keys.clear();
+
+        dawg_type reverse_inter;
+        if (! finish(reverse_builder, reverse_inter)) {
+            return false;
+        }
+
+        dict.clear();
+        if (! build(dict.m_forward, inter, nullptr, nullptr, nullptr, nullptr)) {
+            return false;
+        }
+        if (! build(dict.m_reverse, reverse_inter, nullptr, nullptr, nullptr, &dict.m_forward.m_values)) {
+            return false;
+        }
+        end_report();
+        return true;
+    }
+
+    /*
+     *  \brief  Builds the union of source dictionaries: the source i is the
+     *          set i. Keys inserted before are not used, so the builder must
+     *          have no inserted keys.
+     *  \return false if there are more than union_dict_type::max_sources
+     *          sets, some key is empty, some value is negative or some key
+     *          is repeated in the set.
+     */
+    bool build(union_dict_type& dict, const std::vector<key_set>& sets)
+    {
+        dict.clear();
+        if ((sets.size() > union_dict_type::max_sources) || (m_builder.keys_count() != 0)) {
+            return false;
+        }
+
+        // Keys are merged after the normalization, so keys of sources which
+        // are equal after it share the entry.
+        struct source_key final
+        {
+            std::basic_string<char_type> key;
+            size_type source;
+            value_type value;
+        };
+        const uchar_type* p_fold = details::fold_table<uchar_type>(m_normalization);
+        std::vector<source_key> keys;
+        for (size_type source = 0; source < sets.size(); ++source) {
+            for (const std::pair<std::basic_string<char_type>, value_type>& key : sets[source]) {
+                if (key.first.empty() || (key.second < 0)) {
+                    return false;
+                }
+                keys.push_back({key.first, source, key.second});
+                if (p_fold != nullptr) {
+                    for (char_type& ch : keys.back().key) {
+                        ch = static_cast<char_type>(p_fold[static_cast<uchar_type>(ch)]);
+                    }
+                }
+            }
+        }
+        std::sort(keys.begin(), keys.end(), [](const source_key& lhs, const source_key& rhs) {
+            if (lhs.key == rhs.key) {
+                return lhs.source < rhs.source;
+            }
+            return std::lexicographical_compare(lhs.key.cbegin(), lhs.key.cend(), rhs.key.cbegin(), rhs.key.cend(),
+                                                [](const char_type l, const char_type r) {
+                                                    return static_cast<uchar_type>(l) < static_cast<uchar_type>(r);
+                                                });
+        });
+
+        std::map<std::pair<uint64_t, std::vector<value_type>>, value_type> entries;
+        std::pair<uint64_t, std::vector<value_type>> entry;
+        for (size_type first = 0, end = 0; first < keys.size(); first = end) {
+            entry.first = 0;
+            entry.second.clear();
+            for (end = first; (end < keys.size()) && (keys[end].key == keys[first].key); ++end) {
+                const uint64_t bit = uint64_t(1) << keys[end].source;
+                if (entry.first & bit) {
+                    m_builder.clear();
+                    dict.clear();
+                    return false;
+                }
+                entry.first |= bit;
+                entry.second.push_back(keys[end].value);
+            }
+
+            const auto it = entries.emplace(entry, static_cast<value_type>(entries.size()));
+            if (it.second) {
+                dict.m_sources.push_back(entry.first);
+                dict.m_offsets.push_back(dict.m_values.size());
+                dict.m_values.insert(dict.m_values.end(), entry.second.cbegin(), entry.second.cend());
+            }
+            if (! insert(keys[first].key, it.first->second)) {
+                m_builder.clear();
+                dict.clear();
+                return false;
+            }
+        }
+        keys.clear();
+
+        if (! build(dict.m_dict)) {
+            dict.clear();
+            return false;
+        }
+        dict.m_sources_count = sets.size();
+        return true;
+    }
+
+    /*
+     *  \brief  Builds the dictionary of keys inserted by insert_payload().
+     *  \return false if some key was inserted by insert().
+     */
+    bool build(payload_dict_type& dict)
+    {
+        dict.clear();
+        const bool is_payload_keys = (m_builder.keys_count() == m_payload_keys_count);
+        m_payload_keys_count = 0;
+        if (! is_payload_keys) {
+            m_builder.clear();
+        }
+        if (! is_payload_keys || ! build(dict.m_dict) || ! m_payloads.finish(dict.m_heap)) {
+            m_payloads.clear();
+            dict.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Builds the transducer of keys inserted into the builder of
+     *          value_coding::transitions.
+     */
+    bool build(fst_dict_type& dict)
+    {
+        dict.clear();
+        if (m_coding != value_coding::transitions) {
+            return false;
+        }
+
+        begin_report();
+        dawg_type inter;
+        std::vector<value_type> outputs;
+        if (! finish(m_builder, inter) || ! build(dict.m_dict, inter, nullptr, nullptr, nullptr, nullptr, &outputs)) {
+            dict.clear();
+            return false;
+        }
+        dict.assign(std::move(outputs));
+        end_report();
+        return true;
     }
 
     template<typename ...TArgs>
-    bool insert(TArgs&& ...args) { return m_builder.insert(std::forward<TArgs>(args)...); }
+    bool insert(TArgs&& ...args)
+    {
+        if (m_insert_start == clock::time_point()) {
+            m_insert_start = clock::now();
+        }
+        const bool rc = m_builder.insert(std::forward<TArgs>(args)...);
+        if (m_progress && (m_builder.keys_count() >= m_progress_keys)) {
+            m_progress(build_stage::inserting, m_builder.keys_count(), 0);
+            m_progress_keys = m_builder.keys_count() + progress_step;
+        }
+        return rc;
+    }
+
+    /*
+     *  \brief  Inserts the key with the byte payload. Equal payloads are
+     *          stored once. Keys are inserted like by insert().
+     */
+    bool insert_payload(const std::basic_string_view<char_type>& key, const std::string_view& payload)
+    {
+        const size_t idx = m_payloads.index(payload);
+        if ((idx > size_t(std::numeric_limits<value_type>::max())) || ! insert(key, static_cast<value_type>(idx))) {
+            return false;
+        }
+        m_payloads.insert(payload);
+        ++m_payload_keys_count;
+        return true;
+    }
+
+    /*
+     *  \brief  Reports the minimal widths of the unit and the value of the
+     *          dictionary of the keys in any order: the value takes 4 bytes
+     *          if all values fit int32_t, the unit takes 4 bytes if the keys
+     *          are laid out in 32-bit units. Keys are laid out by a builder
+     *          with the coding and the normalization of this one, which
+     *          keeps its inserted keys.
+     *  \return false if the keys can not be built in any units.
+     */
+    bool fit_widths(const key_set& keys, size_type& unit_bytes, size_type& value_bytes) const
+    {
+        value_bytes = sizeof(int32_t);
+        if constexpr (sizeof(value_type) > sizeof(int32_t)) {
+            for (const std::pair<std::basic_string<char_type>, value_type>& key : keys) {
+                if ((key.second < std::numeric_limits<int32_t>::min()) || (key.second > std::numeric_limits<int32_t>::max())) {
+                    value_bytes = sizeof(value_type);
+                    break;
+                }
+            }
+        }
+
+        const uchar_type* p_fold = details::fold_table<uchar_type>(m_normalization);
+        key_set sorted = keys;
+        if (p_fold != nullptr) {
+            for (std::pair<std::basic_string<char_type>, value_type>& key : sorted) {
+                for (char_type& ch : key.first) {
+                    ch = static_cast<char_type>(p_fold[static_cast<uchar_type>(ch)]);
+                }
+            }
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+            return std::lexicographical_compare(lhs.first.cbegin(), lhs.first.cend(), rhs.first.cbegin(), rhs.first.cend(),
+                                                [](const char_type l, const char_type r) {
+                                                    return static_cast<uchar_type>(l) < static_cast<uchar_type>(r);
+                                                });
+        });
+
+        if (is_built<uint32_t>(sorted)) {
+            unit_bytes = sizeof(uint32_t);
+            return true;
+        }
+        unit_bytes = sizeof(uint64_t);
+        return is_built<uint64_t>(sorted);
+    }
+
+    /*
+     *  \brief  Returns the report of the last successful build.
+     */
+    const build_report& report() const { return m_report; }
+
+    /*
+     *  \brief  Sets the callback which is called after every few thousands
+     *          of inserted keys and arranged states, and between stages.
+     */
+    void set_progress(progress_type progress) { m_progress = std::move(progress); }
+
+    /*
+     *  \brief  Sets the depth of the dispatch table of built dictionaries
+     *          (see word_dict::build_dispatch), 0 for no table. The build
+     *          fails, if the depth is not supported.
+     */
+    void set_dispatch_depth(const size_type depth) { m_dispatch_depth = depth; }
+
+    /*
+     *  \brief  Sets the false positive rate of the filter of keys of built
+     *          dictionaries, 0 for no filter. The filter is checked before
+     *          the walk of the key, so most misses read a few bytes of the
+     *          filter instead of units. Rates below 2^-16 are rounded up
+     *          to 2^-16. The filter is saved into the file of the
+     *          dictionary, so loaded and mapped dictionaries keep it.
+     */
+    void set_filter_rate(const double rate) { m_filter_rate = rate; }
+
+    /*
+     *  \brief  Appends the block of the dead state to built dictionaries,
+     *          so word_dict::find() follows missed transitions to the dead
+     *          state by the mask of the label check instead of the branch
+     *          and checks the key once after the walk. The block takes
+     *          2^L units (L - bits count of the label).
+     */
+    void set_branch_free(const bool enabled) { m_is_branch_free = enabled; }
 
 private:
-    details::dawg_builder<char_type> m_builder;
+    using clock     = std::chrono::steady_clock;
+    using dawg_type = details::dawg_dict<char_type, base_type, value_type>;
+    using unit      = details::dict_unit<char_type, base_type, value_type>;
+
+    static constexpr size_type progress_step = size_type(1) << 16;
+
+    bool build(dict_type& dict, const profile_type* p_profile, scanner_type* p_scanner, guide_type* p_guide)
+    {
+        if (m_coding == value_coding::transitions) {
+            return false;
+        }
+        begin_report();
+        dawg_type inter;
+        if (! finish(m_builder, inter)) {
+            return false;
+        }
+        if (! build(dict, inter, p_profile, p_scanner, p_guide, nullptr)) {
+            return false;
+        }
+        end_report();
+        return true;
+    }
+
+    /*
+     *  \brief  Returns true if the sorted keys are built in units of TUnit.
+     */
+    template<typename TUnit>
+    bool is_built(const key_set& keys) const
+    {
+        // Values coded by transitions are laid out like ones in units.
+        builder<char_type, TUnit, value_type> trial(
+            (m_coding == value_coding::transitions) ? value_coding::inline_units : m_coding, m_normalization);
+        for (const std::pair<std::basic_string<char_type>, value_type>& key : keys) {
+            if (! trial.insert(key.first, key.second)) {
+                return false;
+            }
+        }
+        word_dict<char_type, TUnit, value_type> dict;
+        return trial.build(dict);
+    }
+
+    /*
+     *  \brief  Finishes the DAWG and reports its minimization.
+     */
+    bool finish(details::dawg_builder<char_type, base_type, value_type>& dawg_builder, dawg_type& inter)
+    {
+        if (m_progress) {
+            m_progress(build_stage::minimizing, 0, 1);
+        }
+        const clock::time_point start = clock::now();
+        if (! dawg_builder.finish(inter)) {
+            return false;
+        }
+        dawg_builder.clear();
+
+        m_report.minimize_seconds += seconds_since(start);
+        m_report.states_count += inter.states_count();
+        m_report.transitions_count += inter.transitions_count();
+        m_report.merged_states_count += inter.merged_states_count();
+        m_report.merged_transitions_count += inter.merged_transitions_count();
+        m_report.merging_states_count += inter.merging_states_count();
+        m_report.register_lookups += inter.register_lookups();
+        m_report.register_hits += inter.register_hits();
+        return true;
+    }
+
+    void begin_report()
+    {
+        m_report = build_report();
+        m_report.keys_count = m_builder.keys_count();
+        if (m_insert_start != clock::time_point()) {
+            m_report.insert_seconds = seconds_since(m_insert_start);
+        }
+        m_insert_start = clock::time_point();
+        m_progress_keys = 0;
+    }
+
+    void end_report()
+    {
+        struct rusage usage = {};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            // Kilobytes on Linux.
+            m_report.peak_rss_bytes = uint64_t(usage.ru_maxrss) * 1024;
+        }
+        if (m_progress) {
+            m_progress(build_stage::done, 1, 1);
+        }
+    }
+
+    static double seconds_since(const clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    /*
+     *  \param  p_shared_values - packed values of the dictionary over the
+     *          same keys, which are used instead of the own ones, or nullptr.
+     *  \param  p_outputs - output array of outputs of units, or nullptr.
+     */
+    bool build(dict_type& dict, const dawg_type& inter, const profile_type* p_profile, scanner_type* p_scanner,
+               guide_type* p_guide, const details::packed_values<value_type>* p_shared_values,
+               std::vector<value_type>* p_outputs = nullptr)
+    {
+        clock::time_point start = clock::now();
+        std::vector<value_type> values;
+        value_coding coding;
+        const bool is_packed = collect_values(inter, values, coding);
+
+        std::vector<size_type> heat;
+        if (p_profile != nullptr) {
+            heat = make_heat(inter, *p_profile);
+        }
+        m_report.extras_seconds += seconds_since(start);
+
+        details::dict_builder<char_type, base_type, value_type> dict_builder(inter);
+        dict_builder.set_dead_state(m_is_branch_free);
+        if (m_progress) {
+            dict_builder.set_progress([this](const size_type done, const size_type total) {
+                m_progress(build_stage::packing, done, total);
+            });
+        }
+        start = clock::now();
+        std::vector<base_type> units;
+        if (! dict_builder.build(units, (p_profile != nullptr) ? &heat : nullptr, is_packed ? &values : nullptr,
+                                 p_outputs)) {
+            return false;
+        }
+        m_report.pack_seconds += seconds_since(start);
+        m_report.units_count += units.size();
+        m_report.unused_units_count += dict_builder.unused_units_count();
+
+        start = clock::now();
+        if (p_scanner != nullptr) {
+            std::vector<typename scanner_type::node_type> nodes;
+            std::vector<label_type> labels;
+            if (! details::scanner_builder<char_type, base_type, value_type>(inter).build(nodes, labels)) {
+                return false;
+            }
+            p_scanner->assign(std::move(nodes), std::move(labels), m_normalization);
+        }
+        if (p_guide != nullptr) {
+            std::vector<std::pair<label_type, label_type>> guide_units;
+            std::vector<base_type> counts;
+            if (! details::guide_builder<char_type, base_type, value_type>(inter, units).build(guide_units, counts)) {
+                return false;
+            }
+            p_guide->assign(std::move(guide_units), std::move(counts));
+        }
+        details::packed_values<value_type> packed;
+        if ((p_shared_values != nullptr) && ! p_shared_values->empty()) {
+            packed.attach(p_shared_values->data(), p_shared_values->words_count());
+        } else {
+            packed = pack(values, coding, is_packed);
+        }
+        dict.assign(std::move(units), dict_builder.hot_units_count(), std::move(packed), m_normalization);
+        dict.set_dawg_counts(inter.states_count(), inter.transitions_count());
+        dict.set_dead_state(dict_builder.dead_state());
+        if (! dict.build_dispatch(m_dispatch_depth)) {
+            return false;
+        }
+        if (m_filter_rate > 0.0) {
+            std::vector<uint64_t> hashes;
+            for_each_key(inter, [&hashes](const std::vector<label_type>& labels, const value_type) {
+                details::key_hasher hasher;
+                for (const label_type label : labels) {
+                    hasher.add(label);
+                }
+                hashes.push_back(hasher.value());
+            });
+            if (! dict.m_filter.build(hashes, details::xor_filter::fingerprint_bits(m_filter_rate))) {
+                return false;
+            }
+        }
+        m_report.extras_seconds += seconds_since(start);
+        return true;
+    }
+
+    /*
+     *  \brief  Collects sorted distinct values of the DAWG, if they must be
+     *          stored in the packed array: the packed coding is requested
+     *          or some value does not fit the leaf unit.
+     *  \return false if values are stored in the leaf units.
+     */
+    bool collect_values(const dawg_type& dawg,
+                        std::vector<value_type>& values, value_coding& coding) const
+    {
+        values.clear();
+        // Leaves of the transducer keep rests of values, which are small.
+        coding = (m_coding == value_coding::transitions) ? value_coding::inline_units : m_coding;
+        for (base_type idx = 0; idx < dawg.size(); ++idx) {
+            if (dawg.is_leaf(idx)) {
+                values.emplace_back(dawg.value(idx));
+            }
+        }
+
+        if (coding == value_coding::inline_units) {
+            const bool is_fit = std::all_of(values.cbegin(), values.cend(),
+                                            [](const value_type v) { return (uint64_t)v <= unit::value_max; });
+            if (is_fit) {
+                values.clear();
+                return false;
+            }
+            coding = value_coding::frame_of_reference;
+        }
+
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        return true;
+    }
+
+    static details::packed_values<value_type> pack(const std::vector<value_type>& values,
+                                                   const value_coding coding, const bool is_packed)
+    {
+        details::packed_values<value_type> packed;
+        if (is_packed) {
+            packed.assign(values, coding);
+        }
+        return packed;
+    }
+
+    /*
+     *  \brief  Calls fn(labels, value) for every key of the DAWG in order.
+     */
+    template<typename TFunc>
+    static void for_each_key(const dawg_type& dawg, TFunc&& fn)
+    {
+        using dawg_base_type = typename dawg_type::base_type;
+
+        std::vector<dawg_base_type> path;
+        std::vector<label_type> labels;
+        dawg_base_type idx = dawg.child(dawg.root());
+        while (true) {
+            if (idx == 0) {
+                if (path.empty()) {
+                    break;
+                }
+                idx = dawg.sibling(path.back());
+                path.pop_back();
+                labels.pop_back();
+            } else if (dawg.is_leaf(idx)) {
+                fn(labels, dawg.value(idx));
+                idx = dawg.sibling(idx);
+            } else {
+                path.push_back(idx);
+                labels.push_back(dawg.label(idx));
+                idx = dawg.child(idx);
+            }
+        }
+    }
+
+    /*
+     *  \brief  Counts the heat of the DAWG states by the profile. Keys of
+     *          the profile are normalized like inserted keys, so queries
+     *          logged before the normalization heat the states of their
+     *          normalized keys.
+     */
+    std::vector<size_type> make_heat(const dawg_type& dawg, const profile_type& profile) const
+    {
+        using dawg_base_type = typename dawg_type::base_type;
+
+        const uchar_type* p_fold = details::fold_table<uchar_type>(m_normalization);
+        std::vector<size_type> heat(dawg.size(), 0);
+        std::vector<label_type> labels;
+        std::basic_string<char_type> key;
+        for (const std::pair<const std::basic_string<char_type>, size_type>& p : profile) {
+            key = p.first;
+            if (p_fold != nullptr) {
+                for (char_type& ch : key) {
+                    ch = static_cast<char_type>(p_fold[static_cast<uchar_type>(ch)]);
+                }
+            }
+            details::label_codec<TChar, TBase, TValue>::encode(key.data(), key.size(), labels);
+
+            dawg_base_type idx = dawg.root();
+            for (size_type i = 0; ; ++i) {
+                const dawg_base_type state = dawg.child(idx);
+                heat[state] += p.second;
+                if (i == labels.size()) {
+                    break;
+                }
+
+                dawg_base_type trans = state;
+                while ((trans != 0) && (dawg.label(trans) != labels[i])) {
+                    trans = dawg.sibling(trans);
+                }
+                if ((trans == 0) || dawg.is_leaf(trans)) {
+                    break;
+                }
+                idx = trans;
+            }
+        }
+        return heat;
+    }
+
+private:
+    details::dawg_builder<char_type, base_type, value_type> m_builder;
+    value_coding m_coding;
+    normalization m_normalization;
+    size_type m_dispatch_depth = 0;
+    double m_filter_rate = 0.0;
+    bool m_is_branch_free = false;
+
+    /// Payloads of keys inserted by insert_payload().
+    details::payload_heap_builder m_payloads;
+    size_type m_payload_keys_count = 0;
+
+    build_report m_report;
+    progress_type m_progress;
+    clock::time_point m_insert_start;
+    size_type m_progress_keys = 0;
 };
 
 } // namespace wd
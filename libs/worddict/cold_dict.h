@@ -0,0 +1,492 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_COLD_DICT_H_
+#define _WORDDICT_WORDDICT_COLD_DICT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "worddict/worddict.h"
+#include "worddict/details/block_cache.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dict_file.h"
+#include "worddict/details/dict_unit.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+#include "worddict/details/lz_codec.h"
+#include "worddict/details/mem_region.h"
+#include "worddict/details/packed_values.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Block-compressed read-only image of the dictionary for rarely
+ *          used dictionaries: the double-array is split into blocks of
+ *          units, which are compressed by the LZ codec and decompressed on
+ *          demand into the LRU cache, when lookups reach them.
+ *
+ *  Larger blocks are compressed better, smaller ones waste less time and
+ *  cache on the units which are not used by lookups; the hit rate of the
+ *  cache is reported by cache_hits() and cache_misses().
+ *
+ *  The image consists of the header, offsets of compressed blocks, CRC32C
+ *  checksums of decompressed blocks, compressed blocks and packed values.
+ *  Units of the block are split into planes of bytes before compression.
+ *  The checksum of the block is checked when the block is decompressed.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class cold_dict final
+{
+    using codec = details::label_codec<TChar, TBase, TValue>;
+    using unit  = details::dict_unit<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<char_type, base_type, value_type>;
+
+    static constexpr size_type default_block_units = 4096;
+    static constexpr size_type default_cache_blocks = 256;
+
+    /*
+     *  \param  cache_blocks - count of decompressed blocks kept in memory.
+     */
+    explicit cold_dict(const size_type cache_blocks = default_cache_blocks)
+        : m_cache_blocks(cache_blocks)
+        , m_p_cache(new cache_type(cache_blocks))
+    {}
+
+    cold_dict(const cold_dict&) = delete;
+    cold_dict& operator=(const cold_dict&) = delete;
+
+    uint64_t cache_hits() const { return m_p_cache->hits(); }
+
+    uint64_t cache_misses() const { return m_p_cache->misses(); }
+
+    void clear()
+    {
+        m_image.clear();
+        m_region.release();
+        m_p_header = nullptr;
+        m_values.clear();
+        m_p_fold = nullptr;
+        m_p_cache.reset(new cache_type(m_cache_blocks));
+    }
+
+    /*
+     *  \brief  Compresses the dictionary.
+     *  \param  block_units - count of units of the block, the power of 2.
+     */
+    bool compress(const dict_type& dict, const size_type block_units = default_block_units)
+    {
+        clear();
+        if (dict.empty() || (block_units == 0) || ((block_units & (block_units - 1)) != 0)) {
+            return false;
+        }
+
+        header_type header = {};
+        header.magic = header_type::magic_value;
+        header.version = header_type::version_value;
+        header.traits = details::file_header::make_traits<TChar, TBase, TValue>();
+        header.units_count = dict.size();
+        header.values_words = dict.m_values.words_count();
+        header.normalization = (uint64_t)dict.key_normalization();
+        header.block_units = block_units;
+        header.blocks_count = (dict.size() + block_units - 1) / block_units;
+        header.offsets_offset = sizeof(header_type);
+        header.checksums_offset = header.offsets_offset + (header.blocks_count + 1) * sizeof(uint64_t);
+        header.data_offset = details::file_header::align(header.checksums_offset + header.blocks_count * sizeof(uint32_t));
+
+        std::vector<uint64_t> offsets(1, 0);
+        std::vector<uint32_t> checksums;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> planes(block_units * sizeof(base_type));
+        for (uint64_t block = 0; block < header.blocks_count; ++block) {
+            const base_type* p_units = dict.data() + block * block_units;
+            const size_type count = std::min<size_type>(block_units, dict.size() - block * block_units);
+            shuffle(p_units, count, planes.data());
+            details::lz_codec::compress(planes.data(), count * sizeof(base_type), data);
+            offsets.push_back(data.size());
+            checksums.push_back(details::crc32c(p_units, count * sizeof(base_type)));
+        }
+        header.values_offset = details::file_header::align(header.data_offset + data.size());
+        header.image_size = header.values_offset + header.values_words * sizeof(uint64_t);
+        header.header_crc = header_crc(header);
+
+        std::vector<uint64_t> image(header.image_size / sizeof(uint64_t), 0);
+        char* p_image = reinterpret_cast<char*>(image.data());
+        std::memcpy(p_image, &header, sizeof(header));
+        std::memcpy(p_image + header.offsets_offset, offsets.data(), offsets.size() * sizeof(uint64_t));
+        std::memcpy(p_image + header.checksums_offset, checksums.data(), checksums.size() * sizeof(uint32_t));
+        std::memcpy(p_image + header.data_offset, data.data(), data.size());
+        if (header.values_words != 0) {
+            std::memcpy(p_image + header.values_offset, dict.m_values.data(), header.values_words * sizeof(uint64_t));
+        }
+        return attach(std::move(image));
+    }
+
+    bool empty() const { return m_p_header == nullptr; }
+
+    /*
+     *  \brief  Returns the size of the compressed image in bytes.
+     */
+    size_type image_size() const { return empty() ? 0 : m_p_header->image_size; }
+
+    size_type block_units() const { return empty() ? 0 : m_p_header->block_units; }
+
+    size_type blocks_count() const { return empty() ? 0 : m_p_header->blocks_count; }
+
+    /*
+     *  \brief  Returns the count of units of the double-array.
+     */
+    size_type size() const { return empty() ? 0 : m_p_header->units_count; }
+
+    bool load(const std::string& path)
+    {
+        clear();
+
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in.tellg();
+        if ((file_size < sizeof(header_type)) || ((file_size % sizeof(uint64_t)) != 0)) {
+            return false;
+        }
+        std::vector<uint64_t> image(file_size / sizeof(uint64_t), 0);
+        if (! in.seekg(0) || ! in.read(reinterpret_cast<char*>(image.data()), file_size)) {
+            return false;
+        }
+        return attach(std::move(image));
+    }
+
+    /*
+     *  \brief  Maps the image read-only, so compressed blocks are read from
+     *          the file by pages on demand.
+     */
+    bool map(const std::string& path, const page_policy policy = page_policy::regular)
+    {
+        clear();
+
+        details::mem_region region;
+        if (! region.map(path, policy) || ! attach(region.data(), region.size())) {
+            clear();
+            return false;
+        }
+        m_region = std::move(region);
+        return true;
+    }
+
+    bool save(const std::string& path) const
+    {
+        if (empty()) {
+            return false;
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(m_p_header), m_p_header->image_size);
+        return out.good();
+    }
+
+    /*
+     *  \brief  Reports keys which are prefixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, value).
+     */
+    template<typename TCallback>
+    void common_prefix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        if (empty()) {
+            return;
+        }
+
+        reader r(*this);
+        base_type idx = 0;
+        for (size_type i = 0; i < key.length(); ++i) {
+            if (! follow(r, key[i], idx)) {
+                return;
+            }
+            const value_type v = unit::has_leaf(r[idx]) ? value(r, idx) : -1;
+            if (v != -1) {
+                callback(i + 1, v);
+            }
+        }
+    }
+
+    value_type find(const std::basic_string_view<char_type>& key) const
+    {
+        if (empty()) {
+            return -1;
+        }
+
+        reader r(*this);
+        base_type idx = 0;
+        for (size_type i = 0; i < key.length(); ++i) {
+            if (! follow(r, key[i], idx)) {
+                return -1;
+            }
+        }
+        return unit::has_leaf(r[idx]) ? value(r, idx) : -1;
+    }
+
+private:
+    struct header_type final
+    {
+        static constexpr uint64_t magic_value = 0x444C4F4344524F57ULL; // "WORDCOLD"
+        static constexpr uint64_t version_value = 1;
+
+        uint64_t magic;
+        uint64_t version;
+        uint64_t traits;
+        uint64_t units_count;
+        uint64_t values_words;
+        uint64_t normalization;
+        uint64_t block_units;
+        uint64_t blocks_count;
+        uint64_t offsets_offset;
+        uint64_t checksums_offset;
+        uint64_t data_offset;
+        uint64_t values_offset;
+        uint64_t image_size;
+        uint64_t header_crc;
+    };
+
+    using block_type = std::vector<base_type>;
+    using cache_type = details::block_cache<block_type>;
+
+    /*
+     *  \brief  Reader of units, which keeps the last used block, so the
+     *          cache is looked up only when the lookup moves to other block.
+     */
+    class reader final
+    {
+    public:
+        explicit reader(const cold_dict& dict)
+            : m_dict(dict)
+            , m_shift(bit_width(dict.m_p_header->block_units) - 1)
+            , m_mask(dict.m_p_header->block_units - 1)
+        {}
+
+        base_type operator[](const base_type idx)
+        {
+            const uint64_t block = uint64_t(idx) >> m_shift;
+            if ((m_p_block == nullptr) || (block != m_block)) {
+                m_p_block = m_dict.block(block);
+                m_block = block;
+            }
+            return (*m_p_block)[idx & m_mask];
+        }
+
+    private:
+        static uint64_t bit_width(uint64_t value)
+        {
+            uint64_t width = 0;
+            for (; value != 0; value >>= 1) {
+                ++width;
+            }
+            return width;
+        }
+
+    private:
+        const cold_dict& m_dict;
+        const uint64_t m_shift;
+        const uint64_t m_mask;
+
+        uint64_t m_block = 0;
+        typename cache_type::block_ptr m_p_block;
+    };
+
+    bool attach(std::vector<uint64_t>&& image)
+    {
+        m_image = std::move(image);
+        if (! attach(m_image.data(), m_image.size() * sizeof(uint64_t))) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool attach(const void* p_image, const uint64_t image_size)
+    {
+        const header_type* p_header = static_cast<const header_type*>(p_image);
+        if ((image_size < sizeof(header_type)) || ! is_valid_header(*p_header, image_size)) {
+            return false;
+        }
+
+        const char* p_data = static_cast<const char*>(p_image);
+        const uint64_t* p_offsets = reinterpret_cast<const uint64_t*>(p_data + p_header->offsets_offset);
+        for (uint64_t block = 0; block < p_header->blocks_count; ++block) {
+            if (p_offsets[block] > p_offsets[block + 1]) {
+                return false;
+            }
+        }
+        if ((p_offsets[0] != 0) || (p_header->data_offset + p_offsets[p_header->blocks_count] > p_header->values_offset)) {
+            return false;
+        }
+
+        details::packed_values<value_type> values;
+        if ((p_header->values_words != 0)
+            && ! values.attach(reinterpret_cast<const uint64_t*>(p_data + p_header->values_offset), p_header->values_words)) {
+            return false;
+        }
+
+        m_p_header = p_header;
+        m_p_offsets = p_offsets;
+        m_p_checksums = reinterpret_cast<const uint32_t*>(p_data + p_header->checksums_offset);
+        m_p_data = p_data + p_header->data_offset;
+        m_values = std::move(values);
+        m_p_fold = details::fold_table<uchar_type>(static_cast<normalization>(p_header->normalization));
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the decompressed block. The corrupted block is read as
+     *          the block of empty units, so lookups through it fail.
+     */
+    typename cache_type::block_ptr block(const uint64_t block) const
+    {
+        return m_p_cache->get(block, [this, block]() {
+            std::shared_ptr<block_type> p_block(new block_type(m_p_header->block_units, 0));
+            const size_type count = std::min<size_type>(m_p_header->block_units,
+                                                        m_p_header->units_count - block * m_p_header->block_units);
+            std::vector<uint8_t> planes(count * sizeof(base_type));
+            if (details::lz_codec::decompress(m_p_data + m_p_offsets[block], m_p_offsets[block + 1] - m_p_offsets[block],
+                                              planes.data(), planes.size())) {
+                unshuffle(planes.data(), count, p_block->data());
+            }
+            if (details::crc32c(p_block->data(), count * sizeof(base_type)) != m_p_checksums[block]) {
+                std::fill(p_block->begin(), p_block->end(), 0);
+            }
+            return typename cache_type::block_ptr(std::move(p_block));
+        });
+    }
+
+    /*
+     *  \brief  Splits units into planes of bytes: labels, flags and bytes of
+     *          offsets of neighbouring units are alike, so planes are
+     *          compressed much better than units.
+     */
+    static void shuffle(const base_type* p_units, const size_type count, uint8_t* p_planes)
+    {
+        const uint8_t* p_bytes = reinterpret_cast<const uint8_t*>(p_units);
+        for (size_type i = 0; i < count; ++i) {
+            for (size_type b = 0; b < sizeof(base_type); ++b) {
+                p_planes[b * count + i] = p_bytes[i * sizeof(base_type) + b];
+            }
+        }
+    }
+
+    static void unshuffle(const uint8_t* p_planes, const size_type count, base_type* p_units)
+    {
+        uint8_t* p_bytes = reinterpret_cast<uint8_t*>(p_units);
+        for (size_type i = 0; i < count; ++i) {
+            for (size_type b = 0; b < sizeof(base_type); ++b) {
+                p_bytes[i * sizeof(base_type) + b] = p_planes[b * count + i];
+            }
+        }
+    }
+
+    bool follow(reader& r, char_type ch, base_type& idx) const
+    {
+        if (m_p_fold != nullptr) {
+            ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+        }
+
+        label_type labels[codec::max_labels];
+        const size_type count = codec::encode(ch, labels);
+        base_type next_idx = idx;
+        for (size_type i = 0; i < count; ++i) {
+            next_idx = next_idx ^ unit::offset(r[next_idx]) ^ labels[i];
+            if ((next_idx >= m_p_header->units_count) || (unit::label(r[next_idx]) != labels[i])) {
+                return false;
+            }
+        }
+        idx = next_idx;
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the value of the unit or -1, if the leaf unit is in
+     *          the corrupted block.
+     */
+    value_type value(reader& r, const base_type idx) const
+    {
+        const base_type leaf_idx = idx ^ unit::offset(r[idx]);
+        if (leaf_idx >= m_p_header->units_count) {
+            return -1;
+        }
+        const base_type leaf = r[leaf_idx];
+        if ((leaf & unit::is_leaf_bit) == 0) {
+            return -1;
+        }
+        return m_values.empty() ? unit::value(leaf) : m_values[unit::value(leaf)];
+    }
+
+    static uint64_t header_crc(const header_type& header)
+    {
+        return details::crc32c(&header, offsetof(header_type, header_crc));
+    }
+
+    static bool is_valid_header(const header_type& h, const uint64_t image_size)
+    {
+        if ((h.magic != header_type::magic_value) || (h.version != header_type::version_value)
+            || (h.traits != details::file_header::make_traits<TChar, TBase, TValue>()) || (h.header_crc != header_crc(h))) {
+            return false;
+        }
+        if ((h.units_count == 0) || (h.block_units == 0) || ((h.block_units & (h.block_units - 1)) != 0)
+            || (h.blocks_count != (h.units_count + h.block_units - 1) / h.block_units)
+            || ((h.values_words != 0) && (h.values_words < 3)) || (h.normalization > (uint64_t)normalization::case_fold)) {
+            return false;
+        }
+        return (h.offsets_offset == sizeof(header_type))
+            && (h.checksums_offset == h.offsets_offset + (h.blocks_count + 1) * sizeof(uint64_t))
+            && (h.data_offset == details::file_header::align(h.checksums_offset + h.blocks_count * sizeof(uint32_t)))
+            && (h.values_offset >= h.data_offset) && ((h.values_offset % sizeof(uint64_t)) == 0)
+            && (h.image_size == h.values_offset + h.values_words * sizeof(uint64_t)) && (image_size >= h.image_size);
+    }
+
+private:
+    std::vector<uint64_t> m_image;
+    details::mem_region m_region;
+
+    const header_type* m_p_header = nullptr;
+    const uint64_t* m_p_offsets = nullptr;
+    const uint32_t* m_p_checksums = nullptr;
+    const char* m_p_data = nullptr;
+
+    details::packed_values<value_type> m_values;
+    const uchar_type* m_p_fold = nullptr;
+
+    size_type m_cache_blocks;
+    std::unique_ptr<cache_type> m_p_cache;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_COLD_DICT_H_ */
@@ -0,0 +1,135 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_BLOCK_CACHE_H_
+#define _WORDDICT_WORDDICT_BLOCK_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Sharded LRU cache of decompressed blocks.
+ *
+ *  Blocks are distributed over shards by their ids, every shard has its
+ *  own lock and LRU list, so concurrent readers of different blocks rarely
+ *  contend. Blocks are shared by pointers, so the evicted block stays
+ *  valid for the readers which hold it.
+ */
+template<typename TBlock>
+class block_cache final
+{
+public:
+    using block_ptr = std::shared_ptr<const TBlock>;
+
+    /*
+     *  \param  capacity - maximum count of cached blocks.
+     */
+    explicit block_cache(const size_t capacity, const size_t shards_count = 8)
+    {
+        const size_t count = (capacity < shards_count) ? 1 : shards_count;
+        for (size_t i = 0; i < count; ++i) {
+            m_shards.emplace_back(new shard());
+            m_shards.back()->capacity = (capacity + count - 1) / count;
+        }
+    }
+
+    block_cache(const block_cache&) = delete;
+    block_cache& operator=(const block_cache&) = delete;
+
+    void clear()
+    {
+        for (const std::unique_ptr<shard>& s : m_shards) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->lru.clear();
+            s->index.clear();
+        }
+        m_hits.store(0, std::memory_order_relaxed);
+        m_misses.store(0, std::memory_order_relaxed);
+    }
+
+    /*
+     *  \brief  Returns the cached block or the block made by the loader,
+     *          which is called out of the lock.
+     */
+    template<typename TLoader>
+    block_ptr get(const uint64_t id, TLoader&& loader)
+    {
+        shard& s = *m_shards[id % m_shards.size()];
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            const typename index_type::iterator it = s.index.find(id);
+            if (it != s.index.end()) {
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second->second;
+            }
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+
+        block_ptr p_block = loader();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.index.find(id) == s.index.end()) {
+            s.lru.emplace_front(id, p_block);
+            s.index.emplace(id, s.lru.begin());
+            if (s.lru.size() > s.capacity) {
+                s.index.erase(s.lru.back().first);
+                s.lru.pop_back();
+            }
+        }
+        return p_block;
+    }
+
+    uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+
+    uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+private:
+    using list_type  = std::list<std::pair<uint64_t, block_ptr>>;
+    using index_type = std::unordered_map<uint64_t, typename list_type::iterator>;
+
+    struct shard final
+    {
+        std::mutex mutex;
+        list_type lru;
+        index_type index;
+        size_t capacity = 0;
+    };
+
+private:
+    std::vector<std::unique_ptr<shard>> m_shards;
+
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_BLOCK_CACHE_H_ */
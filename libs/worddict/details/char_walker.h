@@ -0,0 +1,99 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_CHAR_WALKER_H_
+#define _WORDDICT_WORDDICT_CHAR_WALKER_H_
+
+#include "worddict/guide.h"
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Enumerates transitions of the dictionary by characters: the
+ *          labels of the multi-byte codes are assembled into characters.
+ */
+template<typename TChar, typename TBase, typename TValue>
+class char_walker final
+{
+    using codec = label_codec<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+
+    using dict_type  = word_dict<TChar, TBase, TValue>;
+    using guide_type = guide<TChar, TBase, TValue>;
+
+    char_walker(const dict_type& dict, const guide_type& guide)
+        : m_dict(dict)
+        , m_guide(guide)
+    {}
+
+    /*
+     *  \brief  Calls fn(next_idx, ch) for every character of transitions of
+     *          the unit in the order of characters.
+     *  \return true if some call returns true.
+     */
+    template<typename TFunc>
+    bool for_each_char(const base_type idx, TFunc&& fn) const
+    {
+        label_type labels[codec::max_labels];
+        return for_each_char(idx, labels, 0, fn);
+    }
+
+private:
+    template<typename TFunc>
+    bool for_each_char(const base_type idx, label_type* p_labels, const size_type count, TFunc& fn) const
+    {
+        bool result = false;
+        label_type label = m_guide.child(idx);
+        while (label != 0) {
+            base_type child_idx = idx;
+            m_dict.follow_label(label, child_idx);
+
+            p_labels[count] = label;
+            if (count + 1 < codec::length(p_labels[0])) {
+                result |= for_each_char(child_idx, p_labels, count + 1, fn);
+            } else {
+                char_type ch;
+                codec::decode(p_labels, ch);
+                result |= fn(child_idx, static_cast<uchar_type>(ch));
+            }
+            label = m_guide.sibling(child_idx);
+        }
+        return result;
+    }
+
+private:
+    const dict_type& m_dict;
+    const guide_type& m_guide;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_CHAR_WALKER_H_ */
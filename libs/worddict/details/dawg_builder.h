@@ -19,44 +19,126 @@
 #ifndef _WORDDICT_WORDDICT_DAWG_BUILDER_H_
 #define _WORDDICT_WORDDICT_DAWG_BUILDER_H_
 
-#include <cstring>
+#include <algorithm>
+#include <limits>
 #include <map>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "worddict/details/case_folding.h"
 #include "worddict/details/dawg_dict.h"
 #include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
 
 namespace wstux {
 namespace wd {
 namespace details {
 
-template<typename TChar>
+/*
+ *  \brief  Incremental builder of the minimal DAWG.
+ *
+ *  Keys must be inserted in the ascending order. The builder keeps the
+ *  'unfixed' path of the last inserted key and minimizes the states of the
+ *  path when the next key diverges from it (Daciuk's algorithm).
+ *
+ *  If keys are normalized, the order of normalized keys differs from the
+ *  order of inserted ones, so normalized keys are collected and inserted
+ *  in the ascending order by finish(). Of keys equal after normalization
+ *  the last inserted one is kept, like of equal inserted keys.
+ *
+ *  If outputs are pushed (see set_output_pushing), values are not kept in
+ *  leaves only, but are split into outputs of transitions (Mihov, Maurel,
+ *  "Direct Construction of Minimal Acyclic Subsequential Transducers"):
+ *  the output of the transition is the minimum of values of keys after it
+ *  less outputs of the previous transitions, and the leaf keeps the rest
+ *  of the value. Keys with distinct values share states then, if their
+ *  values differ in outputs of the common prefix only, e.g. monotone ids.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
 class dawg_builder final
 {
 public:
-    using base_type  = typename details::traits<TChar>::base_type;
-    using char_type  = typename details::traits<TChar>::char_type;
-    using uchar_type = typename details::traits<TChar>::uchar_type;
-    using size_type  = typename details::traits<TChar>::size_type;
-    using value_type = typename details::traits<TChar>::value_type;
+    using base_type  = typename details::traits<TChar, TBase, TValue>::dawg_base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    explicit dawg_builder(const normalization norm = normalization::none)
+        : m_p_fold(fold_table<uchar_type>(norm))
+    {}
+
+    void clear()
+    {
+        m_normalized.clear();
+        m_hash_table.clear();
+        m_units.clear();
+        m_unused_units.clear();
+        m_unfixed_units.clear();
+        m_dict.clear();
+        m_states_count = 1;
+        m_merged_transitions_count = 0;
+        m_merging_states_count = 0;
+        m_register_lookups = 0;
+        m_register_hits = 0;
+        m_keys_count = 0;
+    }
 
-    dawg_builder() {}
+    bool finish(dawg_dict<TChar, TBase, TValue>& dict)
+    {
+        if (! insert_normalized()) {
+            return false;
+        }
+        if (m_hash_table.empty()) {
+            init();
+        }
+
+        fix_units(0);
+        m_dict.m_base_pool[0] = m_units[0].base();
+        m_dict.m_label_pool[0] = m_units[0].label;
+        if (m_is_pushing) {
+            m_dict.m_output_pool[0] = 0;
+        }
+
+        m_dict.m_states_count = m_states_count;
+        m_dict.m_merged_transitions_count = m_merged_transitions_count;
+        m_dict.m_merged_states_count = m_dict.transitions_count() + 1 - m_states_count;
+        m_dict.m_merging_states_count = m_merging_states_count;
+        m_dict.m_register_lookups = m_register_lookups;
+        m_dict.m_register_hits = m_register_hits;
+        std::swap(dict, m_dict);
+
+        clear();
+        return true;
+    }
 
-    void clear() {}
+    /*
+     *  \brief  Returns the count of keys inserted since the last finish(),
+     *          including repeated ones.
+     */
+    size_type keys_count() const { return m_keys_count; }
 
-    bool finish(dawg_dict<TChar>& /*dict*/) { return false; }
+    /*
+     *  \brief  Enables pushing of values to outputs of transitions. Must be
+     *          set before keys are inserted.
+     */
+    void set_output_pushing(const bool is_pushing) { m_is_pushing = is_pushing; }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const char_type* p_key, const TValue value)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const char_type* p_key, const TArg value)
     {
         if ((p_key == nullptr) || (*p_key == '\0') || value < 0) {
           return false;
         }
-        return insert_impl(p_key, std::strlen(p_key), value);
+        return insert_impl(p_key, std::basic_string_view<char_type>(p_key).size(), value);
       }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const char_type* p_key, const size_type len, const TValue value)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const char_type* p_key, const size_type len, const TArg value)
     {
         if (p_key == NULL || len == 0 || value < 0) {
             return false;
@@ -67,28 +149,28 @@ public:
         return insert_impl(p_key, len, value);
     }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const std::basic_string<char_type>& word, const TValue value)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const std::basic_string<char_type>& word, const TArg value)
     {
         if (word.empty() || value < 0) {
             return false;
         }
-        return insert_impl(word.data(), word.size(), value);
+        return insert(word.data(), word.size(), value);
     }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const std::basic_string_view<char_type>& word, const TValue value)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const std::basic_string_view<char_type>& word, const TArg value)
     {
         if (word.empty() || value < 0) {
             return false;
         }
-        return insert_impl(word.data(), word.size(), value);
+        return insert(word.data(), word.size(), value);
     }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const std::map<std::basic_string<char_type>, TValue>& words)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const std::map<std::basic_string<char_type>, TArg>& words)
     {
-        for (const std::pair<const std::basic_string<char_type>, TValue>& w : words) {
+        for (const std::pair<const std::basic_string<char_type>, TArg>& w : words) {
             if (! insert(w.first, w.second)) {
                 return false;
             }
@@ -96,10 +178,10 @@ public:
         return true;
     }
 
-    template<typename TValue, typename = typename std::enable_if<std::is_convertible<TValue, value_type>::value>::type>
-    bool insert(const std::map<std::basic_string_view<char_type>, TValue>& words)
+    template<typename TArg, typename = typename std::enable_if<std::is_convertible<TArg, value_type>::value>::type>
+    bool insert(const std::map<std::basic_string_view<char_type>, TArg>& words)
     {
-        for (const std::pair<const std::basic_string_view<char_type>, TValue>& w : words) {
+        for (const std::pair<const std::basic_string_view<char_type>, TArg>& w : words) {
             if (! insert(w.first, w.second)) {
                 return false;
             }
@@ -108,10 +190,377 @@ public:
     }
 
 private:
-    bool insert_impl(const char_type* /*p_key*/, const size_type /*len*/, const value_type /*value*/)
+    using codec = label_codec<TChar, TBase, TValue>;
+
+    /*
+     *  \brief  Unit of the unfixed part of the DAWG.
+     */
+    struct unit final
+    {
+        base_type base() const
+        {
+            if (label == '\0') {
+                return (child << 1) | (has_sibling ? 1 : 0);
+            }
+            return (child << 2) | (is_state ? 2 : 0) | (has_sibling ? 1 : 0);
+        }
+
+        base_type child = 0;
+        base_type sibling = 0;
+        value_type output = 0;
+        label_type label = 0;
+        bool is_state = false;
+        bool has_sibling = false;
+    };
+
+    static constexpr size_type initial_hash_table_size = 1 << 8;
+
+private:
+    base_type allocate_transition()
     {
-        return false;
+        m_dict.m_base_pool.emplace_back(0);
+        m_dict.m_label_pool.emplace_back(0);
+        m_dict.m_flag_pool.emplace_back(false);
+        if (m_is_pushing) {
+            m_dict.m_output_pool.emplace_back(0);
+        }
+        return m_dict.m_base_pool.size() - 1;
+    }
+
+    base_type allocate_unit()
+    {
+        base_type idx = 0;
+        if (m_unused_units.empty()) {
+            idx = m_units.size();
+            m_units.emplace_back();
+        } else {
+            idx = m_unused_units.back();
+            m_unused_units.pop_back();
+            m_units[idx] = unit();
+        }
+        return idx;
     }
+
+    bool are_equal(const base_type unit_idx, base_type trans_idx) const
+    {
+        // Compares the numbers of transitions.
+        for (base_type i = m_units[unit_idx].sibling; i != 0; i = m_units[i].sibling) {
+            if ((m_dict.m_base_pool[trans_idx] & 1) == 0) {
+                return false;
+            }
+            ++trans_idx;
+        }
+        if ((m_dict.m_base_pool[trans_idx] & 1) == 1) {
+            return false;
+        }
+
+        // Compares out-transitions.
+        for (base_type i = unit_idx; i != 0; i = m_units[i].sibling, --trans_idx) {
+            if ((m_units[i].base() != m_dict.m_base_pool[trans_idx])
+                || (m_units[i].label != m_dict.m_label_pool[trans_idx])
+                || (m_units[i].output != m_dict.output(trans_idx))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void expand_hash_table()
+    {
+        const size_type hash_table_size = m_hash_table.size() << 1;
+        m_hash_table.clear();
+        m_hash_table.resize(hash_table_size, 0);
+
+        // Builds a new hash table.
+        for (size_type i = 1; i < m_dict.m_base_pool.size(); ++i) {
+            const base_type idx = i;
+            if ((m_dict.m_label_pool[idx] == '\0') || (m_dict.m_base_pool[idx] & 2)) {
+                base_type hash_id;
+                find_transition(idx, hash_id);
+                m_hash_table[hash_id] = idx;
+            }
+        }
+    }
+
+    base_type find_transition(const base_type idx, base_type& hash_id) const
+    {
+        hash_id = hash_transition(idx) % m_hash_table.size();
+        while (m_hash_table[hash_id] != 0) {
+            hash_id = (hash_id + 1) % m_hash_table.size();
+        }
+        return 0;
+    }
+
+    base_type find_unit(const base_type unit_idx, base_type& hash_id) const
+    {
+        hash_id = hash_unit(unit_idx) % m_hash_table.size();
+        for (;; hash_id = (hash_id + 1) % m_hash_table.size()) {
+            const base_type trans_idx = m_hash_table[hash_id];
+            if (trans_idx == 0) {
+                break;
+            }
+            if (are_equal(unit_idx, trans_idx)) {
+                return trans_idx;
+            }
+        }
+        return 0;
+    }
+
+    void fix_units(const base_type idx)
+    {
+        while (m_unfixed_units.back() != idx) {
+            const base_type unfixed_idx = m_unfixed_units.back();
+            m_unfixed_units.pop_back();
+
+            if (m_states_count >= m_hash_table.size() - (m_hash_table.size() >> 2)) {
+                expand_hash_table();
+            }
+
+            base_type siblings_count = 0;
+            for (base_type i = unfixed_idx; i != 0; i = m_units[i].sibling) {
+                ++siblings_count;
+            }
+
+            base_type hash_id;
+            base_type matched_idx = find_unit(unfixed_idx, hash_id);
+            ++m_register_lookups;
+            if (matched_idx != 0) {
+                ++m_register_hits;
+                m_merged_transitions_count += siblings_count;
+
+                // Records a merging state.
+                if (! m_dict.m_flag_pool[matched_idx]) {
+                    ++m_merging_states_count;
+                    m_dict.m_flag_pool[matched_idx] = true;
+                }
+            } else {
+                // Fixes units into pools.
+                base_type trans_idx = 0;
+                for (base_type i = 0; i < siblings_count; ++i) {
+                    trans_idx = allocate_transition();
+                }
+                for (base_type i = unfixed_idx; i != 0; i = m_units[i].sibling) {
+                    m_dict.m_base_pool[trans_idx] = m_units[i].base();
+                    m_dict.m_label_pool[trans_idx] = m_units[i].label;
+                    if (m_is_pushing) {
+                        m_dict.m_output_pool[trans_idx] = m_units[i].output;
+                    }
+                    --trans_idx;
+                }
+                matched_idx = trans_idx + 1;
+                m_hash_table[hash_id] = matched_idx;
+                ++m_states_count;
+            }
+
+            // Deletes fixed units.
+            for (base_type cur = unfixed_idx, next; cur != 0; cur = next) {
+                next = m_units[cur].sibling;
+                m_unused_units.emplace_back(cur);
+            }
+
+            m_units[m_unfixed_units.back()].child = matched_idx;
+        }
+        m_unfixed_units.pop_back();
+    }
+
+    static base_type hash(base_type key)
+    {
+        key = ~key + (key << 15);
+        key = key ^ (key >> 12);
+        key = key + (key << 2);
+        key = key ^ (key >> 4);
+        key = key * 2057;
+        key = key ^ (key >> 16);
+        return key;
+    }
+
+    base_type hash_transition(base_type idx) const
+    {
+        base_type hash_value = 0;
+        for (; idx != 0; ++idx) {
+            const base_type base = m_dict.m_base_pool[idx];
+            const base_type label = m_dict.m_label_pool[idx];
+            hash_value ^= hash((label << 24) ^ base ^ hash(static_cast<base_type>(m_dict.output(idx))));
+            if ((base & 1) == 0) {
+                break;
+            }
+        }
+        return hash_value;
+    }
+
+    base_type hash_unit(base_type idx) const
+    {
+        base_type hash_value = 0;
+        for (; idx != 0; idx = m_units[idx].sibling) {
+            const base_type label = m_units[idx].label;
+            hash_value ^= hash((label << 24) ^ m_units[idx].base() ^ hash(static_cast<base_type>(m_units[idx].output)));
+        }
+        return hash_value;
+    }
+
+    void init()
+    {
+        m_hash_table.resize(initial_hash_table_size, 0);
+        allocate_unit();
+        allocate_transition();
+        m_units[0].label = std::numeric_limits<label_type>::max();
+        m_unfixed_units.emplace_back(0);
+    }
+
+    bool insert_impl(const char_type* p_key, const size_type len, const value_type value)
+    {
+        if (m_p_fold != nullptr) {
+            m_normalized.emplace_back(std::basic_string<char_type>(p_key, len), value);
+            for (char_type& ch : m_normalized.back().first) {
+                ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+            }
+        } else if (! insert_key(p_key, len, value)) {
+            return false;
+        }
+        ++m_keys_count;
+        return true;
+    }
+
+    bool insert_key(const char_type* p_key, const size_type len, const value_type value)
+    {
+        if constexpr (codec::max_labels == 1) {
+            return insert_labels(p_key, len, value);
+        } else {
+            codec::encode(p_key, len, m_key_labels);
+            return insert_labels(m_key_labels.data(), m_key_labels.size(), value);
+        }
+    }
+
+    bool insert_normalized()
+    {
+        std::stable_sort(m_normalized.begin(), m_normalized.end(), [](const auto& lhs, const auto& rhs) {
+            return std::lexicographical_compare(lhs.first.cbegin(), lhs.first.cend(), rhs.first.cbegin(), rhs.first.cend(),
+                                                [](const char_type l, const char_type r) {
+                                                    return static_cast<uchar_type>(l) < static_cast<uchar_type>(r);
+                                                });
+        });
+        for (size_type i = 0; i < m_normalized.size(); ++i) {
+            // The sort is stable, so the last of equal keys is the last inserted.
+            if ((i + 1 < m_normalized.size()) && (m_normalized[i].first == m_normalized[i + 1].first)) {
+                continue;
+            }
+            if (! insert_key(m_normalized[i].first.data(), m_normalized[i].first.size(), m_normalized[i].second)) {
+                return false;
+            }
+        }
+        m_normalized.clear();
+        return true;
+    }
+
+    template<typename TLabel>
+    bool insert_labels(const TLabel* p_key, const size_type len, const value_type value)
+    {
+        if (m_hash_table.empty()) {
+            init();
+        }
+
+        base_type idx = 0;
+        size_type key_pos = 0;
+        // The rest of the value which is not covered by outputs of the prefix.
+        value_type rest = value;
+
+        // Finds a separate unit.
+        for (; key_pos <= len; ++key_pos) {
+            const base_type child_idx = m_units[idx].child;
+            if (child_idx == 0) {
+                break;
+            }
+
+            const label_type key_label = (key_pos < len) ? static_cast<label_type>(p_key[key_pos]) : 0;
+            const label_type unit_label = m_units[child_idx].label;
+            // Checks the order of keys.
+            if (key_label < unit_label) {
+                return false;
+            } else if (key_label > unit_label) {
+                m_units[child_idx].has_sibling = true;
+                fix_units(child_idx);
+                break;
+            }
+            idx = child_idx;
+            if (m_is_pushing && (key_label != 0)) {
+                push_output(idx, rest);
+            }
+        }
+
+        // The same key has been inserted before - updates its value.
+        if (key_pos > len) {
+            m_units[idx].child = rest;
+            return true;
+        }
+
+        // Adds new units.
+        for (; key_pos <= len; ++key_pos) {
+            const label_type key_label = (key_pos < len) ? static_cast<label_type>(p_key[key_pos]) : 0;
+            const base_type child_idx = allocate_unit();
+
+            if (m_units[idx].child == 0) {
+                m_units[child_idx].is_state = true;
+            }
+            m_units[child_idx].sibling = m_units[idx].child;
+            m_units[child_idx].label = key_label;
+            m_units[idx].child = child_idx;
+            m_unfixed_units.emplace_back(child_idx);
+
+            // The new transition is of this key only, so it takes the rest
+            // of the value and the states after it may be shared.
+            if (m_is_pushing && (key_label != 0)) {
+                m_units[child_idx].output = rest;
+                rest = 0;
+            }
+            idx = child_idx;
+        }
+        m_units[idx].child = rest;
+        return true;
+    }
+
+    /*
+     *  \brief  Lowers the output of the transition of the unfixed path to
+     *          the common part of its output and the rest of the value of
+     *          the inserted key. The excess is added to outputs of the next
+     *          transitions (values of leaves), so values of keys inserted
+     *          before are kept.
+     */
+    void push_output(const base_type idx, value_type& rest)
+    {
+        const value_type common = std::min(m_units[idx].output, rest);
+        const value_type excess = m_units[idx].output - common;
+        m_units[idx].output = common;
+        rest -= common;
+        if (excess == 0) {
+            return;
+        }
+        for (base_type i = m_units[idx].child; i != 0; i = m_units[i].sibling) {
+            if (m_units[i].label == 0) {
+                m_units[i].child += excess;
+            } else {
+                m_units[i].output += excess;
+            }
+        }
+    }
+
+private:
+    std::vector<base_type> m_hash_table;
+    std::vector<unit> m_units;
+    std::vector<base_type> m_unused_units;
+    std::vector<base_type> m_unfixed_units;
+    std::vector<label_type> m_key_labels;
+    dawg_dict<TChar, TBase, TValue> m_dict;
+
+    const uchar_type* m_p_fold = nullptr;
+    std::vector<std::pair<std::basic_string<char_type>, value_type>> m_normalized;
+    bool m_is_pushing = false;
+
+    size_type m_states_count = 1;
+    size_type m_merged_transitions_count = 0;
+    size_type m_merging_states_count = 0;
+    size_type m_register_lookups = 0;
+    size_type m_register_hits = 0;
+    size_type m_keys_count = 0;
 };
 
 } // namespace details
@@ -119,4 +568,3 @@ private:
 } // namespace wstux
 
 #endif /* _WORDDICT_WORDDICT_DAWG_BUILDER_H_ */
-
@@ -19,7 +19,7 @@
 #ifndef _WORDDICT_WORDDICT_DAWG_DICT_H_
 #define _WORDDICT_WORDDICT_DAWG_DICT_H_
 
-#include <deque>
+#include <vector>
 
 #include "worddict/details/dictraits.h"
 
@@ -27,29 +27,108 @@ namespace wstux {
 namespace wd {
 namespace details {
 
-template<typename TChar>
+template<typename TChar, typename TBase, typename TValue>
+class dawg_builder;
+
+/*
+ *  \brief  Minimal DAWG produced by dawg_builder.
+ *
+ *  Transitions of a state are stored contiguously in the base pool. Every
+ *  unit keeps the index of the first transition of its destination state
+ *  and the 'has sibling' flag (the next transition of the same state is
+ *  stored at the next index). Leaf units (label '\0') keep the value of the
+ *  key instead of the child index.
+ *
+ *  If outputs are pushed to transitions (see dawg_builder), the value of the
+ *  key is the sum of outputs of its transitions and the value of its leaf.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
 class dawg_dict final
 {
+    friend class dawg_builder<TChar, TBase, TValue>;
+
 public:
-    using base_type  = typename details::traits<TChar>::base_type;
-    using char_type  = typename details::traits<TChar>::char_type;
-    using size_type  = typename details::traits<TChar>::size_type;
-    using uchar_type = typename details::traits<TChar>::uchar_type;
-    using value_type = typename details::traits<TChar>::value_type;
+    using base_type  = typename details::traits<TChar, TBase, TValue>::dawg_base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
 
     dawg_dict() {}
 
-    size_type merged_states_count() const { return 0; }
+    base_type child(const base_type idx) const { return m_base_pool[idx] >> 2; }
+
+    void clear()
+    {
+        m_base_pool.clear();
+        m_label_pool.clear();
+        m_flag_pool.clear();
+        m_output_pool.clear();
+        m_states_count = 0;
+        m_merged_states_count = 0;
+        m_merged_transitions_count = 0;
+        m_merging_states_count = 0;
+        m_register_lookups = 0;
+        m_register_hits = 0;
+    }
+
+    /*
+     *  \brief  Returns true if outputs are pushed to transitions.
+     */
+    bool has_outputs() const { return ! m_output_pool.empty(); }
+
+    bool is_leaf(const base_type idx) const { return label(idx) == '\0'; }
+
+    bool is_merging(const base_type idx) const { return m_flag_pool[idx]; }
+
+    label_type label(const base_type idx) const { return m_label_pool[idx]; }
 
-    size_type merged_transitions_count() const { return 0; }
+    /*
+     *  \brief  Returns the output of the transition, 0 if outputs are not
+     *          pushed to transitions.
+     */
+    value_type output(const base_type idx) const { return m_output_pool.empty() ? 0 : m_output_pool[idx]; }
 
-    size_type merging_states_count() const { return 0; }
+    size_type merged_states_count() const { return m_merged_states_count; }
 
-    size_type size() const { return 0; }
+    size_type merged_transitions_count() const { return m_merged_transitions_count; }
 
-    size_type states_count() const { return 0; }
+    size_type merging_states_count() const { return m_merging_states_count; }
 
-    size_type transitions_count() const { return 0; }
+    /*
+     *  \brief  Returns the count of lookups of states in the register of
+     *          the minimal states while building and the count of states
+     *          found there, i.e. merged with equal states.
+     */
+    size_type register_lookups() const { return m_register_lookups; }
+
+    size_type register_hits() const { return m_register_hits; }
+
+    base_type root() const { return 0; }
+
+    base_type sibling(const base_type idx) const { return (m_base_pool[idx] & 1) ? (idx + 1) : 0; }
+
+    size_type size() const { return m_base_pool.size(); }
+
+    size_type states_count() const { return m_states_count; }
+
+    size_type transitions_count() const { return m_base_pool.empty() ? 0 : m_base_pool.size() - 1; }
+
+    value_type value(const base_type idx) const { return static_cast<value_type>(m_base_pool[idx] >> 1); }
+
+private:
+    std::vector<base_type> m_base_pool;
+    std::vector<label_type> m_label_pool;
+    std::vector<bool> m_flag_pool;
+    std::vector<value_type> m_output_pool;
+
+    size_type m_states_count = 0;
+    size_type m_merged_states_count = 0;
+    size_type m_merged_transitions_count = 0;
+    size_type m_merging_states_count = 0;
+    size_type m_register_lookups = 0;
+    size_type m_register_hits = 0;
 };
 
 } // namespace details
@@ -57,4 +136,3 @@ public:
 } // namespace wstux
 
 #endif  /* _WORDDICT_WORDDICT_DAWG_DICT_H_ */
-
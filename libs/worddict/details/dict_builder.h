@@ -0,0 +1,583 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DICT_BUILDER_H_
+#define _WORDDICT_WORDDICT_DICT_BUILDER_H_
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/dawg_dict.h"
+#include "worddict/details/dict_unit.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Builder of the double-array from the minimal DAWG.
+ *
+ *  States of the DAWG are arranged in the depth-first order. If the heat of
+ *  the states is set, the hot states are arranged first (the hottest child
+ *  first), so they are packed contiguously near the root. The rest of
+ *  states are arranged after them in the depth-first order, which keeps
+ *  the chains of single-child states in the same cache lines.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
+class dict_builder final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dawg_base_type = typename details::traits<TChar, TBase, TValue>::dawg_base_type;
+
+    using unit = dict_unit<TChar, TBase, TValue>;
+
+    /// Callable as progress(arranged_states, states_count).
+    using progress_type = std::function<void(size_type, size_type)>;
+
+    explicit dict_builder(const dawg_dict<TChar, TBase, TValue>& dawg)
+        : m_dawg(dawg)
+    {}
+
+    /*
+     *  \brief  Sets the callback which is called after every few thousands
+     *          of arranged states and when the array is built.
+     */
+    void set_progress(progress_type progress) { m_progress = std::move(progress); }
+
+    /*
+     *  \brief  Appends the block of the dead state to the built array: the
+     *          unit 'dead | label' has the label and leads to the unit of
+     *          the dead state with any other label, so the walk may follow
+     *          the dead state instead of the missed transition without
+     *          leaving the array.
+     */
+    void set_dead_state(const bool enabled) { m_is_dead_state = enabled; }
+
+    /*
+     *  \brief  Builds the double-array.
+     *  \param  units - output array of units.
+     *  \param  p_heat - heat of the DAWG states (indexed by the first
+     *          transition of the state) or nullptr.
+     *  \param  p_values - sorted distinct values, leaf units keep indexes
+     *          of the values in the array, or nullptr.
+     *  \param  p_outputs - output array of outputs of transitions indexed
+     *          by units, or nullptr.
+     */
+    bool build(std::vector<base_type>& units, const std::vector<size_type>* p_heat = nullptr,
+               const std::vector<value_type>* p_values = nullptr, std::vector<value_type>* p_outputs = nullptr)
+    {
+        m_p_heat = p_heat;
+        m_p_values = p_values;
+        m_p_outputs = p_outputs;
+        if (m_p_outputs != nullptr) {
+            m_p_outputs->clear();
+        }
+        m_link_table.init(m_dawg.merging_states_count() + (m_dawg.merging_states_count() >> 1));
+
+        reserve_unit(0);
+        extras(0).set_is_used();
+        unit::set_offset(m_units[0], 1);
+        unit::set_label(m_units[0], '\0');
+
+        if (m_dawg.size() > 1) {
+            const bool rc = (m_p_heat == nullptr) ? build_dfs(m_dawg.root(), 0)
+                                                  : build_by_heat();
+            if (! rc) {
+                return false;
+            }
+        }
+
+        fix_all_blocks();
+        if (m_is_dead_state) {
+            append_dead_state();
+        }
+        if (m_p_outputs != nullptr) {
+            m_p_outputs->resize(m_units.size(), 0);
+        }
+        units.swap(m_units);
+        if (m_progress) {
+            m_progress(m_dawg.states_count(), m_dawg.states_count());
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the count of units in the prefix of the array which
+     *          holds the hot states.
+     */
+    size_type hot_units_count() const { return m_hot_units_count; }
+
+    size_type unused_units_count() const { return m_unused_units_count; }
+
+    /*
+     *  \brief  Returns the first unit of the block of the dead state, 0 if
+     *          there is no such block.
+     */
+    base_type dead_state() const { return m_dead_state; }
+
+private:
+    static constexpr base_type block_size     = base_type(1) << unit::label_bits;
+    static constexpr base_type unfixed_blocks = 16;
+    static constexpr size_type progress_step  = size_type(1) << 12;
+    static constexpr base_type upper_mask     = ~(unit::offset_max - 1);
+    static constexpr base_type lower_mask     = unit::label_mask;
+
+    /*
+     *  \brief  Extra information of the unit used while building.
+     */
+    class extra_unit final
+    {
+    public:
+        void clear() { m_lo = m_hi = 0; }
+
+        bool is_fixed() const { return (m_lo & 1) == 1; }
+        bool is_used() const { return (m_hi & 1) == 1; }
+        base_type next() const { return m_lo >> 1; }
+        base_type prev() const { return m_hi >> 1; }
+
+        void set_is_fixed() { m_lo |= 1; }
+        void set_is_used() { m_hi |= 1; }
+        void set_next(const base_type next) { m_lo = (m_lo & 1) | (next << 1); }
+        void set_prev(const base_type prev) { m_hi = (m_hi & 1) | (prev << 1); }
+
+    private:
+        base_type m_lo = 0;
+        base_type m_hi = 0;
+    };
+
+    /*
+     *  \brief  Hash table of offsets of the merging states.
+     */
+    class link_table final
+    {
+    public:
+        void init(const size_type size) { m_table.assign(size, std::make_pair(0, 0)); }
+
+        base_type find(const dawg_base_type idx) const { return m_table[find_id(idx)].second; }
+
+        void insert(const dawg_base_type idx, const base_type offset)
+        {
+            const base_type id = find_id(idx);
+            m_table[id].first = idx;
+            m_table[id].second = offset;
+        }
+
+    private:
+        base_type find_id(const dawg_base_type idx) const
+        {
+            base_type id = hash(idx) % m_table.size();
+            while (m_table[id].first != 0) {
+                if (idx == m_table[id].first) {
+                    return id;
+                }
+                id = (id + 1) % m_table.size();
+            }
+            return id;
+        }
+
+        static dawg_base_type hash(dawg_base_type key)
+        {
+            key = ~key + (key << 15);
+            key = key ^ (key >> 12);
+            key = key + (key << 2);
+            key = key ^ (key >> 4);
+            key = key * 2057;
+            key = key ^ (key >> 16);
+            return key;
+        }
+
+    private:
+        std::vector<std::pair<dawg_base_type, base_type>> m_table;
+    };
+
+    /*
+     *  \brief  State of the DAWG waiting to be arranged.
+     */
+    struct pending_state final
+    {
+        bool operator<(const pending_state& other) const { return heat < other.heat; }
+
+        size_type heat;
+        dawg_base_type dawg_idx;
+        base_type dict_idx;
+    };
+
+private:
+    base_type arrange_children(const dawg_base_type dawg_idx, const base_type dict_idx)
+    {
+        m_labels.clear();
+        dawg_base_type dawg_child_idx = m_dawg.child(dawg_idx);
+        while (dawg_child_idx != 0) {
+            m_labels.emplace_back(m_dawg.label(dawg_child_idx));
+            dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+        }
+
+        // Finds a good offset.
+        const base_type offset = find_good_offset(dict_idx);
+        if (! unit::set_offset(m_units[dict_idx], dict_idx ^ offset)) {
+            return 0;
+        }
+
+        dawg_child_idx = m_dawg.child(dawg_idx);
+        for (size_type i = 0; i < m_labels.size(); ++i) {
+            const base_type dict_child_idx = offset ^ m_labels[i];
+            reserve_unit(dict_child_idx);
+
+            if (m_dawg.is_leaf(dawg_child_idx)) {
+                unit::set_has_leaf(m_units[dict_idx]);
+                unit::set_value(m_units[dict_child_idx], leaf_value(dawg_child_idx));
+            } else {
+                unit::set_label(m_units[dict_child_idx], m_labels[i]);
+                if (m_p_outputs != nullptr) {
+                    if (dict_child_idx >= m_p_outputs->size()) {
+                        m_p_outputs->resize(units_count(), 0);
+                    }
+                    (*m_p_outputs)[dict_child_idx] = m_dawg.output(dawg_child_idx);
+                }
+            }
+            dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+        }
+        extras(offset).set_is_used();
+
+        if (m_progress && ((++m_arranged_states % progress_step) == 0)) {
+            m_progress(std::min(m_arranged_states, m_dawg.states_count()), m_dawg.states_count());
+        }
+        return offset;
+    }
+
+    /*
+     *  \brief  Arranges children of the state if the state is merging and
+     *          its children have been already arranged.
+     *  \return offset of the children or 0.
+     */
+    base_type arrange_linked(const dawg_base_type dawg_idx, const base_type dict_idx)
+    {
+        const dawg_base_type dawg_child_idx = m_dawg.child(dawg_idx);
+        if (! m_dawg.is_merging(dawg_child_idx)) {
+            return 0;
+        }
+
+        base_type offset = m_link_table.find(dawg_child_idx);
+        if (offset == 0) {
+            return 0;
+        }
+
+        offset ^= dict_idx;
+        if (!(offset & upper_mask) || !(offset & lower_mask)) {
+            if (m_dawg.is_leaf(dawg_child_idx)) {
+                unit::set_has_leaf(m_units[dict_idx]);
+            }
+            unit::set_offset(m_units[dict_idx], offset);
+            return offset;
+        }
+        return 0;
+    }
+
+    bool build_dfs(const dawg_base_type dawg_idx, const base_type dict_idx)
+    {
+        if (m_dawg.is_leaf(dawg_idx)) {
+            return true;
+        }
+
+        // Uses an existing offset if available.
+        if (arrange_linked(dawg_idx, dict_idx) != 0) {
+            return true;
+        }
+
+        // Finds a good offset and arranges child nodes.
+        dawg_base_type dawg_child_idx = m_dawg.child(dawg_idx);
+        const base_type offset = arrange_children(dawg_idx, dict_idx);
+        if (offset == 0) {
+            return false;
+        }
+        if (m_dawg.is_merging(dawg_child_idx)) {
+            m_link_table.insert(dawg_child_idx, offset);
+        }
+
+        // Builds a double-array in depth-first order.
+        do {
+            const base_type dict_child_idx = offset ^ m_dawg.label(dawg_child_idx);
+            if (! build_dfs(dawg_child_idx, dict_child_idx)) {
+                return false;
+            }
+            dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+        } while (dawg_child_idx != 0);
+
+        return true;
+    }
+
+    bool build_by_heat()
+    {
+        const std::vector<size_type>& heat = *m_p_heat;
+        std::vector<pending_state> hot;
+        std::vector<pending_state> cold;
+        std::vector<pending_state> children;
+
+        hot.push_back({heat[m_dawg.child(m_dawg.root())], m_dawg.root(), 0});
+        while (! hot.empty()) {
+            const pending_state state = hot.back();
+            hot.pop_back();
+
+            if (m_dawg.is_leaf(state.dawg_idx) || (arrange_linked(state.dawg_idx, state.dict_idx) != 0)) {
+                continue;
+            }
+
+            dawg_base_type dawg_child_idx = m_dawg.child(state.dawg_idx);
+            const base_type offset = arrange_children(state.dawg_idx, state.dict_idx);
+            if (offset == 0) {
+                return false;
+            }
+            if (m_dawg.is_merging(dawg_child_idx)) {
+                m_link_table.insert(dawg_child_idx, offset);
+            }
+
+            // Hot children are arranged starting from the hottest one, cold
+            // children are deferred until all hot states are arranged.
+            children.clear();
+            do {
+                if (! m_dawg.is_leaf(dawg_child_idx)) {
+                    const base_type dict_child_idx = offset ^ m_dawg.label(dawg_child_idx);
+                    const size_type child_heat = heat[m_dawg.child(dawg_child_idx)];
+                    if (child_heat > 0) {
+                        children.push_back({child_heat, dawg_child_idx, dict_child_idx});
+                    } else {
+                        cold.push_back({0, dawg_child_idx, dict_child_idx});
+                    }
+                }
+                dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+            } while (dawg_child_idx != 0);
+
+            std::stable_sort(children.begin(), children.end());
+            hot.insert(hot.end(), children.cbegin(), children.cend());
+
+            for (const label_type label : m_labels) {
+                m_hot_units_count = std::max<size_type>(m_hot_units_count, (offset ^ label) + 1);
+            }
+        }
+
+        for (const pending_state& state : cold) {
+            if (! build_dfs(state.dawg_idx, state.dict_idx)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void expand_dict()
+    {
+        const base_type src_units_count = units_count();
+        const base_type src_blocks_count = blocks_count();
+        const base_type dest_units_count = src_units_count + block_size;
+        const base_type dest_blocks_count = src_blocks_count + 1;
+
+        // Fixes an old block.
+        if (dest_blocks_count > unfixed_blocks) {
+            fix_block(src_blocks_count - unfixed_blocks);
+        }
+
+        m_units.resize(dest_units_count, 0);
+        m_extras.resize(dest_blocks_count);
+
+        // Allocates memory to a new block.
+        if (dest_blocks_count > unfixed_blocks) {
+            const base_type block_id = src_blocks_count - unfixed_blocks;
+            std::swap(m_extras[block_id], m_extras.back());
+            for (base_type i = src_units_count; i < dest_units_count; ++i) {
+                extras(i).clear();
+            }
+        } else {
+            m_extras.back().reset(new extra_unit[block_size]);
+        }
+
+        // Creates a circular linked list for a new block.
+        for (base_type i = src_units_count + 1; i < dest_units_count; ++i) {
+            extras(i - 1).set_next(i);
+            extras(i).set_prev(i - 1);
+        }
+
+        extras(src_units_count).set_prev(dest_units_count - 1);
+        extras(dest_units_count - 1).set_next(src_units_count);
+
+        // Merges 2 circular linked lists.
+        extras(src_units_count).set_prev(extras(m_unfixed_idx).prev());
+        extras(dest_units_count - 1).set_next(m_unfixed_idx);
+
+        extras(extras(m_unfixed_idx).prev()).set_next(src_units_count);
+        extras(m_unfixed_idx).set_prev(dest_units_count - 1);
+    }
+
+    extra_unit& extras(const base_type idx) { return m_extras[idx / block_size][idx % block_size]; }
+
+    const extra_unit& extras(const base_type idx) const { return m_extras[idx / block_size][idx % block_size]; }
+
+    base_type find_good_offset(const base_type idx) const
+    {
+        if (m_unfixed_idx >= units_count()) {
+            return units_count() | (idx & lower_mask);
+        }
+
+        // Scans unused units to find a good offset.
+        base_type unfixed_idx = m_unfixed_idx;
+        do {
+            const base_type offset = unfixed_idx ^ m_labels[0];
+            if (is_good_offset(idx, offset)) {
+                return offset;
+            }
+            unfixed_idx = extras(unfixed_idx).next();
+        } while (unfixed_idx != m_unfixed_idx);
+
+        return units_count() | (idx & lower_mask);
+    }
+
+    void fix_all_blocks()
+    {
+        base_type begin = 0;
+        if (blocks_count() > unfixed_blocks) {
+            begin = blocks_count() - unfixed_blocks;
+        }
+        const base_type end = blocks_count();
+
+        for (base_type block_id = begin; block_id != end; ++block_id) {
+            fix_block(block_id);
+        }
+    }
+
+    void fix_block(const base_type block_id)
+    {
+        const base_type begin = block_id * block_size;
+        const base_type end = begin + block_size;
+
+        // Finds an unused offset.
+        base_type unused_offset_for_label = 0;
+        for (base_type offset = begin; offset != end; ++offset) {
+            if (! extras(offset).is_used()) {
+                unused_offset_for_label = offset;
+                break;
+            }
+        }
+
+        // Labels of unused units are modified.
+        for (base_type idx = begin; idx != end; ++idx) {
+            if (! extras(idx).is_fixed()) {
+                reserve_unit(idx);
+                unit::set_label(m_units[idx], static_cast<label_type>(idx ^ unused_offset_for_label));
+                ++m_unused_units_count;
+            }
+        }
+    }
+
+    void append_dead_state()
+    {
+        // The array consists of whole blocks, so the dead state is aligned
+        // and 'dead | label' ^ offset ^ other label is 'dead | other label'.
+        m_dead_state = units_count();
+        m_units.resize(m_dead_state + block_size, 0);
+        for (base_type label = 0; label < block_size; ++label) {
+            unit::set_offset(m_units[m_dead_state | label], label);
+            unit::set_label(m_units[m_dead_state | label], static_cast<label_type>(label));
+        }
+    }
+
+    bool is_good_offset(const base_type idx, const base_type offset) const
+    {
+        if (extras(offset).is_used()) {
+            return false;
+        }
+
+        const base_type relative_offset = idx ^ offset;
+        if ((relative_offset & lower_mask) && (relative_offset & upper_mask)) {
+            return false;
+        }
+
+        // Finds a collision.
+        for (size_type i = 1; i < m_labels.size(); ++i) {
+            if (extras(offset ^ m_labels[i]).is_fixed()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void reserve_unit(const base_type idx)
+    {
+        if (idx >= units_count()) {
+            expand_dict();
+        }
+
+        // Removes an unused unit from a circular linked list.
+        if (idx == m_unfixed_idx) {
+            m_unfixed_idx = extras(idx).next();
+            if (m_unfixed_idx == idx) {
+                m_unfixed_idx = units_count();
+            }
+        }
+        extras(extras(idx).prev()).set_next(extras(idx).next());
+        extras(extras(idx).next()).set_prev(extras(idx).prev());
+        extras(idx).set_is_fixed();
+    }
+
+    base_type blocks_count() const { return m_extras.size(); }
+
+    value_type leaf_value(const dawg_base_type dawg_idx) const
+    {
+        const value_type value = m_dawg.value(dawg_idx);
+        if (m_p_values == nullptr) {
+            return value;
+        }
+        return std::lower_bound(m_p_values->cbegin(), m_p_values->cend(), value) - m_p_values->cbegin();
+    }
+
+    base_type units_count() const { return m_units.size(); }
+
+private:
+    const dawg_dict<TChar, TBase, TValue>& m_dawg;
+    const std::vector<size_type>* m_p_heat = nullptr;
+    const std::vector<value_type>* m_p_values = nullptr;
+    std::vector<value_type>* m_p_outputs = nullptr;
+
+    std::vector<base_type> m_units;
+    std::vector<std::unique_ptr<extra_unit[]>> m_extras;
+    std::vector<label_type> m_labels;
+    link_table m_link_table;
+
+    base_type m_unfixed_idx = 0;
+    size_type m_hot_units_count = 0;
+    size_type m_unused_units_count = 0;
+
+    bool m_is_dead_state = false;
+    base_type m_dead_state = 0;
+
+    progress_type m_progress;
+    size_type m_arranged_states = 0;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DICT_BUILDER_H_ */
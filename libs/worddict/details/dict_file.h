@@ -0,0 +1,216 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DICT_FILE_H_
+#define _WORDDICT_WORDDICT_DICT_FILE_H_
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <nmmintrin.h>
+    #define _WORDDICT_HAS_CRC32C_INTRINSICS 1
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Verification of checksums of the dictionary file.
+ */
+enum class verification
+{
+    none,    ///< Only the header is checked.
+    sampled, ///< The header, the table of checksums and the sample of chunks are checked.
+    full     ///< All chunks are checked.
+};
+
+namespace details {
+
+/*
+ *  \brief  Header of the dictionary file.
+ *
+ *  The file consists of the header, the section of units, the section of
+ *  packed values, the section of fingerprints of the filter of keys and
+ *  the table of CRC32C checksums of chunks of sections.
+ *  Sections are aligned to 8 bytes, so they can be used in place in the
+ *  mapped file. The header and the table of checksums are checked by
+ *  their own checksums.
+ */
+struct file_header final
+{
+    static constexpr uint64_t magic_value = 0x5443494444524F57ULL; // "WORDDICT"
+    static constexpr uint64_t version_value = 3;
+    static constexpr uint64_t default_chunk_size = uint64_t(1) << 20;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t traits;            ///< Sizes of the character, the unit, the value and the label.
+    uint64_t units_count;
+    uint64_t hot_size;
+    uint64_t dead_state;        ///< First unit of the block of the dead state, 0 if there is none.
+    uint64_t values_words;      ///< 0 if values are stored in the units.
+    uint64_t normalization;
+    uint64_t states_count;      ///< Count of states of the DAWG.
+    uint64_t transitions_count; ///< Count of transitions of the DAWG.
+    uint64_t chunk_size;        ///< Count of bytes of the section covered by one checksum.
+    uint64_t units_offset;
+    uint64_t values_offset;
+    uint64_t filter_offset;
+    uint64_t filter_bytes;      ///< 0 if the dictionary has no filter of keys.
+    uint64_t filter_block_size; ///< Count of cells of the third of the filter.
+    uint64_t filter_seed;
+    uint64_t filter_bits;       ///< Count of bits of fingerprints.
+    uint64_t checksums_offset;
+    uint64_t checksums_count;
+    uint64_t checksums_crc;
+    uint64_t header_crc;        ///< Checksum of the previous fields.
+
+    template<typename TChar, typename TBase, typename TValue>
+    static uint64_t make_traits()
+    {
+        using traits_type = details::traits<TChar, TBase, TValue>;
+        return sizeof(typename traits_type::uchar_type) | (sizeof(typename traits_type::base_type) << 8)
+            | (sizeof(typename traits_type::value_type) << 16) | (sizeof(typename traits_type::label_type) << 24);
+    }
+
+    static uint64_t align(const uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+    static uint64_t chunks_count(const uint64_t bytes, const uint64_t chunk_size)
+    {
+        return (bytes + chunk_size - 1) / chunk_size;
+    }
+};
+
+static_assert(sizeof(file_header) == 22 * sizeof(uint64_t), "file_header: unexpected padding");
+
+/*
+ *  \brief  CRC32C (Castagnoli) by the table.
+ */
+inline uint32_t crc32c_sw(uint32_t crc, const unsigned char* p_data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? ((c >> 1) ^ 0x82F63B78) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    for (; size > 0; --size, ++p_data) {
+        crc = table[(crc ^ *p_data) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(_WORDDICT_HAS_CRC32C_INTRINSICS)
+/*
+ *  \brief  CRC32C by the SSE4.2 instruction, 8 bytes per instruction.
+ */
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_hw(uint32_t crc, const unsigned char* p_data, size_t size)
+{
+    for (; (size > 0) && ((reinterpret_cast<uintptr_t>(p_data) & 7) != 0); --size, ++p_data) {
+        crc = _mm_crc32_u8(crc, *p_data);
+    }
+
+    uint64_t c = crc;
+    for (; size >= 8; size -= 8, p_data += 8) {
+        uint64_t word;
+        std::memcpy(&word, p_data, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+    }
+    crc = static_cast<uint32_t>(c);
+
+    for (; size > 0; --size, ++p_data) {
+        crc = _mm_crc32_u8(crc, *p_data);
+    }
+    return crc;
+}
+#endif
+
+inline uint32_t crc32c(const void* p_data, const size_t size, const uint32_t seed = 0)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(p_data);
+#if defined(_WORDDICT_HAS_CRC32C_INTRINSICS)
+    static const bool is_hw = __builtin_cpu_supports("sse4.2");
+    if (is_hw) {
+        return ~crc32c_hw(~seed, p, size);
+    }
+#endif
+    return ~crc32c_sw(~seed, p, size);
+}
+
+inline uint64_t header_crc(const file_header& header)
+{
+    return crc32c(&header, offsetof(file_header, header_crc));
+}
+
+/*
+ *  \brief  Appends checksums of chunks of the section.
+ */
+inline void make_checksums(const void* p_section, const uint64_t bytes, const uint64_t chunk_size,
+                           std::vector<uint32_t>& checksums)
+{
+    const char* p = static_cast<const char*>(p_section);
+    for (uint64_t offset = 0; offset < bytes; offset += chunk_size) {
+        checksums.push_back(crc32c(p + offset, std::min(chunk_size, bytes - offset)));
+    }
+}
+
+/*
+ *  \brief  Checks checksums of chunks of the section: all chunks or the
+ *          first, the last and evenly spread chunks.
+ */
+inline bool verify_checksums(const void* p_section, const uint64_t bytes, const uint64_t chunk_size,
+                             const uint32_t* p_checksums, const verification mode)
+{
+    /// Count of chunks of the section checked by the sampled verification.
+    constexpr uint64_t sampled_chunks = 16;
+
+    const char* p = static_cast<const char*>(p_section);
+    const auto is_valid = [&](const uint64_t chunk) {
+        const uint64_t offset = chunk * chunk_size;
+        return crc32c(p + offset, std::min(chunk_size, bytes - offset)) == p_checksums[chunk];
+    };
+
+    const uint64_t count = file_header::chunks_count(bytes, chunk_size);
+    const uint64_t step = ((mode == verification::full) || (count <= sampled_chunks)) ? 1 : (count / sampled_chunks);
+    for (uint64_t chunk = 0; chunk < count; chunk += step) {
+        if (! is_valid(chunk)) {
+            return false;
+        }
+    }
+    return (count == 0) || is_valid(count - 1);
+}
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DICT_FILE_H_ */
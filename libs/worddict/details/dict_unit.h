@@ -0,0 +1,109 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DICT_UNIT_H_
+#define _WORDDICT_WORDDICT_DICT_UNIT_H_
+
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Encoding of the double-array unit.
+ *
+ *  Layout of the unit (L - bits count of the label):
+ *  - leaf unit: [is_leaf:1][value];
+ *  - other units: [offset][extension:1][has_leaf:1][label:L].
+ *
+ *  If the offset does not fit into the unit, it is stored with the
+ *  'extension' flag and must have L lower zero bits.
+ *
+ *  The array may end with the block of the dead state, where the unit
+ *  has the offset and the label equal to its index in the block, so
+ *  every transition of the dead state leads to it again (see
+ *  dict_builder::set_dead_state).
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
+struct dict_unit final
+{
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    static constexpr base_type label_bits = sizeof(label_type) * 8;
+    static constexpr base_type label_mask = (base_type(1) << label_bits) - 1;
+
+    static constexpr base_type is_leaf_bit   = base_type(1) << (sizeof(base_type) * 8 - 1);
+    static constexpr base_type has_leaf_bit  = base_type(1) << label_bits;
+    static constexpr base_type extension_bit = base_type(1) << (label_bits + 1);
+
+    /// Maximum value stored in the leaf unit.
+    static constexpr base_type value_max = is_leaf_bit - 1;
+
+    static constexpr base_type offset_shift = label_bits + 2;
+    static constexpr base_type offset_max   = base_type(1) << (sizeof(base_type) * 8 - 1 - offset_shift);
+
+    /// Shift of the 'extension' flag, which gives the extension shift of the offset.
+    static constexpr base_type extension_shift = (label_bits == 8) ? (label_bits + 1 - 3)
+                                                                   : (label_bits + 1 - 4);
+
+    static constexpr bool has_leaf(const base_type unit) { return (unit & has_leaf_bit) != 0; }
+
+    static constexpr base_type label(const base_type unit) { return unit & (is_leaf_bit | label_mask); }
+
+    static constexpr base_type offset(const base_type unit)
+    {
+        return (unit >> offset_shift) << ((unit & extension_bit) >> extension_shift);
+    }
+
+    static constexpr value_type value(const base_type unit) { return static_cast<value_type>(unit & ~is_leaf_bit); }
+
+    static constexpr void set_has_leaf(base_type& unit) { unit |= has_leaf_bit; }
+
+    static constexpr void set_label(base_type& unit, const label_type label)
+    {
+        unit = (unit & ~label_mask) | static_cast<base_type>(label);
+    }
+
+    static constexpr bool set_offset(base_type& unit, const base_type offset)
+    {
+        if (offset >= (offset_max << label_bits)) {
+            return false;
+        }
+        unit &= is_leaf_bit | has_leaf_bit | label_mask;
+        if (offset < offset_max) {
+            unit |= (offset << offset_shift);
+        } else {
+            unit |= (offset << 2) | extension_bit;
+        }
+        return true;
+    }
+
+    static constexpr void set_value(base_type& unit, const value_type value)
+    {
+        unit = static_cast<base_type>(value) | is_leaf_bit;
+    }
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DICT_UNIT_H_ */
@@ -19,77 +19,96 @@
 #ifndef _WORDDICT_WORDDICT_DICTRAITS_H_
 #define _WORDDICT_WORDDICT_DICTRAITS_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 
 namespace wstux {
 namespace wd {
 namespace details {
 
+/*
+ *  \brief  Traits of the characters of the keys and the default width of
+ *          the values.
+ */
 template<typename TChar>
-struct traits final {};
+struct char_traits final {};
 
 template<>
-struct traits<char> final
+struct char_traits<char> final
 {
-    using char_type = char;
+    using char_type  = char;
     using uchar_type = uint8_t;
     using value_type = int32_t;
-    using base_type = uint32_t;
-
-    using size_type = size_t;
 };
 
 template<>
-struct traits<int8_t> final
+struct char_traits<int8_t> final
 {
     using char_type  = int8_t;
     using uchar_type = uint8_t;
-    using base_type  = uint32_t;
     using value_type = int32_t;
-
-    using size_type  = size_t;
 };
 
 template<>
-struct traits<uint8_t> final
+struct char_traits<uint8_t> final
 {
     using char_type  = uint8_t;
     using uchar_type = uint8_t;
-    using base_type  = uint32_t;
     using value_type = int32_t;
-
-    using size_type  = size_t;
 };
 
 template<>
-struct traits<char16_t> final
+struct char_traits<char16_t> final
 {
     using char_type  = char16_t;
     using uchar_type = uint16_t;
-    using base_type  = uint64_t;
     using value_type = int64_t;
-
-    using size_type  = size_t;
 };
 
 template<>
-struct traits<int16_t> final
+struct char_traits<int16_t> final
 {
     using char_type  = int16_t;
     using uchar_type = uint16_t;
-    using base_type  = uint64_t;
     using value_type = int64_t;
-
-    using size_type  = size_t;
 };
 
 template<>
-struct traits<uint16_t> final
+struct char_traits<uint16_t> final
 {
     using char_type  = uint16_t;
     using uchar_type = uint16_t;
-    using base_type  = uint64_t;
     using value_type = int64_t;
+};
+
+/*
+ *  \brief  Traits of the dictionary.
+ *  \tparam  TBase - unit of the double-array. 32-bit units address up to
+ *          2^29 units and keep 8-bit labels, 64-bit units keep 16-bit
+ *          labels and are needed only for larger arrays.
+ *  \tparam  TValue - value of the key. Values which do not fit the leaf
+ *          unit are stored in the packed array.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
+struct traits final
+{
+    static_assert(std::is_unsigned<TBase>::value && (sizeof(TBase) >= 4), "Unit must be unsigned and at least 32-bit");
+    static_assert(std::is_signed<TValue>::value && (sizeof(TValue) >= 4), "Value must be signed and at least 32-bit");
+
+    using char_type  = typename char_traits<TChar>::char_type;
+    using uchar_type = typename char_traits<TChar>::uchar_type;
+    using base_type  = TBase;
+    using value_type = TValue;
+
+    /// Label of the transition. 16-bit characters do not fit the 32-bit unit
+    /// with the offset, so they are split into byte labels (see label_codec).
+    using label_type = typename std::conditional<(sizeof(uchar_type) > 1) && (sizeof(TBase) < 8),
+                                                 uint8_t, uchar_type>::type;
+
+    /// Unit of the DAWG, which keeps the value shifted by one bit.
+    using dawg_base_type = typename std::conditional<(sizeof(TValue) > sizeof(TBase)),
+                                                     typename std::make_unsigned<TValue>::type, TBase>::type;
 
     using size_type  = size_t;
 };
@@ -99,4 +118,3 @@ struct traits<uint16_t> final
 } // namespace wstux
 
 #endif /* _WORDDICT_WORDDICT_DICTRAITS_H_ */
-
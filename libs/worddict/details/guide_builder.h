@@ -0,0 +1,124 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_GUIDE_BUILDER_H_
+#define _WORDDICT_WORDDICT_GUIDE_BUILDER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/dawg_dict.h"
+#include "worddict/details/dict_unit.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Builder of the guide: the DAWG and the double-array are walked
+ *          together, units of the merged states are visited once and the
+ *          counts of their keys are reused.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
+class guide_builder final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+
+    using dawg_base_type = typename details::traits<TChar, TBase, TValue>::dawg_base_type;
+
+    using unit = dict_unit<TChar, TBase, TValue>;
+
+    guide_builder(const dawg_dict<TChar, TBase, TValue>& dawg, const std::vector<base_type>& units)
+        : m_dawg(dawg)
+        , m_units(units)
+    {}
+
+    /*
+     *  \param  guide - labels of the first child and the next sibling.
+     *  \param  counts - counts of keys, which paths pass through the unit.
+     *  \return false if the count of keys does not fit the unit.
+     */
+    bool build(std::vector<std::pair<label_type, label_type>>& guide, std::vector<base_type>& counts)
+    {
+        m_guide.assign(m_units.size(), std::make_pair(0, 0));
+        m_counts.assign(m_units.size(), 0);
+        m_is_fixed.assign(m_units.size(), false);
+        if ((m_dawg.size() > 1) && (build(m_dawg.root(), 0) > std::numeric_limits<base_type>::max())) {
+            return false;
+        }
+        guide.swap(m_guide);
+        counts.swap(m_counts);
+        return true;
+    }
+
+private:
+    /*
+     *  \return count of keys of the unit, which may exceed base_type.
+     */
+    uint64_t build(const dawg_base_type dawg_idx, const base_type dict_idx)
+    {
+        if (m_is_fixed[dict_idx]) {
+            return m_counts[dict_idx];
+        }
+        m_is_fixed[dict_idx] = true;
+
+        // Leaves are not enumerated, but counted.
+        uint64_t count = 0;
+        dawg_base_type dawg_child_idx = m_dawg.child(dawg_idx);
+        if (m_dawg.is_leaf(dawg_child_idx)) {
+            count = 1;
+            dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+        }
+
+        if (dawg_child_idx != 0) {
+            m_guide[dict_idx].first = m_dawg.label(dawg_child_idx);
+        }
+        while (dawg_child_idx != 0) {
+            const label_type label = m_dawg.label(dawg_child_idx);
+            const base_type dict_child_idx = dict_idx ^ unit::offset(m_units[dict_idx]) ^ label;
+            count += build(dawg_child_idx, dict_child_idx);
+
+            dawg_child_idx = m_dawg.sibling(dawg_child_idx);
+            m_guide[dict_child_idx].second = (dawg_child_idx != 0) ? m_dawg.label(dawg_child_idx) : 0;
+        }
+
+        m_counts[dict_idx] = static_cast<base_type>(std::min<uint64_t>(count, std::numeric_limits<base_type>::max()));
+        return count;
+    }
+
+private:
+    const dawg_dict<TChar, TBase, TValue>& m_dawg;
+    const std::vector<base_type>& m_units;
+
+    std::vector<std::pair<label_type, label_type>> m_guide;
+    std::vector<base_type> m_counts;
+    std::vector<bool> m_is_fixed;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_GUIDE_BUILDER_H_ */
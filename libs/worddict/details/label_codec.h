@@ -0,0 +1,129 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_LABEL_CODEC_H_
+#define _WORDDICT_WORDDICT_LABEL_CODEC_H_
+
+#include <string>
+#include <vector>
+
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Coding of characters to labels of transitions.
+ *
+ *  If the label is narrower than the character, the character is coded by
+ *  1-3 byte labels like UTF-8 codes the code point: the coding keeps the
+ *  order of keys and has no zero labels, which are reserved for leaves.
+ */
+template<typename TChar, typename TBase, typename TValue>
+struct label_codec final
+{
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+
+    static constexpr size_type max_labels = (sizeof(label_type) < sizeof(uchar_type)) ? 3 : 1;
+
+    /*
+     *  \brief  Codes the character.
+     *  \return count of labels.
+     */
+    static constexpr size_type encode(const char_type ch, label_type* p_labels)
+    {
+        const uchar_type c = static_cast<uchar_type>(ch);
+        if constexpr (max_labels == 1) {
+            p_labels[0] = c;
+            return 1;
+        } else {
+            if (c < 0x80) {
+                p_labels[0] = static_cast<label_type>(c);
+                return 1;
+            } else if (c < 0x800) {
+                p_labels[0] = static_cast<label_type>(0xC0 | (c >> 6));
+                p_labels[1] = static_cast<label_type>(0x80 | (c & 0x3F));
+                return 2;
+            }
+            p_labels[0] = static_cast<label_type>(0xE0 | (c >> 12));
+            p_labels[1] = static_cast<label_type>(0x80 | ((c >> 6) & 0x3F));
+            p_labels[2] = static_cast<label_type>(0x80 | (c & 0x3F));
+            return 3;
+        }
+    }
+
+    /*
+     *  \brief  Decodes the character.
+     *  \return count of labels of the character.
+     */
+    static size_type decode(const label_type* p_labels, char_type& ch)
+    {
+        if constexpr (max_labels == 1) {
+            ch = static_cast<char_type>(p_labels[0]);
+            return 1;
+        } else {
+            if (p_labels[0] < 0x80) {
+                ch = static_cast<char_type>(p_labels[0]);
+                return 1;
+            } else if (p_labels[0] < 0xE0) {
+                ch = static_cast<char_type>(((p_labels[0] & 0x1F) << 6) | (p_labels[1] & 0x3F));
+                return 2;
+            }
+            ch = static_cast<char_type>(((p_labels[0] & 0x0F) << 12) | ((p_labels[1] & 0x3F) << 6) | (p_labels[2] & 0x3F));
+            return 3;
+        }
+    }
+
+    /*
+     *  \brief  Returns the count of labels of the character by its first label.
+     */
+    static constexpr size_type length(const label_type lead)
+    {
+        return ((max_labels == 1) || (lead < 0x80)) ? 1 : ((lead < 0xE0) ? 2 : 3);
+    }
+
+    static void decode(const label_type* p_labels, const size_type len, std::basic_string<char_type>& key)
+    {
+        key.clear();
+        for (size_type i = 0; i < len; ) {
+            char_type ch;
+            i += decode(p_labels + i, ch);
+            key.push_back(ch);
+        }
+    }
+
+    static void encode(const char_type* p_key, const size_type len, std::vector<label_type>& labels)
+    {
+        labels.resize(len * max_labels);
+        size_type count = 0;
+        for (size_type i = 0; i < len; ++i) {
+            count += encode(p_key[i], labels.data() + count);
+        }
+        labels.resize(count);
+    }
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_LABEL_CODEC_H_ */
@@ -0,0 +1,194 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_LZ_CODEC_H_
+#define _WORDDICT_WORDDICT_LZ_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Fast LZ77 codec in the LZ4 block format: sequences of the token
+ *          (lengths of literals and of the match), literals, the 16-bit
+ *          offset of the match and extra bytes of lengths.
+ *
+ *  The compressor is greedy and finds matches by the hash table of 4-byte
+ *  prefixes. The decompressor checks all bounds, so the corrupted input
+ *  is rejected.
+ */
+struct lz_codec final
+{
+    static constexpr size_t min_match = 4;
+    static constexpr size_t hash_bits = 12;
+    static constexpr size_t max_offset = 65535;
+    /// The last match starts at least 12 bytes before the end of the input,
+    /// the last 5 bytes are always literals.
+    static constexpr size_t match_limit = 12;
+    static constexpr size_t last_literals = 5;
+
+    /*
+     *  \brief  Appends the compressed input to the output.
+     */
+    static void compress(const void* p_src, const size_t size, std::vector<uint8_t>& out)
+    {
+        const uint8_t* p_begin = static_cast<const uint8_t*>(p_src);
+        const uint8_t* p_end = p_begin + size;
+        const uint8_t* p_anchor = p_begin;
+
+        if (size > match_limit) {
+            uint32_t table[size_t(1) << hash_bits] = {0};
+            const uint8_t* p_limit = p_end - match_limit;
+            for (const uint8_t* p = p_begin; p < p_limit; ) {
+                const uint32_t seq = read32(p);
+                const uint32_t h = hash(seq);
+                const uint8_t* p_ref = p_begin + table[h];
+                table[h] = static_cast<uint32_t>(p - p_begin);
+                if ((p_ref >= p) || ((size_t)(p - p_ref) > max_offset) || (read32(p_ref) != seq)) {
+                    ++p;
+                    continue;
+                }
+
+                size_t match = min_match;
+                while ((p + match < p_end - last_literals) && (p_ref[match] == p[match])) {
+                    ++match;
+                }
+                put_sequence(out, p_anchor, p - p_anchor, p - p_ref, match);
+                p += match;
+                p_anchor = p;
+            }
+        }
+        put_sequence(out, p_anchor, p_end - p_anchor, 0, 0);
+    }
+
+    /*
+     *  \brief  Decompresses exactly size bytes.
+     *  \return false if the input is malformed.
+     */
+    static bool decompress(const void* p_src, const size_t src_size, void* p_dst, const size_t size)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(p_src);
+        const uint8_t* p_end = p + src_size;
+        uint8_t* p_out_begin = static_cast<uint8_t*>(p_dst);
+        uint8_t* p_out = p_out_begin;
+        uint8_t* p_out_end = p_out_begin + size;
+
+        while (p < p_end) {
+            const uint8_t token = *p++;
+            size_t literals = token >> 4;
+            if ((literals == 15) && ! get_length(p, p_end, literals)) {
+                return false;
+            }
+            if (((size_t)(p_end - p) < literals) || ((size_t)(p_out_end - p_out) < literals)) {
+                return false;
+            }
+            if (literals != 0) {
+                std::memcpy(p_out, p, literals);
+            }
+            p += literals;
+            p_out += literals;
+            if (p == p_end) {
+                break;
+            }
+
+            if ((p_end - p) < 2) {
+                return false;
+            }
+            const size_t offset = p[0] | (size_t(p[1]) << 8);
+            p += 2;
+            size_t match = token & 15;
+            if ((match == 15) && ! get_length(p, p_end, match)) {
+                return false;
+            }
+            match += min_match;
+            if ((offset == 0) || (offset > (size_t)(p_out - p_out_begin)) || ((size_t)(p_out_end - p_out) < match)) {
+                return false;
+            }
+            // Matches may overlap the output.
+            const uint8_t* p_ref = p_out - offset;
+            for (size_t i = 0; i < match; ++i) {
+                p_out[i] = p_ref[i];
+            }
+            p_out += match;
+        }
+        return p_out == p_out_end;
+    }
+
+private:
+    static uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t hash(const uint32_t seq) { return (seq * 2654435761U) >> (32 - hash_bits); }
+
+    static bool get_length(const uint8_t*& p, const uint8_t* p_end, size_t& length)
+    {
+        uint8_t b;
+        do {
+            if (p == p_end) {
+                return false;
+            }
+            b = *p++;
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+
+    static void put_length(std::vector<uint8_t>& out, size_t length)
+    {
+        for (; length >= 255; length -= 255) {
+            out.push_back(255);
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    /*
+     *  \brief  Appends the sequence, the last one has no match.
+     */
+    static void put_sequence(std::vector<uint8_t>& out, const uint8_t* p_literals, const size_t literals,
+                             const size_t offset, const size_t match)
+    {
+        const size_t match_code = (match != 0) ? (match - min_match) : 0;
+        out.push_back(static_cast<uint8_t>(((literals < 15 ? literals : 15) << 4) | (match_code < 15 ? match_code : 15)));
+        if (literals >= 15) {
+            put_length(out, literals - 15);
+        }
+        out.insert(out.end(), p_literals, p_literals + literals);
+        if (match != 0) {
+            out.push_back(static_cast<uint8_t>(offset & 0xFF));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (match_code >= 15) {
+                put_length(out, match_code - 15);
+            }
+        }
+    }
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_LZ_CODEC_H_ */
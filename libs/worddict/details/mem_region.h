@@ -0,0 +1,223 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_MEM_REGION_H_
+#define _WORDDICT_WORDDICT_MEM_REGION_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Pages which back the arrays of the loaded dictionary.
+ */
+enum class page_policy
+{
+    regular,            ///< Regular pages.
+    transparent_huge,   ///< Transparent huge pages (madvise(MADV_HUGEPAGE)).
+    explicit_huge       ///< Explicit huge pages (MAP_HUGETLB), THP if unavailable.
+};
+
+namespace details {
+
+/*
+ *  \brief  Memory region owned by the loaded dictionary: anonymous memory
+ *          or read-only mapping of the file.
+ */
+class mem_region final
+{
+public:
+    static constexpr size_t huge_page_size = size_t(1) << 21;
+
+    mem_region() {}
+
+    mem_region(const mem_region&) = delete;
+    mem_region(mem_region&& other)
+        : m_p_addr(std::exchange(other.m_p_addr, nullptr))
+        , m_size(std::exchange(other.m_size, 0))
+        , m_map_size(std::exchange(other.m_map_size, 0))
+        , m_is_huge(std::exchange(other.m_is_huge, false))
+        , m_is_mapped(std::exchange(other.m_is_mapped, false))
+    {}
+
+    ~mem_region() { release(); }
+
+    mem_region& operator=(const mem_region&) = delete;
+    mem_region& operator=(mem_region&& other)
+    {
+        if (this != &other) {
+            release();
+            m_p_addr = std::exchange(other.m_p_addr, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_map_size = std::exchange(other.m_map_size, 0);
+            m_is_huge = std::exchange(other.m_is_huge, false);
+            m_is_mapped = std::exchange(other.m_is_mapped, false);
+        }
+        return *this;
+    }
+
+    /*
+     *  \brief  Allocates writable anonymous memory.
+     */
+    bool allocate(const size_t size, const page_policy policy)
+    {
+        release();
+        if (size == 0) {
+            return false;
+        }
+
+        if (policy == page_policy::explicit_huge) {
+            const size_t map_size = align_up(size, huge_page_size);
+            void* p_addr = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p_addr != MAP_FAILED) {
+                assign(p_addr, size, map_size, true);
+                return true;
+            }
+        }
+
+        if (policy == page_policy::regular) {
+            void* p_addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p_addr == MAP_FAILED) {
+                return false;
+            }
+            assign(p_addr, size, size, false);
+            return true;
+        }
+
+        // Transparent huge pages: the region is aligned to the huge page to
+        // let the kernel back all of it with huge pages.
+        const size_t map_size = align_up(size, huge_page_size);
+        void* p_raw = ::mmap(nullptr, map_size + huge_page_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p_raw == MAP_FAILED) {
+            return false;
+        }
+
+        const uintptr_t raw = reinterpret_cast<uintptr_t>(p_raw);
+        const uintptr_t aligned = align_up(raw, huge_page_size);
+        if (aligned != raw) {
+            ::munmap(p_raw, aligned - raw);
+        }
+        if (aligned + map_size != raw + map_size + huge_page_size) {
+            ::munmap(reinterpret_cast<void*>(aligned + map_size), raw + huge_page_size - aligned);
+        }
+
+        void* p_addr = reinterpret_cast<void*>(aligned);
+        ::madvise(p_addr, map_size, MADV_HUGEPAGE);
+        assign(p_addr, size, map_size, true);
+        return true;
+    }
+
+    /*
+     *  \brief  Maps the file read-only. Explicit huge pages can not back
+     *          the mapping of the regular file, so they are replaced by
+     *          transparent huge pages.
+     *  \param  populate - prefault the whole mapping (MAP_POPULATE).
+     */
+    bool map(const std::string& path, const page_policy policy, const bool populate = false)
+    {
+        release();
+
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if ((::fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+            ::close(fd);
+            return false;
+        }
+
+        const size_t size = st.st_size;
+        void* p_addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+        ::close(fd);
+        if (p_addr == MAP_FAILED) {
+            return false;
+        }
+
+        const bool is_huge = (policy != page_policy::regular);
+        if (is_huge) {
+            ::madvise(p_addr, size, MADV_HUGEPAGE);
+        }
+        assign(p_addr, size, size, is_huge);
+        m_is_mapped = true;
+        return true;
+    }
+
+    /*
+     *  \brief  Makes the region read-only.
+     */
+    bool protect() { return (m_p_addr != nullptr) && (::mprotect(m_p_addr, m_map_size, PROT_READ) == 0); }
+
+    void release()
+    {
+        if (m_p_addr != nullptr) {
+            ::munmap(m_p_addr, m_map_size);
+        }
+        m_p_addr = nullptr;
+        m_size = 0;
+        m_map_size = 0;
+        m_is_huge = false;
+        m_is_mapped = false;
+    }
+
+    void* data() const { return m_p_addr; }
+
+    bool empty() const { return m_p_addr == nullptr; }
+
+    bool is_huge() const { return m_is_huge; }
+
+    bool is_mapped() const { return m_is_mapped; }
+
+    size_t size() const { return m_size; }
+
+private:
+    static size_t align_up(const size_t value, const size_t align) { return (value + align - 1) & ~(align - 1); }
+
+    void assign(void* p_addr, const size_t size, const size_t map_size, const bool is_huge)
+    {
+        m_p_addr = p_addr;
+        m_size = size;
+        m_map_size = map_size;
+        m_is_huge = is_huge;
+    }
+
+private:
+    void* m_p_addr = nullptr;
+    size_t m_size = 0;
+    size_t m_map_size = 0;
+    bool m_is_huge = false;
+    bool m_is_mapped = false;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_MEM_REGION_H_ */
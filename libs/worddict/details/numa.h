@@ -0,0 +1,109 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_NUMA_H_
+#define _WORDDICT_WORDDICT_NUMA_H_
+
+#include <sched.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Parses the list of CPUs (or nodes) in the format of sysfs:
+ *          "0-3,8,10-11".
+ */
+inline std::vector<int> parse_cpu_list(const std::string& str)
+{
+    std::vector<int> cpus;
+    std::istringstream in(str);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty() || (range[0] < '0') || (range[0] > '9')) {
+            continue;
+        }
+
+        const std::string::size_type dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.emplace_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/*
+ *  \brief  Returns CPUs of the online NUMA nodes which have CPUs. The list
+ *          is empty if the topology is not available.
+ *
+ *  Ids of online nodes may have gaps (offline or hot-removed nodes), so
+ *  they are read from the list of online nodes. Nodes without CPUs (memory
+ *  only) have no readers and are skipped.
+ */
+inline std::vector<std::vector<int>> numa_nodes()
+{
+    std::vector<std::vector<int>> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string node_list;
+    if (! online.is_open() || ! std::getline(online, node_list)) {
+        return nodes;
+    }
+
+    for (const int node : parse_cpu_list(node_list)) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpu_list;
+        if (! in.is_open() || ! std::getline(in, cpu_list)) {
+            continue;
+        }
+
+        std::vector<int> cpus = parse_cpu_list(cpu_list);
+        if (! cpus.empty()) {
+            nodes.emplace_back(std::move(cpus));
+        }
+    }
+    return nodes;
+}
+
+/*
+ *  \brief  Binds the calling thread to the CPUs.
+ */
+inline bool bind_to_cpus(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : cpus) {
+        if ((cpu >= 0) && (cpu < CPU_SETSIZE)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return (CPU_COUNT(&set) > 0) && (::sched_setaffinity(0, sizeof(set), &set) == 0);
+}
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_NUMA_H_ */
@@ -0,0 +1,245 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_PACKED_VALUES_H_
+#define _WORDDICT_WORDDICT_PACKED_VALUES_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Coding of the values of the dictionary.
+ */
+enum class value_coding
+{
+    inline_units,       ///< Values are stored in the leaf units of the double-array.
+    packed,             ///< Distinct values are bit-packed at the minimum common width.
+    frame_of_reference, ///< Distinct values are bit-packed by blocks, each with its own base and width.
+    transitions         ///< Values are pushed to outputs of transitions (see fst_dict).
+};
+
+namespace details {
+
+/*
+ *  \brief  Bit-packed array of values.
+ *
+ *  The array is the sequence of 64-bit words, so it can be used in place in
+ *  the mapped file:
+ *  - count of values;
+ *  - count of blocks;
+ *  - header of every block: the base value, the bit offset of the block
+ *    (upper 56 bits) and the width of the packed values (lower 8 bits);
+ *  - packed values followed by the padding word.
+ *
+ *  Every value is stored as the difference with the base value of its
+ *  block, so the decoding does not depend on the coding of the array.
+ */
+template<typename TValue>
+class packed_values final
+{
+public:
+    using value_type = TValue;
+
+    static constexpr size_t block_size = 64;
+
+    packed_values() {}
+
+    packed_values(const packed_values&) = delete;
+    packed_values(packed_values&& other) { *this = std::move(other); }
+
+    packed_values& operator=(const packed_values&) = delete;
+    packed_values& operator=(packed_values&& other)
+    {
+        if (this != &other) {
+            m_words = std::move(other.m_words);
+            m_p_words = other.m_p_words;
+            m_words_count = other.m_words_count;
+            m_p_headers = other.m_p_headers;
+            m_p_data = other.m_p_data;
+            m_size = other.m_size;
+            other.clear();
+        }
+        return *this;
+    }
+
+    /*
+     *  \brief  Decodes the value (branch-free).
+     */
+    value_type operator[](const size_t idx) const
+    {
+        const uint64_t* p_header = m_p_headers + 2 * (idx / block_size);
+        const uint64_t width = p_header[1] & 0xFF;
+        const uint64_t bit = (p_header[1] >> 8) + (idx % block_size) * width;
+        const uint64_t* p_word = m_p_data + (bit >> 6);
+        const uint64_t shift = bit & 63;
+
+        const uint64_t raw = (p_word[0] >> shift) | ((p_word[1] << 1) << (63 - shift));
+        const uint64_t mask = (uint64_t(2) << (width - 1)) - 1;
+        return static_cast<value_type>(p_header[0] + (raw & mask));
+    }
+
+    /*
+     *  \brief  Encodes values. Bases and widths are taken from minimums and
+     *          maximums, so values may be unsorted, e.g. outputs of units.
+     */
+    void assign(const std::vector<value_type>& values, const value_coding coding)
+    {
+        clear();
+
+        const size_t blocks_count = (values.size() + block_size - 1) / block_size;
+        m_words.assign(2 + 2 * blocks_count, 0);
+        m_words[0] = values.size();
+        m_words[1] = blocks_count;
+
+        const auto global = std::minmax_element(values.cbegin(), values.cend());
+        const uint64_t global_base = values.empty() ? 0 : (uint64_t)*global.first;
+        const uint64_t global_width = values.empty() ? 1 : bit_width((uint64_t)*global.second - global_base);
+
+        std::vector<uint64_t> data;
+        uint64_t bit = 0;
+        for (size_t block = 0; block < blocks_count; ++block) {
+            const size_t begin = block * block_size;
+            const size_t end = std::min(begin + block_size, values.size());
+
+            uint64_t base = global_base;
+            uint64_t width = global_width;
+            if (coding == value_coding::frame_of_reference) {
+                const auto local = std::minmax_element(values.cbegin() + begin, values.cbegin() + end);
+                base = *local.first;
+                width = bit_width((uint64_t)*local.second - base);
+            }
+
+            m_words[2 + 2 * block] = base;
+            m_words[2 + 2 * block + 1] = (bit << 8) | width;
+            for (size_t i = begin; i < end; ++i) {
+                put(data, bit, (uint64_t)values[i] - base, width);
+                bit += width;
+            }
+        }
+        data.resize((bit + 63) / 64 + 1, 0);
+        m_words.insert(m_words.end(), data.cbegin(), data.cend());
+
+        attach(m_words.data(), m_words.size());
+    }
+
+    /*
+     *  \brief  Takes the ownership of the encoded array.
+     *  \return false if the array is malformed.
+     */
+    bool assign(std::vector<uint64_t>&& words)
+    {
+        clear();
+        m_words = std::move(words);
+        if (! attach(m_words.data(), m_words.size())) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Uses the encoded array in place.
+     *  \return false if the array is malformed: some block is out of the
+     *          array, so the decoding would read after its padding word.
+     */
+    bool attach(const uint64_t* p_words, const size_t words_count)
+    {
+        if ((words_count < 3) || (p_words[1] != (p_words[0] + block_size - 1) / block_size)
+            || (p_words[1] > (words_count - 3) / 2)) {
+            return false;
+        }
+
+        // The padding word follows the last packed value.
+        const uint64_t data_bits = (words_count - 3 - 2 * p_words[1]) * 64;
+        for (uint64_t block = 0; block < p_words[1]; ++block) {
+            const uint64_t header = p_words[2 + 2 * block + 1];
+            const uint64_t width = header & 0xFF;
+            const uint64_t count = std::min<uint64_t>(block_size, p_words[0] - block * block_size);
+            if ((width == 0) || (width > 64) || ((header >> 8) > data_bits)
+                || (count * width > data_bits - (header >> 8))) {
+                return false;
+            }
+        }
+
+        m_p_words = p_words;
+        m_words_count = words_count;
+        m_size = p_words[0];
+        m_p_headers = p_words + 2;
+        m_p_data = m_p_headers + 2 * p_words[1];
+        return true;
+    }
+
+    void clear()
+    {
+        m_words.clear();
+        m_p_words = nullptr;
+        m_words_count = 0;
+        m_p_headers = nullptr;
+        m_p_data = nullptr;
+        m_size = 0;
+    }
+
+    const uint64_t* data() const { return m_p_words; }
+
+    bool empty() const { return m_p_words == nullptr; }
+
+    size_t size() const { return m_size; }
+
+    size_t words_count() const { return m_words_count; }
+
+private:
+    static uint64_t bit_width(uint64_t value)
+    {
+        uint64_t width = 1;
+        while ((value >>= 1) != 0) {
+            ++width;
+        }
+        return width;
+    }
+
+    static void put(std::vector<uint64_t>& data, const uint64_t bit, const uint64_t value, const uint64_t width)
+    {
+        data.resize((bit + width + 63) / 64 + 1, 0);
+        const uint64_t shift = bit & 63;
+        data[bit >> 6] |= value << shift;
+        if ((shift + width) > 64) {
+            data[(bit >> 6) + 1] |= value >> (64 - shift);
+        }
+    }
+
+private:
+    std::vector<uint64_t> m_words;
+
+    const uint64_t* m_p_words = nullptr;
+    size_t m_words_count = 0;
+    const uint64_t* m_p_headers = nullptr;
+    const uint64_t* m_p_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_PACKED_VALUES_H_ */
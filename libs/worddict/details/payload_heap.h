@@ -0,0 +1,302 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_PAYLOAD_HEAP_H_
+#define _WORDDICT_WORDDICT_PAYLOAD_HEAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/dict_file.h"
+#include "worddict/details/mem_region.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Header of the file of the payload heap.
+ *
+ *  The file consists of the header, offsets of payloads (count + 1 words)
+ *  and bytes of payloads. Offsets and bytes are checked by one checksum.
+ */
+struct payload_header final
+{
+    static constexpr uint64_t magic_value = 0x5344414F4C594150ULL; // "PAYLOADS"
+    static constexpr uint64_t version_value = 1;
+
+    uint64_t magic;
+    uint64_t version;
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t data_crc;
+    uint64_t header_crc; ///< Checksum of the previous fields.
+};
+
+static_assert(sizeof(payload_header) == 6 * sizeof(uint64_t), "payload_header: unexpected padding");
+
+/*
+ *  \brief  Contiguous heap of byte payloads addressed by their indexes.
+ *
+ *  The heap is owned by vectors (built or loaded heap) or by the read-only
+ *  mapping of the file, so payloads are returned as views without copies.
+ */
+class payload_heap final
+{
+public:
+    payload_heap() {}
+
+    payload_heap(const payload_heap&) = delete;
+    payload_heap(payload_heap&& other) { *this = std::move(other); }
+
+    payload_heap& operator=(const payload_heap&) = delete;
+    payload_heap& operator=(payload_heap&& other)
+    {
+        if (this != &other) {
+            m_offsets = std::move(other.m_offsets);
+            m_bytes = std::move(other.m_bytes);
+            m_region = std::move(other.m_region);
+            m_p_offsets = std::exchange(other.m_p_offsets, nullptr);
+            m_p_bytes = std::exchange(other.m_p_bytes, nullptr);
+            m_count = std::exchange(other.m_count, 0);
+        }
+        return *this;
+    }
+
+    /*
+     *  \param  offsets - offsets of payloads in bytes, count + 1 offsets.
+     */
+    bool assign(std::vector<uint64_t>&& offsets, std::string&& bytes)
+    {
+        clear();
+        if (offsets.empty() || (offsets.front() != 0) || (offsets.back() != bytes.size())) {
+            return false;
+        }
+        m_offsets = std::move(offsets);
+        m_bytes = std::move(bytes);
+        m_p_offsets = m_offsets.data();
+        m_p_bytes = m_bytes.data();
+        m_count = m_offsets.size() - 1;
+        return true;
+    }
+
+    void clear()
+    {
+        m_offsets.clear();
+        m_bytes.clear();
+        m_region.release();
+        m_p_offsets = nullptr;
+        m_p_bytes = nullptr;
+        m_count = 0;
+    }
+
+    size_t count() const { return m_count; }
+
+    bool empty() const { return m_count == 0; }
+
+    bool is_mapped() const { return m_region.is_mapped(); }
+
+    bool load(const std::string& path)
+    {
+        clear();
+
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in.tellg();
+        payload_header header;
+        if (! in.seekg(0) || ! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || ! is_valid_header(header, file_size)) {
+            return false;
+        }
+
+        std::vector<uint64_t> offsets(header.count + 1);
+        std::string bytes(header.bytes, '\0');
+        if (! in.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t))
+            || ! in.read(bytes.data(), bytes.size())) {
+            return false;
+        }
+        if (data_crc(offsets.data(), header.count, bytes.data(), header.bytes) != header.data_crc) {
+            return false;
+        }
+        return assign(std::move(offsets), std::move(bytes)) && is_valid_offsets(header.bytes);
+    }
+
+    /*
+     *  \brief  Maps the file read-only and checks it by the checksum.
+     *  \param  populate - prefault the whole mapping (MAP_POPULATE).
+     */
+    bool map(const std::string& path, const page_policy policy = page_policy::regular, const bool populate = false)
+    {
+        clear();
+
+        payload_header header;
+        if (! m_region.map(path, policy, populate) || (m_region.size() < sizeof(header))) {
+            clear();
+            return false;
+        }
+        std::memcpy(&header, m_region.data(), sizeof(header));
+        if (! is_valid_header(header, m_region.size())) {
+            clear();
+            return false;
+        }
+
+        const char* p_data = static_cast<const char*>(m_region.data());
+        m_p_offsets = reinterpret_cast<const uint64_t*>(p_data + sizeof(header));
+        m_p_bytes = p_data + sizeof(header) + (header.count + 1) * sizeof(uint64_t);
+        m_count = header.count;
+        if ((data_crc(m_p_offsets, m_count, m_p_bytes, header.bytes) != header.data_crc) || ! is_valid_offsets(header.bytes)) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    std::string_view operator[](const size_t idx) const
+    {
+        return std::string_view(m_p_bytes + m_p_offsets[idx], m_p_offsets[idx + 1] - m_p_offsets[idx]);
+    }
+
+    bool save(const std::string& path) const
+    {
+        payload_header header = {};
+        header.magic = payload_header::magic_value;
+        header.version = payload_header::version_value;
+        header.count = m_count;
+        header.bytes = (m_p_offsets != nullptr) ? m_p_offsets[m_count] : 0;
+
+        const uint64_t empty_offset = 0;
+        const uint64_t* p_offsets = (m_p_offsets != nullptr) ? m_p_offsets : &empty_offset;
+        header.data_crc = data_crc(p_offsets, m_count, m_p_bytes, header.bytes);
+        header.header_crc = crc32c(&header, offsetof(payload_header, header_crc));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(p_offsets), (m_count + 1) * sizeof(uint64_t));
+        out.write(m_p_bytes, header.bytes);
+        return out.good();
+    }
+
+    /*
+     *  \brief  Returns the size of payloads in bytes.
+     */
+    size_t size_bytes() const { return (m_p_offsets != nullptr) ? m_p_offsets[m_count] : 0; }
+
+private:
+    static uint64_t data_crc(const uint64_t* p_offsets, const uint64_t count, const char* p_bytes, const uint64_t bytes)
+    {
+        const uint32_t crc = crc32c(p_offsets, (count + 1) * sizeof(uint64_t));
+        return (bytes != 0) ? crc32c(p_bytes, bytes, crc) : crc;
+    }
+
+    static bool is_valid_header(const payload_header& h, const uint64_t file_size)
+    {
+        if ((h.magic != payload_header::magic_value) || (h.version != payload_header::version_value)
+            || (h.header_crc != crc32c(&h, offsetof(payload_header, header_crc)))) {
+            return false;
+        }
+        return (h.count < file_size) && (file_size == sizeof(h) + (h.count + 1) * sizeof(uint64_t) + h.bytes);
+    }
+
+    /*
+     *  \brief  Checks that offsets are ascending and cover the bytes.
+     */
+    bool is_valid_offsets(const uint64_t bytes) const
+    {
+        if ((m_p_offsets[0] != 0) || (m_p_offsets[m_count] != bytes)) {
+            return false;
+        }
+        for (size_t i = 0; i < m_count; ++i) {
+            if (m_p_offsets[i] > m_p_offsets[i + 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<uint64_t> m_offsets;
+    std::string m_bytes;
+    mem_region m_region;
+
+    const uint64_t* m_p_offsets = nullptr;
+    const char* m_p_bytes = nullptr;
+    size_t m_count = 0;
+};
+
+/*
+ *  \brief  Builder of the payload heap: equal payloads are stored once.
+ */
+class payload_heap_builder final
+{
+public:
+    size_t count() const { return m_offsets.size() - 1; }
+
+    /*
+     *  \brief  Returns the index of the payload in the heap, or the index
+     *          which the payload gets by insert() if it is not inserted yet.
+     */
+    size_t index(const std::string_view& payload) const
+    {
+        const auto it = m_indexes.find(std::string(payload));
+        return (it != m_indexes.cend()) ? it->second : count();
+    }
+
+    /*
+     *  \brief  Returns the index of the payload in the heap.
+     */
+    size_t insert(const std::string_view& payload)
+    {
+        const auto it = m_indexes.emplace(std::string(payload), m_offsets.size() - 1);
+        if (it.second) {
+            m_bytes.append(payload.data(), payload.size());
+            m_offsets.push_back(m_bytes.size());
+        }
+        return it.first->second;
+    }
+
+    void clear()
+    {
+        m_indexes.clear();
+        m_offsets.assign(1, 0);
+        m_bytes.clear();
+    }
+
+    bool finish(payload_heap& heap)
+    {
+        const bool rc = heap.assign(std::move(m_offsets), std::move(m_bytes));
+        clear();
+        return rc;
+    }
+
+private:
+    std::unordered_map<std::string, size_t> m_indexes;
+    std::vector<uint64_t> m_offsets = std::vector<uint64_t>(1, 0);
+    std::string m_bytes;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_PAYLOAD_HEAP_H_ */
@@ -0,0 +1,162 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_SCANNER_BUILDER_H_
+#define _WORDDICT_WORDDICT_SCANNER_BUILDER_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/dawg_dict.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Node of the scanning automaton.
+ */
+template<typename TBase, typename TValue>
+struct scanner_node final
+{
+    TBase first_child;  ///< Index of the first child, children are contiguous.
+    TBase children;     ///< Count of children.
+    TBase fail;         ///< Longest proper suffix of the node, which is a node.
+    TBase output;       ///< Longest proper suffix of the node, which is a key, or 0.
+    TBase depth;        ///< Length of the path of the node in characters.
+    TValue value;       ///< Value of the key of the node or -1.
+};
+
+/*
+ *  \brief  Builder of the Aho-Corasick automaton.
+ *
+ *  The DAWG is expanded into the trie in the breadth-first order, so the
+ *  children of every node are contiguous and sorted by labels, and the
+ *  failure links are computed in the same order.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename char_traits<TChar>::value_type>
+class scanner_builder final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dawg_base_type = typename details::traits<TChar, TBase, TValue>::dawg_base_type;
+    using node_type      = scanner_node<base_type, value_type>;
+
+    /// Count of the leading bytes of labels, which are counted in the depth
+    /// of the node: continuation bytes of the multi-byte code are skipped.
+    static constexpr bool is_multibyte = (sizeof(label_type) < sizeof(typename details::traits<TChar, TBase, TValue>::uchar_type));
+
+    explicit scanner_builder(const dawg_dict<TChar, TBase, TValue>& dawg)
+        : m_dawg(dawg)
+    {}
+
+    bool build(std::vector<node_type>& nodes, std::vector<label_type>& labels)
+    {
+        nodes.clear();
+        labels.clear();
+        nodes.push_back({0, 0, 0, 0, 0, -1});
+        labels.push_back(0);
+        if (m_dawg.size() <= 1) {
+            return true;
+        }
+
+        // Expands the DAWG into the trie.
+        std::vector<dawg_base_type> states(1, m_dawg.root());
+        std::vector<std::pair<label_type, dawg_base_type>> children;
+        for (size_type node = 0; node < nodes.size(); ++node) {
+            children.clear();
+            for (dawg_base_type idx = m_dawg.child(states[node]); idx != 0; idx = m_dawg.sibling(idx)) {
+                if (m_dawg.is_leaf(idx)) {
+                    nodes[node].value = m_dawg.value(idx);
+                } else {
+                    children.emplace_back(m_dawg.label(idx), idx);
+                }
+            }
+            std::sort(children.begin(), children.end());
+
+            nodes[node].first_child = nodes.size();
+            nodes[node].children = children.size();
+            for (const std::pair<label_type, dawg_base_type>& child : children) {
+                const base_type depth = nodes[node].depth + (is_char_begin(child.first) ? 1 : 0);
+                nodes.push_back({0, 0, 0, 0, depth, -1});
+                labels.push_back(child.first);
+                states.push_back(child.second);
+            }
+        }
+
+        // Failure and output links in the breadth-first order.
+        for (size_type node = 0; node < nodes.size(); ++node) {
+            const node_type& parent = nodes[node];
+            for (base_type child = parent.first_child; child < parent.first_child + parent.children; ++child) {
+                base_type fail = 0;
+                if (node != 0) {
+                    base_type state = parent.fail;
+                    while (true) {
+                        const base_type next = find_child(nodes, labels, state, labels[child]);
+                        if (next != 0) {
+                            fail = next;
+                            break;
+                        }
+                        if (state == 0) {
+                            break;
+                        }
+                        state = nodes[state].fail;
+                    }
+                }
+                nodes[child].fail = fail;
+                nodes[child].output = (nodes[fail].value >= 0) ? fail : nodes[fail].output;
+            }
+        }
+        return true;
+    }
+
+    static base_type find_child(const std::vector<node_type>& nodes, const std::vector<label_type>& labels,
+                                const base_type node, const label_type label)
+    {
+        const base_type first = nodes[node].first_child;
+        const base_type last = first + nodes[node].children;
+        const typename std::vector<label_type>::const_iterator it =
+            std::lower_bound(labels.cbegin() + first, labels.cbegin() + last, label);
+        return ((it != labels.cbegin() + last) && (*it == label)) ? (it - labels.cbegin()) : 0;
+    }
+
+private:
+    static bool is_char_begin(const label_type label)
+    {
+        if constexpr (is_multibyte) {
+            return (label & 0xC0) != 0x80;
+        } else {
+            return true;
+        }
+    }
+
+private:
+    const dawg_dict<TChar, TBase, TValue>& m_dawg;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_SCANNER_BUILDER_H_ */
@@ -0,0 +1,220 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_WORK_POOL_H_
+#define _WORDDICT_WORDDICT_WORK_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Pool of threads which run chunks of the job with work stealing.
+ *
+ *  Chunks are split evenly into ranges of workers. Every worker takes
+ *  chunks from the front of its own range, and the worker which has run
+ *  out of chunks steals the back half of the range of other worker. The
+ *  range is one atomic word (the first and the end chunks), so both are
+ *  done by the compare-and-swap without locks. Locks are taken only to
+ *  start the job and to wait for its end.
+ *
+ *  The calling thread is the worker 0, so the pool of the size 1 has no
+ *  threads.
+ */
+class work_pool final
+{
+public:
+    explicit work_pool(const size_t size)
+        : m_ranges(new range[size > 0 ? size : 1])
+        , m_size(size > 0 ? size : 1)
+    {
+        for (size_t worker = 1; worker < m_size; ++worker) {
+            m_threads.emplace_back([this, worker]() { thread_loop(worker); });
+        }
+    }
+
+    work_pool(const work_pool&) = delete;
+    work_pool& operator=(const work_pool&) = delete;
+
+    ~work_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_is_stopped = true;
+        }
+        m_start_cv.notify_all();
+        for (std::thread& t : m_threads) {
+            t.join();
+        }
+    }
+
+    /*
+     *  \brief  Runs job(worker, chunk) for all chunks and waits for them.
+     *          Jobs are not run concurrently. Jobs of more than max_chunks
+     *          chunks are run as the sequence of jobs of max_chunks chunks.
+     */
+    void run(const size_t chunks_count, const std::function<void(size_t, size_t)>& job)
+    {
+        if (chunks_count == 0) {
+            return;
+        }
+        const uint64_t count = (chunks_count < max_chunks) ? chunks_count : max_chunks;
+        for (size_t worker = 0; worker < m_size; ++worker) {
+            const uint64_t first = count * worker / m_size;
+            const uint64_t end = count * (worker + 1) / m_size;
+            m_ranges[worker].value.store(make_range(first, end), std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_p_job = &job;
+            m_running = m_size - 1;
+            ++m_generation;
+        }
+        m_start_cv.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this]() { return m_running == 0; });
+        m_p_job = nullptr;
+
+        // The rest of the huge job, if its chunks do not fit the range.
+        if (chunks_count > count) {
+            lock.unlock();
+            run(chunks_count - count, [&job, count](const size_t worker, const size_t chunk) {
+                job(worker, chunk + count);
+            });
+        }
+    }
+
+    size_t size() const { return m_size; }
+
+    /// Chunks are indexed by 32-bit halves of the range, so the end chunk
+    /// must fit 32 bits.
+    static constexpr uint64_t max_chunks = UINT32_MAX;
+
+private:
+    /*
+     *  \brief  Range of chunks of the worker on its own cache line.
+     */
+    struct alignas(64) range final
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static uint64_t make_range(const uint64_t first, const uint64_t end) { return (first << 32) | end; }
+
+    static uint64_t first(const uint64_t r) { return r >> 32; }
+
+    static uint64_t end(const uint64_t r) { return r & 0xFFFFFFFF; }
+
+    void thread_loop(const size_t worker)
+    {
+        uint64_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start_cv.wait(lock, [this, generation]() { return m_is_stopped || (m_generation != generation); });
+                if (m_is_stopped) {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            work(worker);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_running == 0) {
+                m_done_cv.notify_one();
+            }
+        }
+    }
+
+    void work(const size_t worker)
+    {
+        const std::function<void(size_t, size_t)>& job = *m_p_job;
+        size_t chunk;
+        while (pop(worker, chunk) || steal(worker, chunk)) {
+            job(worker, chunk);
+        }
+    }
+
+    bool pop(const size_t worker, size_t& chunk)
+    {
+        std::atomic<uint64_t>& value = m_ranges[worker].value;
+        uint64_t r = value.load(std::memory_order_relaxed);
+        while (first(r) < end(r)) {
+            if (value.compare_exchange_weak(r, make_range(first(r) + 1, end(r)), std::memory_order_relaxed)) {
+                chunk = first(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     *  \brief  Steals the back half of the range of other worker, keeps the
+     *          rest of the stolen chunks in the own range.
+     */
+    bool steal(const size_t worker, size_t& chunk)
+    {
+        for (size_t i = 1; i < m_size; ++i) {
+            std::atomic<uint64_t>& value = m_ranges[(worker + i) % m_size].value;
+            uint64_t r = value.load(std::memory_order_relaxed);
+            while (first(r) < end(r)) {
+                const uint64_t middle = first(r) + (end(r) - first(r)) / 2;
+                if (value.compare_exchange_weak(r, make_range(first(r), middle), std::memory_order_relaxed)) {
+                    chunk = middle;
+                    m_ranges[worker].value.store(make_range(middle + 1, end(r)), std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    std::unique_ptr<range[]> m_ranges;
+    const size_t m_size;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start_cv;
+    std::condition_variable m_done_cv;
+    const std::function<void(size_t, size_t)>* m_p_job = nullptr;
+    uint64_t m_generation = 0;
+    size_t m_running = 0;
+    bool m_is_stopped = false;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_WORK_POOL_H_ */
@@ -0,0 +1,332 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_XOR_FILTER_H_
+#define _WORDDICT_WORDDICT_XOR_FILTER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace wstux {
+namespace wd {
+namespace details {
+
+/*
+ *  \brief  Hash of the key fed label by label.
+ */
+class key_hasher final
+{
+public:
+    void add(const uint64_t label) { m_hash = (m_hash ^ label) * 0x100000001B3ULL; }
+
+    uint64_t value() const { return mix(m_hash); }
+
+    /*
+     *  \brief  Finalizer of MurmurHash3.
+     */
+    static uint64_t mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    uint64_t m_hash = 0xCBF29CE484222325ULL;
+};
+
+/*
+ *  \brief  Xor filter of hashes of keys (Graf, Lemire, "Xor Filters:
+ *          Faster and Smaller Than Bloom and Cuckoo Filters").
+ *
+ *  Every hash is mapped to three cells, one in each third of the array of
+ *  fingerprints, and the xor of the three cells is the fingerprint of the
+ *  hash. The query reads three cells, so the miss costs a few cache lines
+ *  at worst instead of the walk of the automaton. The filter has no false
+ *  negatives; false positives occur with the rate 2^-bits, and the filter
+ *  takes about 1.23 * bits bits per key.
+ *
+ *  Fingerprints of up to 8 bits are stored in bytes, wider ones in pairs
+ *  of bytes. Fingerprints are owned by the filter (built or loaded filter)
+ *  or by the mapping of the file of the dictionary.
+ */
+class xor_filter final
+{
+public:
+    static constexpr unsigned max_bits = 16;
+
+    xor_filter() {}
+
+    xor_filter(const xor_filter&) = delete;
+    xor_filter(xor_filter&& other) { *this = std::move(other); }
+
+    xor_filter& operator=(const xor_filter&) = delete;
+    xor_filter& operator=(xor_filter&& other)
+    {
+        if (this != &other) {
+            m_fingerprints = std::move(other.m_fingerprints);
+            m_p_fingerprints = std::exchange(other.m_p_fingerprints, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_block_size = std::exchange(other.m_block_size, 0);
+            m_seed = std::exchange(other.m_seed, 0);
+            m_bits = std::exchange(other.m_bits, 0);
+            m_bytes = std::exchange(other.m_bytes, 0);
+            m_mask = std::exchange(other.m_mask, 0);
+        }
+        return *this;
+    }
+
+    /*
+     *  \brief  Takes fingerprints of the saved filter.
+     *  \return false if the parameters do not match the size of fingerprints.
+     */
+    bool assign(std::vector<uint8_t>&& fingerprints, const uint64_t block_size, const uint64_t seed, const unsigned bits)
+    {
+        clear();
+        if (! is_valid(fingerprints.size(), block_size, bits)) {
+            return false;
+        }
+        m_fingerprints = std::move(fingerprints);
+        m_p_fingerprints = m_fingerprints.data();
+        m_size = m_fingerprints.size();
+        set_params(block_size, seed, bits);
+        return true;
+    }
+
+    /*
+     *  \brief  Uses fingerprints in place, e.g. in the mapped file. The
+     *          fingerprints must outlive the filter.
+     *  \return false if the parameters do not match the size of fingerprints.
+     */
+    bool attach(const uint8_t* p_fingerprints, const size_t size, const uint64_t block_size, const uint64_t seed,
+                const unsigned bits)
+    {
+        clear();
+        if (! is_valid(size, block_size, bits)) {
+            return false;
+        }
+        set_params(block_size, seed, bits);
+        m_p_fingerprints = p_fingerprints;
+        m_size = size;
+        return true;
+    }
+
+    /*
+     *  \brief  Returns true if fingerprints of the count of bits fill three
+     *          blocks of cells.
+     */
+    static bool is_valid(const uint64_t size, const uint64_t block_size, const unsigned bits)
+    {
+        return (bits != 0) && (bits <= max_bits) && (block_size != 0)
+            && (block_size <= size) && (size == 3 * block_size * cell_bytes(bits));
+    }
+
+    static unsigned cell_bytes(const unsigned bits) { return (bits <= 8) ? 1 : 2; }
+
+    /*
+     *  \brief  Returns the count of bits of fingerprints which gives the
+     *          false positive rate not greater than the rate.
+     */
+    static unsigned fingerprint_bits(const double rate)
+    {
+        if (! (rate > 0.0)) {
+            return max_bits;
+        }
+        const double bits = std::ceil(-std::log2(rate));
+        return (bits < 1.0) ? 1 : ((bits > max_bits) ? max_bits : static_cast<unsigned>(bits));
+    }
+
+    /*
+     *  \brief  Builds the filter of hashes; hashes are sorted and deduplicated.
+     *  \return false if the filter can not be built.
+     */
+    bool build(std::vector<uint64_t>& hashes, const unsigned bits)
+    {
+        /// Count of seeds tried before the build fails: the build with the
+        /// random seed succeeds with the probability close to 1.
+        constexpr size_t max_attempts = 64;
+
+        clear();
+        if ((bits == 0) || (bits > max_bits)) {
+            return false;
+        }
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        if (hashes.empty()) {
+            return true;
+        }
+
+        set_params((32 + (hashes.size() * 123) / 100 + 2) / 3, 0, bits);
+
+        const size_t capacity = 3 * m_block_size;
+        std::vector<uint64_t> xors(capacity);
+        std::vector<uint32_t> counts(capacity);
+        std::vector<size_t> queue;
+        std::vector<std::pair<uint64_t, size_t>> stack;
+        for (size_t attempt = 0; attempt < max_attempts; ++attempt) {
+            m_seed = key_hasher::mix(0x9E3779B97F4A7C15ULL * (attempt + 1));
+            std::fill(xors.begin(), xors.end(), 0);
+            std::fill(counts.begin(), counts.end(), 0);
+            for (const uint64_t h : hashes) {
+                const uint64_t x = seeded(h);
+                for (size_t i = 0; i < 3; ++i) {
+                    const size_t cell = position(x, i);
+                    xors[cell] ^= x;
+                    ++counts[cell];
+                }
+            }
+
+            // Peels cells of one hash, until all hashes are peeled.
+            queue.clear();
+            stack.clear();
+            for (size_t cell = 0; cell < capacity; ++cell) {
+                if (counts[cell] == 1) {
+                    queue.push_back(cell);
+                }
+            }
+            while (! queue.empty()) {
+                const size_t cell = queue.back();
+                queue.pop_back();
+                if (counts[cell] != 1) {
+                    continue;
+                }
+                const uint64_t x = xors[cell];
+                stack.emplace_back(x, cell);
+                for (size_t i = 0; i < 3; ++i) {
+                    const size_t other = position(x, i);
+                    xors[other] ^= x;
+                    if (--counts[other] == 1) {
+                        queue.push_back(other);
+                    }
+                }
+            }
+
+            if (stack.size() == hashes.size()) {
+                // Cells are assigned in the reverse order of peeling, so the
+                // peeled cell is the last unassigned cell of its hash.
+                m_fingerprints.assign(capacity * m_bytes, 0);
+                m_p_fingerprints = m_fingerprints.data();
+                m_size = m_fingerprints.size();
+                for (size_t i = stack.size(); i > 0; --i) {
+                    const uint64_t x = stack[i - 1].first;
+                    const size_t cell = stack[i - 1].second;
+                    set(cell, 0);
+                    set(cell, fingerprint(x) ^ get(position(x, 0)) ^ get(position(x, 1)) ^ get(position(x, 2)));
+                }
+                return true;
+            }
+        }
+        clear();
+        return false;
+    }
+
+    void clear()
+    {
+        m_fingerprints.clear();
+        m_p_fingerprints = nullptr;
+        m_size = 0;
+        m_block_size = 0;
+        m_seed = 0;
+        m_bits = 0;
+        m_bytes = 0;
+        m_mask = 0;
+    }
+
+    /*
+     *  \brief  Returns false if the hash is not in the filter for sure.
+     */
+    bool contains(const uint64_t hash) const
+    {
+        const uint64_t x = seeded(hash);
+        return (fingerprint(x) ^ get(position(x, 0)) ^ get(position(x, 1)) ^ get(position(x, 2))) == 0;
+    }
+
+    bool empty() const { return m_size == 0; }
+
+    unsigned bits() const { return m_bits; }
+
+    uint64_t block_size() const { return m_block_size; }
+
+    const uint8_t* data() const { return m_p_fingerprints; }
+
+    uint64_t seed() const { return m_seed; }
+
+    size_t size_bytes() const { return m_size; }
+
+private:
+    void set_params(const uint64_t block_size, const uint64_t seed, const unsigned bits)
+    {
+        m_block_size = block_size;
+        m_seed = seed;
+        m_bits = bits;
+        m_bytes = cell_bytes(bits);
+        m_mask = (uint32_t(1) << bits) - 1;
+    }
+
+    uint64_t seeded(const uint64_t hash) const { return key_hasher::mix(hash + m_seed); }
+
+    uint32_t fingerprint(const uint64_t x) const { return static_cast<uint32_t>(x ^ (x >> 32)) & m_mask; }
+
+    /*
+     *  \brief  Returns the cell of the hash in the third i of the array.
+     */
+    size_t position(const uint64_t x, const size_t i) const
+    {
+        const uint32_t r = static_cast<uint32_t>((i == 0) ? x : ((x << (21 * i)) | (x >> (64 - 21 * i))));
+        // Maps 32 bits to [0, block_size) without the division.
+        return static_cast<size_t>((uint64_t(r) * m_block_size) >> 32) + i * m_block_size;
+    }
+
+    uint32_t get(const size_t cell) const
+    {
+        const uint8_t* p = m_p_fingerprints + cell * m_bytes;
+        return (m_bytes == 1) ? p[0] : (p[0] | (uint32_t(p[1]) << 8));
+    }
+
+    void set(const size_t cell, const uint32_t value)
+    {
+        uint8_t* p = m_fingerprints.data() + cell * m_bytes;
+        p[0] = static_cast<uint8_t>(value);
+        if (m_bytes == 2) {
+            p[1] = static_cast<uint8_t>(value >> 8);
+        }
+    }
+
+private:
+    std::vector<uint8_t> m_fingerprints;
+    const uint8_t* m_p_fingerprints = nullptr;
+    size_t m_size = 0;
+    size_t m_block_size = 0;
+    uint64_t m_seed = 0;
+    unsigned m_bits = 0;
+    unsigned m_bytes = 0;
+    uint32_t m_mask = 0;
+};
+
+} // namespace details
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_XOR_FILTER_H_ */
@@ -0,0 +1,125 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DFA_H_
+#define _WORDDICT_WORDDICT_DFA_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Deterministic finite automaton over characters, e.g. compiled
+ *          from the regular expression by the user.
+ *
+ *  The transitions of every state are the sorted disjoint ranges of
+ *  characters, the state 0 is the start state.
+ */
+template<typename TChar>
+class dfa final
+{
+public:
+    using char_type  = typename details::char_traits<TChar>::char_type;
+    using uchar_type = typename details::char_traits<TChar>::uchar_type;
+    using state_type = uint32_t;
+
+    /// Transitions of the state by characters [first, last].
+    struct transition final
+    {
+        uchar_type first;
+        uchar_type last;
+        state_type to;
+    };
+
+    /// No state: the transition is absent.
+    static constexpr state_type npos = std::numeric_limits<state_type>::max();
+
+    dfa() {}
+
+    state_type add_state(const bool is_final = false)
+    {
+        m_states.push_back({is_final, {}});
+        return static_cast<state_type>(m_states.size() - 1);
+    }
+
+    bool add_transition(const state_type from, const char_type ch, const state_type to)
+    {
+        return add_transition(from, ch, ch, to);
+    }
+
+    /*
+     *  \brief  Adds the transition by characters [first, last].
+     *  \return false if some state is absent or the range intersects the
+     *          transitions of the state.
+     */
+    bool add_transition(const state_type from, const char_type first, const char_type last, const state_type to)
+    {
+        const transition t = {static_cast<uchar_type>(first), static_cast<uchar_type>(last), to};
+        if ((from >= m_states.size()) || (to >= m_states.size()) || (t.last < t.first)) {
+            return false;
+        }
+
+        std::vector<transition>& trans = m_states[from].transitions;
+        const typename std::vector<transition>::iterator it = std::lower_bound(trans.begin(), trans.end(), t,
+            [](const transition& lhs, const transition& rhs) { return lhs.last < rhs.first; });
+        if ((it != trans.end()) && (it->first <= t.last)) {
+            return false;
+        }
+        trans.insert(it, t);
+        return true;
+    }
+
+    void clear() { m_states.clear(); }
+
+    bool empty() const { return m_states.empty(); }
+
+    bool is_final(const state_type state) const { return m_states[state].is_final; }
+
+    state_type next(const state_type state, const uchar_type ch) const
+    {
+        const std::vector<transition>& trans = m_states[state].transitions;
+        const typename std::vector<transition>::const_iterator it = std::lower_bound(trans.cbegin(), trans.cend(), ch,
+            [](const transition& t, const uchar_type c) { return t.last < c; });
+        return ((it != trans.cend()) && (it->first <= ch)) ? it->to : npos;
+    }
+
+    size_t size() const { return m_states.size(); }
+
+    const std::vector<transition>& transitions(const state_type state) const { return m_states[state].transitions; }
+
+private:
+    struct state final
+    {
+        bool is_final;
+        std::vector<transition> transitions;
+    };
+
+private:
+    std::vector<state> m_states;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DFA_H_ */
@@ -0,0 +1,188 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DFA_MATCHER_H_
+#define _WORDDICT_WORDDICT_DFA_MATCHER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#include "worddict/dfa.h"
+#include "worddict/guide.h"
+#include "worddict/worddict.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/char_walker.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Intersection of the dictionary with the language of the DFA.
+ *
+ *  The product of the dictionary and the DFA is walked depth-first. The
+ *  pairs (unit, DFA state) from which no key is accepted are remembered:
+ *  the DAWG merges suffixes of keys, so the same pair is reached by many
+ *  prefixes, but is walked once.
+ *
+ *  If keys of the dictionary are normalized, the DFA is matched against
+ *  normalized keys: transitions by characters changed by the normalization
+ *  never match, like they do not when transitions of units are enumerated.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class dfa_matcher final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dfa_type   = dfa<char_type>;
+    using dict_type  = word_dict<char_type, base_type, value_type>;
+    using guide_type = guide<char_type, base_type, value_type>;
+    using state_type = typename dfa_type::state_type;
+
+    /// Maximum count of characters of transitions of the DFA state, which
+    /// are followed directly instead of the enumeration of transitions.
+    static constexpr size_type max_direct_chars = 16;
+
+    dfa_matcher(const dict_type& dict, const guide_type& guide)
+        : m_dict(dict)
+        , m_guide(guide)
+        , m_walker(dict, guide)
+        , m_p_fold(details::fold_table<uchar_type>(dict.key_normalization()))
+    {}
+
+    /*
+     *  \brief  Reports all keys accepted by the DFA in the order of keys.
+     *  \param  callback - callable as callback(key, value).
+     *  \return false if the DFA has no states.
+     */
+    template<typename TCallback>
+    bool match(const dfa_type& dfa, TCallback&& callback)
+    {
+        if (dfa.empty()) {
+            return false;
+        }
+
+        m_p_dfa = &dfa;
+        m_failed.clear();
+        m_key.clear();
+        // The guide of another dictionary is not followed.
+        if (! m_dict.empty() && (m_guide.size() == m_dict.size())) {
+            walk(m_dict.root(), 0, callback);
+        }
+        m_p_dfa = nullptr;
+        return true;
+    }
+
+private:
+    struct state_hash final
+    {
+        size_t operator()(const std::pair<base_type, state_type>& s) const
+        {
+            return std::hash<uint64_t>()((uint64_t(s.second) << 32) ^ s.first);
+        }
+    };
+
+    /*
+     *  \return true if the DFA state has few characters of transitions.
+     */
+    bool is_direct(const state_type state) const
+    {
+        size_type count = 0;
+        for (const typename dfa_type::transition& t : m_p_dfa->transitions(state)) {
+            count += (size_type)(t.last - t.first) + 1;
+            if (count > max_direct_chars) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     *  \return true if some key is accepted from the pair.
+     */
+    template<typename TCallback>
+    bool walk(const base_type idx, const state_type state, TCallback& callback)
+    {
+        if (m_failed.find(std::make_pair(idx, state)) != m_failed.end()) {
+            return false;
+        }
+
+        bool is_found = false;
+        if (m_p_dfa->is_final(state) && m_dict.has_value(idx)) {
+            callback(std::basic_string_view<char_type>(m_key), m_dict.value(idx));
+            is_found = true;
+        }
+
+        if (is_direct(state)) {
+            for (const typename dfa_type::transition& t : m_p_dfa->transitions(state)) {
+                for (uchar_type ch = t.first; ; ++ch) {
+                    base_type next_idx = idx;
+                    const bool is_stored = (m_p_fold == nullptr) || (m_p_fold[ch] == ch);
+                    if (is_stored && m_dict.follow(static_cast<char_type>(ch), next_idx)) {
+                        is_found |= walk_char(next_idx, t.to, ch, callback);
+                    }
+                    if (ch == t.last) {
+                        break;
+                    }
+                }
+            }
+        } else {
+            is_found |= m_walker.for_each_char(idx, [this, state, &callback](const base_type next_idx, const uchar_type ch) {
+                const state_type next = m_p_dfa->next(state, ch);
+                return (next != dfa_type::npos) && walk_char(next_idx, next, ch, callback);
+            });
+        }
+
+        if (! is_found) {
+            m_failed.emplace(idx, state);
+        }
+        return is_found;
+    }
+
+    template<typename TCallback>
+    bool walk_char(const base_type idx, const state_type state, const uchar_type ch, TCallback& callback)
+    {
+        m_key.push_back(static_cast<char_type>(ch));
+        const bool is_found = walk(idx, state, callback);
+        m_key.pop_back();
+        return is_found;
+    }
+
+private:
+    const dict_type& m_dict;
+    const guide_type& m_guide;
+    details::char_walker<char_type, base_type, value_type> m_walker;
+    const uchar_type* m_p_fold;
+
+    const dfa_type* m_p_dfa = nullptr;
+    std::unordered_set<std::pair<base_type, state_type>, state_hash> m_failed;
+    std::basic_string<char_type> m_key;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DFA_MATCHER_H_ */
@@ -0,0 +1,181 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_DICT_WARMER_H_
+#define _WORDDICT_WORDDICT_DICT_WARMER_H_
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Background warm-up of the page cache for the mapped dictionary.
+ *
+ *  The hot region (the root levels and the hot states of the profile-driven
+ *  layout) is prefaulted first with madvise(MADV_WILLNEED), then the tail of
+ *  the array and the bit-packed values, if any, are prefaulted by chunks.
+ *  The tail and values are advised with MADV_RANDOM, because lookups do not
+ *  benefit from the readahead there.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class dict_warmer final
+{
+public:
+    using base_type = typename details::traits<TChar, TBase, TValue>::base_type;
+    using size_type = typename details::traits<TChar, TBase, TValue>::size_type;
+
+    /// Size of the region near the root which is always treated as hot.
+    static constexpr size_type root_region_size = size_type(64) << 10;
+    /// Size of the chunk of the tail prefaulted at once.
+    static constexpr size_type chunk_size = size_type(1) << 20;
+
+    explicit dict_warmer(const word_dict<TChar, TBase, TValue>& dict)
+        : m_dict(dict)
+    {}
+
+    dict_warmer(const dict_warmer&) = delete;
+    dict_warmer& operator=(const dict_warmer&) = delete;
+
+    ~dict_warmer() { wait(); }
+
+    /*
+     *  \brief  Starts the warm-up on the background thread.
+     *  \return false if the warm-up has been already started.
+     */
+    bool start()
+    {
+        if (m_thread.joinable() || m_is_ready.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void wait()
+    {
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    /*
+     *  \brief  Returns true if the hot region has been prefaulted.
+     */
+    bool is_hot_ready() const { return m_is_hot_ready.load(std::memory_order_acquire); }
+
+    /*
+     *  \brief  Returns true if the whole dictionary has been prefaulted.
+     */
+    bool is_ready() const { return m_is_ready.load(std::memory_order_acquire); }
+
+    /*
+     *  \brief  Returns the fraction of the prefaulted bytes.
+     */
+    double progress() const
+    {
+        const size_type total = m_total.load(std::memory_order_acquire);
+        return (total == 0) ? (is_ready() ? 1.0 : 0.0)
+                            : (double)m_done.load(std::memory_order_acquire) / total;
+    }
+
+private:
+    void run()
+    {
+        const uintptr_t page_size = ::sysconf(_SC_PAGESIZE);
+        const uintptr_t data = reinterpret_cast<uintptr_t>(m_dict.data());
+        const uintptr_t begin = data & ~(page_size - 1);
+        const uintptr_t end = (data + m_dict.size() * sizeof(base_type) + page_size - 1) & ~(page_size - 1);
+        const uintptr_t hot_bytes = std::max<uintptr_t>(m_dict.hot_size() * sizeof(base_type), root_region_size);
+        const uintptr_t hot_end = std::min<uintptr_t>((data + hot_bytes + page_size - 1) & ~(page_size - 1), end);
+
+        uintptr_t values_begin = 0;
+        uintptr_t values_end = 0;
+        if (m_dict.values_size() != 0) {
+            const uintptr_t values = reinterpret_cast<uintptr_t>(m_dict.values_data());
+            values_begin = values & ~(page_size - 1);
+            values_end = (values + m_dict.values_size() + page_size - 1) & ~(page_size - 1);
+            // Values may share the last page with units in the mapped file.
+            if ((values_begin < end) && (values_end > begin)) {
+                values_begin = std::min(std::max(values_begin, end), values_end);
+            }
+        }
+
+        m_total.store((end - begin) + (values_end - values_begin), std::memory_order_release);
+        if (m_dict.is_mapped()) {
+            if (hot_end < end) {
+                ::madvise(reinterpret_cast<void*>(hot_end), end - hot_end, MADV_RANDOM);
+            }
+            if (values_begin < values_end) {
+                ::madvise(reinterpret_cast<void*>(values_begin), values_end - values_begin, MADV_RANDOM);
+            }
+            ::madvise(reinterpret_cast<void*>(begin), hot_end - begin, MADV_WILLNEED);
+        }
+        prefault(begin, hot_end, page_size);
+        m_is_hot_ready.store(true, std::memory_order_release);
+
+        prefault_chunks(hot_end, end, page_size);
+        prefault_chunks(values_begin, values_end, page_size);
+        m_is_ready.store(true, std::memory_order_release);
+    }
+
+    void prefault_chunks(const uintptr_t begin, const uintptr_t end, const uintptr_t page_size)
+    {
+        for (uintptr_t chunk = begin; chunk < end; chunk += chunk_size) {
+            const uintptr_t chunk_end = std::min<uintptr_t>(chunk + chunk_size, end);
+            if (m_dict.is_mapped()) {
+                ::madvise(reinterpret_cast<void*>(chunk), chunk_end - chunk, MADV_WILLNEED);
+            }
+            prefault(chunk, chunk_end, page_size);
+        }
+    }
+
+    void prefault(const uintptr_t begin, const uintptr_t end, const uintptr_t page_size)
+    {
+        unsigned char sum = 0;
+        for (uintptr_t page = begin; page < end; page += page_size) {
+            sum += *reinterpret_cast<const volatile unsigned char*>(page);
+        }
+        m_sink = sum;
+        m_done.fetch_add(end - begin, std::memory_order_release);
+    }
+
+private:
+    const word_dict<TChar, TBase, TValue>& m_dict;
+    std::thread m_thread;
+
+    std::atomic<bool> m_is_hot_ready = {false};
+    std::atomic<bool> m_is_ready = {false};
+    std::atomic<size_type> m_done = {0};
+    std::atomic<size_type> m_total = {0};
+    volatile unsigned char m_sink = 0;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_DICT_WARMER_H_ */
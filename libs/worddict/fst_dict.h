@@ -0,0 +1,270 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_FST_DICT_H_
+#define _WORDDICT_WORDDICT_FST_DICT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "worddict/worddict.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dict_file.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+#include "worddict/details/mem_region.h"
+#include "worddict/details/packed_values.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Minimal transducer: values of keys are sums of outputs of their
+ *          transitions and of their leaves.
+ *
+ *  Values are pushed towards the root while building (see dawg_builder), so
+ *  keys with distinct but monotone values (ids, offsets) share states like
+ *  keys with equal values do, and the automaton is much smaller than the
+ *  DAWG of the same keys. Outputs of units are bit-packed by blocks of
+ *  units; most of them are 0, so blocks take a few bits per unit. Leaves
+ *  keep the rest of values, so the array of values of keys is not needed.
+ *
+ *  The dictionary is built by the builder of value_coding::transitions (see
+ *  builder::build(fst_dict_type&)). Outputs are saved next to the
+ *  dictionary into the file path + ".outputs".
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class fst_dict final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+    using codec = details::label_codec<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<TChar, TBase, TValue>;
+
+    fst_dict() {}
+
+    void clear()
+    {
+        m_dict.clear();
+        m_outputs.clear();
+        m_region.release();
+        m_p_fold = nullptr;
+    }
+
+    /*
+     *  \brief  Reports keys which are prefixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, value).
+     */
+    template<typename TCallback>
+    void common_prefix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        if (empty()) {
+            return;
+        }
+
+        base_type idx = m_dict.root();
+        value_type output = 0;
+        for (size_type i = 0; i < key.length(); ++i) {
+            if (! follow(key[i], idx, output)) {
+                return;
+            }
+            if (m_dict.has_value(idx)) {
+                callback(i + 1, output + m_dict.value(idx));
+            }
+        }
+    }
+
+    /*
+     *  \brief  Returns the double-array, whose values are the rests of
+     *          values after outputs of transitions.
+     */
+    const dict_type& dict() const { return m_dict; }
+
+    bool empty() const { return m_dict.empty(); }
+
+    value_type find(const std::basic_string_view<char_type>& key) const
+    {
+        if (empty() || ! m_dict.may_contain(key)) {
+            return -1;
+        }
+
+        base_type idx = m_dict.root();
+        value_type output = 0;
+        for (const char_type ch : key) {
+            if (! follow(ch, idx, output)) {
+                return -1;
+            }
+        }
+        return m_dict.has_value(idx) ? (output + m_dict.value(idx)) : -1;
+    }
+
+    bool load(const std::string& path, const page_policy policy = page_policy::regular)
+    {
+        clear();
+        if (! m_dict.load(path, policy)) {
+            return false;
+        }
+
+        std::ifstream in(outputs_path(path), std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in.tellg();
+        outputs_header header;
+        if (! in.seekg(0) || ! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || ! is_valid_header(header, file_size)) {
+            clear();
+            return false;
+        }
+        std::vector<uint64_t> words(header.words_count);
+        if (! in.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint64_t))
+            || (details::crc32c(words.data(), words.size() * sizeof(uint64_t)) != header.data_crc)
+            || ! m_outputs.assign(std::move(words)) || ! attach()) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool map(const std::string& path, const page_policy policy = page_policy::regular, const bool populate = false)
+    {
+        clear();
+        outputs_header header;
+        if (! m_dict.map(path, policy, populate) || ! m_region.map(outputs_path(path), policy, populate)
+            || (m_region.size() < sizeof(header))) {
+            clear();
+            return false;
+        }
+        std::memcpy(&header, m_region.data(), sizeof(header));
+        const uint64_t* p_words = reinterpret_cast<const uint64_t*>(static_cast<const char*>(m_region.data()) + sizeof(header));
+        if (! is_valid_header(header, m_region.size())
+            || (details::crc32c(p_words, header.words_count * sizeof(uint64_t)) != header.data_crc)
+            || ! m_outputs.attach(p_words, header.words_count) || ! attach()) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the size of outputs of units in bytes.
+     */
+    size_type outputs_size() const { return m_outputs.words_count() * sizeof(uint64_t); }
+
+    bool save(const std::string& path) const
+    {
+        if (! m_dict.save(path)) {
+            return false;
+        }
+
+        outputs_header header = {};
+        header.magic = outputs_header::magic_value;
+        header.version = outputs_header::version_value;
+        header.words_count = m_outputs.words_count();
+        header.data_crc = details::crc32c(m_outputs.data(), header.words_count * sizeof(uint64_t));
+        header.header_crc = details::crc32c(&header, offsetof(outputs_header, header_crc));
+
+        std::ofstream out(outputs_path(path), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(m_outputs.data()), header.words_count * sizeof(uint64_t));
+        return out.good();
+    }
+
+private:
+    /*
+     *  \brief  Header of the file of outputs, which is followed by words of
+     *          the packed array of outputs.
+     */
+    struct outputs_header final
+    {
+        static constexpr uint64_t magic_value = 0x5354555054554F57ULL; // "WOUTPUTS"
+        static constexpr uint64_t version_value = 1;
+
+        uint64_t magic;
+        uint64_t version;
+        uint64_t words_count;
+        uint64_t data_crc;
+        uint64_t header_crc; ///< Checksum of the previous fields.
+    };
+
+    void assign(std::vector<value_type>&& outputs)
+    {
+        m_outputs.assign(outputs, value_coding::frame_of_reference);
+        attach();
+    }
+
+    /*
+     *  \brief  Checks that every unit has the output.
+     */
+    bool attach()
+    {
+        m_p_fold = details::fold_table<uchar_type>(m_dict.key_normalization());
+        return m_outputs.size() == m_dict.size();
+    }
+
+    bool follow(char_type ch, base_type& idx, value_type& output) const
+    {
+        if (m_p_fold != nullptr) {
+            ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+        }
+
+        label_type labels[codec::max_labels];
+        const size_type count = codec::encode(ch, labels);
+        for (size_type i = 0; i < count; ++i) {
+            if (! m_dict.follow_label(labels[i], idx)) {
+                return false;
+            }
+            output += m_outputs[idx];
+        }
+        return true;
+    }
+
+    static bool is_valid_header(const outputs_header& h, const uint64_t file_size)
+    {
+        if ((h.magic != outputs_header::magic_value) || (h.version != outputs_header::version_value)
+            || (h.header_crc != details::crc32c(&h, offsetof(outputs_header, header_crc)))) {
+            return false;
+        }
+        return (h.words_count < file_size) && (file_size == sizeof(h) + h.words_count * sizeof(uint64_t));
+    }
+
+    static std::string outputs_path(const std::string& path) { return path + ".outputs"; }
+
+private:
+    dict_type m_dict;
+    details::packed_values<value_type> m_outputs;
+    details::mem_region m_region;
+    const uchar_type* m_p_fold = nullptr;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_FST_DICT_H_ */
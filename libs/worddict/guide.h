@@ -0,0 +1,170 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_GUIDE_H_
+#define _WORDDICT_WORDDICT_GUIDE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/dict_file.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+template<typename TChar, typename TBase, typename TValue>
+class builder;
+
+/*
+ *  \brief  Guide of the dictionary: labels of the first child and of the
+ *          next sibling of every unit, which let to enumerate transitions
+ *          of the state in the order of labels, and counts of keys, which
+ *          paths pass through every unit.
+ *
+ *  The label 0 means that there is no child (sibling). The children of
+ *  the state are: follow(child(idx), idx) and the siblings of it.
+ *
+ *  The file consists of the header, the labels and the counts of keys of
+ *  units. The guide is valid for the dictionary of the same count of units
+ *  only (see size()).
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class guide final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+
+    guide() {}
+
+    label_type child(const base_type idx) const { return m_units[idx].first; }
+
+    void clear()
+    {
+        m_units.clear();
+        m_counts.clear();
+    }
+
+    /*
+     *  \brief  Returns the count of keys, which paths pass through the unit.
+     */
+    base_type count(const base_type idx) const { return m_counts[idx]; }
+
+    bool empty() const { return m_units.empty(); }
+
+    bool load(const std::string& path)
+    {
+        clear();
+
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in.tellg();
+        guide_header header;
+        if (! in.seekg(0) || ! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || ! is_valid_header(header, file_size)) {
+            return false;
+        }
+
+        std::vector<std::pair<label_type, label_type>> units(header.units_count);
+        std::vector<base_type> counts(header.units_count);
+        if (! in.read(reinterpret_cast<char*>(units.data()), units.size() * sizeof(units[0]))
+            || ! in.read(reinterpret_cast<char*>(counts.data()), counts.size() * sizeof(counts[0]))
+            || (data_crc(units, counts) != header.data_crc)) {
+            return false;
+        }
+        assign(std::move(units), std::move(counts));
+        return true;
+    }
+
+    bool save(const std::string& path) const
+    {
+        guide_header header = {};
+        header.magic = guide_header::magic_value;
+        header.version = guide_header::version_value;
+        header.units_count = m_units.size();
+        header.data_crc = data_crc(m_units, m_counts);
+        header.header_crc = details::crc32c(&header, offsetof(guide_header, header_crc));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(m_units.data()), m_units.size() * sizeof(m_units[0]));
+        out.write(reinterpret_cast<const char*>(m_counts.data()), m_counts.size() * sizeof(m_counts[0]));
+        return out.good();
+    }
+
+    label_type sibling(const base_type idx) const { return m_units[idx].second; }
+
+    size_type size() const { return m_units.size(); }
+
+private:
+    /*
+     *  \brief  Header of the file of the guide, which is followed by labels
+     *          and counts of keys of units.
+     */
+    struct guide_header final
+    {
+        static constexpr uint64_t magic_value = 0x5345444955474457ULL; // "WDGUIDES"
+        static constexpr uint64_t version_value = 1;
+
+        uint64_t magic;
+        uint64_t version;
+        uint64_t units_count;
+        uint64_t data_crc;
+        uint64_t header_crc; ///< Checksum of the previous fields.
+    };
+
+    void assign(std::vector<std::pair<label_type, label_type>>&& units, std::vector<base_type>&& counts)
+    {
+        m_units = std::move(units);
+        m_counts = std::move(counts);
+    }
+
+    static uint64_t data_crc(const std::vector<std::pair<label_type, label_type>>& units,
+                             const std::vector<base_type>& counts)
+    {
+        const uint32_t crc = details::crc32c(units.data(), units.size() * sizeof(units[0]));
+        return details::crc32c(counts.data(), counts.size() * sizeof(counts[0]), crc);
+    }
+
+    static bool is_valid_header(const guide_header& h, const uint64_t file_size)
+    {
+        if ((h.magic != guide_header::magic_value) || (h.version != guide_header::version_value)
+            || (h.header_crc != details::crc32c(&h, offsetof(guide_header, header_crc)))) {
+            return false;
+        }
+        const uint64_t unit_size = sizeof(std::pair<label_type, label_type>) + sizeof(base_type);
+        return (h.units_count != 0) && (h.units_count < file_size)
+               && (file_size == sizeof(h) + h.units_count * unit_size);
+    }
+
+private:
+    std::vector<std::pair<label_type, label_type>> m_units;
+    std::vector<base_type> m_counts;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_GUIDE_H_ */
@@ -0,0 +1,377 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_LOOKUP_EXECUTOR_H_
+#define _WORDDICT_WORDDICT_LOOKUP_EXECUTOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "worddict/guide.h"
+#include "worddict/worddict.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dict_unit.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Kind of the query of the lookup executor.
+ */
+enum class query_kind
+{
+    find,          ///< The key itself.
+    common_prefix, ///< Keys which are prefixes of the key, shortest first.
+    predictive     ///< Keys which start with the key, in the order of keys.
+};
+
+/*
+ *  \brief  Executor of interleaved lookups.
+ *
+ *  Lookups of large dictionaries wait for the memory on almost every
+ *  transition. The executor keeps several lookups in flight: every lookup
+ *  is the resumable state machine, which issues the prefetch of the next
+ *  unit and yields to the next lookup, so misses of in-flight lookups
+ *  overlap. Queries of different kinds share the same round.
+ *
+ *  The width is the count of lookups in flight: 8-16 hide the latency of
+ *  the memory, while the wider ones overflow the line fill buffers.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class lookup_executor final
+{
+    using codec = details::label_codec<TChar, TBase, TValue>;
+    using unit  = details::dict_unit<TChar, TBase, TValue>;
+
+    /// Characters are labels, so keys are followed without coding.
+    static constexpr bool is_char_label =
+        (codec::max_labels == 1)
+        && (sizeof(typename details::traits<TChar, TBase, TValue>::label_type) == sizeof(TChar));
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type  = word_dict<char_type, base_type, value_type>;
+    using guide_type = guide<char_type, base_type, value_type>;
+
+    struct query final
+    {
+        query_kind kind;
+        std::basic_string_view<char_type> key;
+    };
+
+    static constexpr size_type default_width = 16;
+
+    explicit lookup_executor(const dict_type& dict, const size_type width = default_width)
+        : lookup_executor(dict, nullptr, width)
+    {}
+
+    /*
+     *  \brief  The guide of the dictionary is required by predictive queries.
+     *          The guide of another dictionary (of another size) is ignored.
+     */
+    lookup_executor(const dict_type& dict, const guide_type& guide, const size_type width = default_width)
+        : lookup_executor(dict, &guide, width)
+    {}
+
+    /*
+     *  \brief  Finds values of keys, -1 for missing ones.
+     */
+    void find(const std::basic_string_view<char_type>* p_keys, const size_type count, value_type* p_values)
+    {
+        std::fill(p_values, p_values + count, -1);
+        execute(count, [p_keys](const size_type i) { return query{query_kind::find, p_keys[i]}; },
+                [p_values](const size_type i, const std::basic_string_view<char_type>&, const value_type value) {
+                    p_values[i] = value;
+                });
+    }
+
+    /*
+     *  \brief  Runs queries.
+     *  \param  callback - callable as callback(query_index, key, value) for
+     *          every key found by the query.
+     *  \return false if there are predictive queries, but the executor has
+     *          no guide.
+     */
+    template<typename TCallback>
+    bool run(const std::vector<query>& queries, TCallback&& callback)
+    {
+        if (m_p_guide == nullptr) {
+            const bool has_predictive = std::any_of(queries.cbegin(), queries.cend(), [](const query& q) {
+                return q.kind == query_kind::predictive;
+            });
+            if (has_predictive) {
+                return false;
+            }
+        }
+        execute(queries.size(), [&queries](const size_type i) { return queries[i]; }, callback);
+        return true;
+    }
+
+    size_type width() const { return m_slots.size(); }
+
+private:
+    /*
+     *  \brief  State of the lookup in flight.
+     */
+    struct slot final
+    {
+        bool is_active = false;
+        size_type query = 0;
+        query_kind kind = query_kind::find;
+        std::basic_string_view<char_type> key;
+
+        /// Labels of the key: the key itself, if characters are labels, or
+        /// the coded key.
+        const label_type* p_labels = nullptr;
+        /// Coded key and, for predictive queries, labels of the found key.
+        std::vector<label_type> labels;
+        /// The prefix of labels which has been followed.
+        size_type label_pos = 0;
+        /// Count of characters which has been followed.
+        size_type char_pos = 0;
+        /// End of labels of the current character.
+        size_type char_end = 0;
+        /// Count of labels of the key (predictive queries).
+        size_type key_labels = 0;
+
+        base_type idx = 0;
+        /// The unit which is fetched by the prefetch.
+        base_type next_idx = 0;
+
+        /// Path of units from the unit of the key (predictive queries).
+        std::vector<base_type> path;
+        std::basic_string<char_type> found;
+        std::basic_string<char_type> folded;
+    };
+
+    lookup_executor(const dict_type& dict, const guide_type* p_guide, const size_type width)
+        : m_dict(dict)
+        , m_p_guide(((p_guide != nullptr) && (p_guide->size() == dict.size())) ? p_guide : nullptr)
+        , m_p_fold(details::fold_table<uchar_type>(dict.key_normalization()))
+        , m_slots(std::max<size_type>(width, 1))
+    {}
+
+    template<typename TQuery, typename TCallback>
+    void execute(const size_type count, TQuery&& get_query, TCallback&& callback)
+    {
+        if (m_dict.empty()) {
+            return;
+        }
+
+        size_type next_query = 0;
+        size_type active = 0;
+        const auto refill = [&](slot& s) {
+            while (! s.is_active && (next_query < count)) {
+                s.is_active = start(s, next_query, get_query(next_query), callback);
+                ++next_query;
+            }
+            active += s.is_active ? 1 : 0;
+        };
+
+        for (slot& s : m_slots) {
+            refill(s);
+        }
+        while (active != 0) {
+            for (slot& s : m_slots) {
+                if (s.is_active && ! resume(s, callback)) {
+                    s.is_active = false;
+                    --active;
+                    refill(s);
+                }
+            }
+        }
+    }
+
+    /*
+     *  \return false if the lookup is finished.
+     */
+    template<typename TCallback>
+    bool start(slot& s, const size_type query_idx, const query& q, TCallback& callback)
+    {
+        s.query = query_idx;
+        s.kind = q.kind;
+        s.key = q.key;
+        if ((q.kind == query_kind::find) && ! m_dict.may_contain(q.key)) {
+            return false;
+        }
+        if constexpr (is_char_label) {
+            if ((m_p_fold == nullptr) && (q.kind != query_kind::predictive)) {
+                s.p_labels = reinterpret_cast<const label_type*>(q.key.data());
+                s.key_labels = q.key.size();
+                return dispatch(s) && walk(s, callback);
+            }
+        }
+
+        if (m_p_fold != nullptr) {
+            s.folded.assign(q.key.data(), q.key.size());
+            for (char_type& ch : s.folded) {
+                ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+            }
+            codec::encode(s.folded.data(), s.folded.size(), s.labels);
+        } else {
+            codec::encode(q.key.data(), q.key.size(), s.labels);
+        }
+        s.p_labels = s.labels.data();
+        s.key_labels = s.labels.size();
+        return dispatch(s) && walk(s, callback);
+    }
+
+    /*
+     *  \brief  Starts the walk of the key from the root or, if the dictionary
+     *          has the dispatch table, from the state after the first
+     *          characters of the key. Common prefix queries report prefixes
+     *          on the way, so they always start from the root.
+     *  \return false if the key has left the dictionary.
+     */
+    bool dispatch(slot& s) const
+    {
+        s.idx = m_dict.root();
+        size_type count = 0;
+        if ((s.kind != query_kind::common_prefix) && ! m_dict.follow_dispatch(s.key, s.idx, count)) {
+            return false;
+        }
+        // Characters of the table are coded by one label each.
+        s.label_pos = count;
+        s.char_pos = count;
+        s.char_end = (count < s.key_labels) ? count + codec::length(s.p_labels[count]) : count;
+        return true;
+    }
+
+    /*
+     *  \brief  Continues the lookup, once the prefetched unit is reached.
+     *  \return false if the lookup is finished.
+     */
+    template<typename TCallback>
+    bool resume(slot& s, TCallback& callback)
+    {
+        if (s.label_pos < s.key_labels) {
+            if (unit::label(m_dict.data()[s.next_idx]) != s.p_labels[s.label_pos]) {
+                return false;
+            }
+            s.idx = s.next_idx;
+            ++s.label_pos;
+            if (s.label_pos == s.char_end) {
+                ++s.char_pos;
+                s.char_end += (s.label_pos < s.key_labels) ? codec::length(s.p_labels[s.label_pos]) : 0;
+                if ((s.kind == query_kind::common_prefix) && m_dict.has_value(s.idx)) {
+                    callback(s.query, s.key.substr(0, s.char_pos), m_dict.value(s.idx));
+                }
+            }
+            return walk(s, callback);
+        }
+
+        s.idx = s.next_idx;
+        s.path.push_back(s.idx);
+        return enumerate(s, callback);
+    }
+
+    /*
+     *  \brief  Prefetches the next unit of the key or finishes the lookup.
+     */
+    template<typename TCallback>
+    bool walk(slot& s, TCallback& callback)
+    {
+        if (s.label_pos < s.key_labels) {
+            fetch(s, s.p_labels[s.label_pos]);
+            return true;
+        }
+
+        switch (s.kind) {
+        case query_kind::find:
+            if (m_dict.has_value(s.idx)) {
+                callback(s.query, s.key, m_dict.value(s.idx));
+            }
+            return false;
+        case query_kind::common_prefix:
+            return false;
+        case query_kind::predictive:
+            s.path.assign(1, s.idx);
+            return enumerate(s, callback);
+        }
+        return false;
+    }
+
+    /*
+     *  \brief  Reports the key of the current unit, if it has the value, and
+     *          prefetches the next unit in the order of keys.
+     */
+    template<typename TCallback>
+    bool enumerate(slot& s, TCallback& callback)
+    {
+        if (m_dict.has_value(s.idx)) {
+            codec::decode(s.labels.data(), s.labels.size(), s.found);
+            callback(s.query, std::basic_string_view<char_type>(s.found), m_dict.value(s.idx));
+        }
+
+        const label_type child = m_p_guide->child(s.idx);
+        if (child != 0) {
+            fetch(s, child);
+            return true;
+        }
+
+        // Moves to the next sibling of the nearest unit of the path below
+        // the key which has it.
+        while (s.path.size() > 1) {
+            const label_type sibling = m_p_guide->sibling(s.path.back());
+            s.path.pop_back();
+            s.labels.pop_back();
+            if (sibling != 0) {
+                s.idx = s.path.back();
+                fetch(s, sibling);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     *  \brief  Issues the prefetch of the child unit of the current unit by
+     *          the label.
+     */
+    void fetch(slot& s, const label_type label)
+    {
+        s.next_idx = s.idx ^ unit::offset(m_dict.data()[s.idx]) ^ label;
+        if (s.label_pos >= s.key_labels) {
+            s.labels.push_back(label);
+        }
+        __builtin_prefetch(m_dict.data() + s.next_idx);
+    }
+
+private:
+    const dict_type& m_dict;
+    const guide_type* m_p_guide;
+    const uchar_type* m_p_fold;
+
+    std::vector<slot> m_slots;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_LOOKUP_EXECUTOR_H_ */
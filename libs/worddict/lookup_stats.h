@@ -0,0 +1,305 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_LOOKUP_STATS_H_
+#define _WORDDICT_WORDDICT_LOOKUP_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(WORDDICT_LOOKUP_STATS)
+    #include <algorithm>
+    #include <atomic>
+    #include <chrono>
+    #include <mutex>
+    #include <vector>
+#endif
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Counters of lookups of dictionaries.
+ *
+ *  Counters are collected only if the library is compiled with the
+ *  WORDDICT_LOOKUP_STATS macro defined, otherwise the instrumentation of
+ *  lookups is compiled to nothing and snapshots are empty.
+ */
+struct lookup_stats final
+{
+    /// The bucket i of the histogram counts lookups which took from 2^(i-1)
+    /// (exclusive) to 2^i nanoseconds, the last bucket counts longer ones.
+    static constexpr size_t latency_buckets = 32;
+
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t early_misses = 0; ///< The key has left the dictionary by the transition.
+    uint64_t leaf_misses = 0;  ///< All transitions of the key exist, but it has no value.
+    uint64_t transitions = 0;  ///< Characters followed by lookups and by follow().
+    uint64_t latency[latency_buckets] = {};
+
+    void merge(const lookup_stats& other)
+    {
+        lookups += other.lookups;
+        hits += other.hits;
+        early_misses += other.early_misses;
+        leaf_misses += other.leaf_misses;
+        transitions += other.transitions;
+        for (size_t i = 0; i < latency_buckets; ++i) {
+            latency[i] += other.latency[i];
+        }
+    }
+
+    /*
+     *  \brief  Returns the upper bound of the latency of the fraction of
+     *          lookups in nanoseconds, e.g. percentile(0.99).
+     */
+    uint64_t percentile(const double fraction) const
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < latency_buckets; ++i) {
+            total += latency[i];
+        }
+
+        uint64_t count = 0;
+        for (size_t i = 0; i < latency_buckets; ++i) {
+            count += latency[i];
+            if ((total != 0) && (count >= fraction * total)) {
+                return uint64_t(1) << i;
+            }
+        }
+        return 0;
+    }
+};
+
+namespace details {
+
+#if defined(WORDDICT_LOOKUP_STATS)
+
+inline constexpr bool is_lookup_stats_enabled = true;
+
+/*
+ *  \brief  Registry of counters of threads.
+ *
+ *  Every thread increments its own counters without locks and atomic
+ *  read-modify-write operations: the counter is written by the owner only,
+ *  so relaxed loads and stores are enough for snapshots read by other
+ *  threads. Counters of finished threads are merged into the registry.
+ */
+class lookup_stats_registry final
+{
+public:
+    static constexpr size_t counters_count = 5 + lookup_stats::latency_buckets;
+
+    enum counter : size_t
+    {
+        lookups,
+        hits,
+        early_misses,
+        leaf_misses,
+        transitions,
+        latency
+    };
+
+    struct thread_counters final
+    {
+        std::atomic<uint64_t> values[counters_count] = {};
+
+        void add(const size_t counter, const uint64_t value)
+        {
+            values[counter].store(values[counter].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        void merge_into(lookup_stats& stats) const
+        {
+            uint64_t v[counters_count];
+            for (size_t i = 0; i < counters_count; ++i) {
+                v[i] = values[i].load(std::memory_order_relaxed);
+            }
+            stats.lookups += v[lookups];
+            stats.hits += v[hits];
+            stats.early_misses += v[early_misses];
+            stats.leaf_misses += v[leaf_misses];
+            stats.transitions += v[transitions];
+            for (size_t i = 0; i < lookup_stats::latency_buckets; ++i) {
+                stats.latency[i] += v[latency + i];
+            }
+        }
+    };
+
+    static lookup_stats_registry& instance()
+    {
+        static lookup_stats_registry registry;
+        return registry;
+    }
+
+    /*
+     *  \brief  Returns counters of the calling thread.
+     */
+    static thread_counters& local()
+    {
+        static thread_local thread_handle handle;
+        return handle.counters;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_baseline = collect();
+    }
+
+    lookup_stats snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        lookup_stats stats = collect();
+        stats.lookups -= m_baseline.lookups;
+        stats.hits -= m_baseline.hits;
+        stats.early_misses -= m_baseline.early_misses;
+        stats.leaf_misses -= m_baseline.leaf_misses;
+        stats.transitions -= m_baseline.transitions;
+        for (size_t i = 0; i < lookup_stats::latency_buckets; ++i) {
+            stats.latency[i] -= m_baseline.latency[i];
+        }
+        return stats;
+    }
+
+private:
+    /*
+     *  \brief  Registers counters of the thread for its lifetime.
+     */
+    struct thread_handle final
+    {
+        thread_handle()
+            : registry(instance())
+        {
+            std::lock_guard<std::mutex> lock(registry.m_mutex);
+            registry.m_threads.push_back(&counters);
+        }
+
+        ~thread_handle()
+        {
+            std::lock_guard<std::mutex> lock(registry.m_mutex);
+            counters.merge_into(registry.m_finished);
+            registry.m_threads.erase(std::find(registry.m_threads.begin(), registry.m_threads.end(), &counters));
+        }
+
+        lookup_stats_registry& registry;
+        thread_counters counters;
+    };
+
+    lookup_stats collect() const
+    {
+        lookup_stats stats = m_finished;
+        for (const thread_counters* p_counters : m_threads) {
+            p_counters->merge_into(stats);
+        }
+        return stats;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<thread_counters*> m_threads;
+    lookup_stats m_finished;
+    lookup_stats m_baseline;
+};
+
+/*
+ *  \brief  Probe of the lookup: measures its latency and records its
+ *          outcome to counters of the thread.
+ */
+class lookup_probe final
+{
+    using clock = std::chrono::steady_clock;
+    using registry = lookup_stats_registry;
+
+public:
+    lookup_probe()
+        : m_start(clock::now())
+    {}
+
+    static void follow(const size_t transitions) { registry::local().add(registry::transitions, transitions); }
+
+    void hit(const size_t transitions) { finish(registry::hits, transitions); }
+
+    void early_miss(const size_t transitions) { finish(registry::early_misses, transitions); }
+
+    void leaf_miss(const size_t transitions) { finish(registry::leaf_misses, transitions); }
+
+private:
+    void finish(const size_t outcome, const size_t transitions)
+    {
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start).count();
+        size_t bucket = 0;
+        for (uint64_t v = ns; (v != 0) && (bucket + 1 < lookup_stats::latency_buckets); v >>= 1) {
+            ++bucket;
+        }
+
+        registry::thread_counters& counters = registry::local();
+        counters.add(registry::lookups, 1);
+        counters.add(outcome, 1);
+        counters.add(registry::transitions, transitions);
+        counters.add(registry::latency + bucket, 1);
+    }
+
+private:
+    const clock::time_point m_start;
+};
+
+#else
+
+inline constexpr bool is_lookup_stats_enabled = false;
+
+class lookup_probe final
+{
+public:
+    static void follow(const size_t) {}
+
+    void hit(const size_t) {}
+
+    void early_miss(const size_t) {}
+
+    void leaf_miss(const size_t) {}
+};
+
+#endif
+
+} // namespace details
+
+/*
+ *  \brief  Returns counters of lookups of all threads since the last reset.
+ */
+inline lookup_stats lookup_stats_snapshot()
+{
+#if defined(WORDDICT_LOOKUP_STATS)
+    return details::lookup_stats_registry::instance().snapshot();
+#else
+    return lookup_stats();
+#endif
+}
+
+inline void reset_lookup_stats()
+{
+#if defined(WORDDICT_LOOKUP_STATS)
+    details::lookup_stats_registry::instance().reset();
+#endif
+}
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_LOOKUP_STATS_H_ */
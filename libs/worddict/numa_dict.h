@@ -0,0 +1,123 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_NUMA_DICT_H_
+#define _WORDDICT_WORDDICT_NUMA_DICT_H_
+
+#include <sched.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/numa.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Replicas of the dictionary, one per NUMA node.
+ *
+ *  Every replica is loaded by the thread bound to the CPUs of its node, so
+ *  the pages of the replica are allocated on the node by the first touch.
+ *  Readers use the replica of the node of the CPU they run on.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class numa_dict final
+{
+public:
+    using size_type = typename details::traits<TChar, TBase, TValue>::size_type;
+
+    numa_dict() {}
+
+    void clear()
+    {
+        m_replicas.clear();
+        m_cpu_replica.clear();
+    }
+
+    bool load(const std::string& path, const page_policy policy = page_policy::regular)
+    {
+        clear();
+
+        const std::vector<std::vector<int>> nodes = details::numa_nodes();
+        if (nodes.size() < 2) {
+            m_replicas.resize(1);
+            if (! m_replicas[0].load(path, policy)) {
+                clear();
+                return false;
+            }
+            return true;
+        }
+
+        m_replicas.resize(nodes.size());
+        std::vector<char> rc(nodes.size(), 0);
+        for (size_type node = 0; node < nodes.size(); ++node) {
+            std::thread loader([&, node]() {
+                details::bind_to_cpus(nodes[node]);
+                rc[node] = m_replicas[node].load(path, policy) ? 1 : 0;
+            });
+            loader.join();
+
+            if (rc[node] == 0) {
+                clear();
+                return false;
+            }
+            for (const int cpu : nodes[node]) {
+                if (m_cpu_replica.size() <= (size_type)cpu) {
+                    m_cpu_replica.resize(cpu + 1, 0);
+                }
+                m_cpu_replica[cpu] = node;
+            }
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the replica of the node of the calling thread, or the
+     *          empty dictionary if nothing is loaded.
+     */
+    const word_dict<TChar, TBase, TValue>& local() const
+    {
+        if (m_replicas.empty()) {
+            static const word_dict<TChar, TBase, TValue> empty_dict;
+            return empty_dict;
+        }
+
+        const int cpu = ::sched_getcpu();
+        if ((cpu < 0) || ((size_type)cpu >= m_cpu_replica.size())) {
+            return m_replicas[0];
+        }
+        return m_replicas[m_cpu_replica[cpu]];
+    }
+
+    const word_dict<TChar, TBase, TValue>& replica(const size_type node) const { return m_replicas[node]; }
+
+    size_type replicas_count() const { return m_replicas.size(); }
+
+private:
+    std::vector<word_dict<TChar, TBase, TValue>> m_replicas;
+    std::vector<size_type> m_cpu_replica;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_NUMA_DICT_H_ */
@@ -0,0 +1,269 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_ORDERED_INDEX_H_
+#define _WORDDICT_WORDDICT_ORDERED_INDEX_H_
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "worddict/guide.h"
+#include "worddict/worddict.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Ordered access to keys of the dictionary: iteration in the
+ *          order of keys, rank of the key and selection of the key by its
+ *          rank.
+ *
+ *  Rank and selection cost O(depth * fanout) by the counts of keys of
+ *  units kept in the guide, so the page of keys is read by select(n) and
+ *  the iteration from it.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class ordered_index final
+{
+    using codec = details::label_codec<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type  = word_dict<char_type, base_type, value_type>;
+    using guide_type = guide<char_type, base_type, value_type>;
+
+    /*
+     *  \brief  Forward iterator over keys. The path of the current key is
+     *          kept in the explicit stack, so the increment allocates
+     *          nothing, once the stack and the key have grown to the
+     *          length of the longest key.
+     */
+    class iterator final
+    {
+        friend class ordered_index;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = typename ordered_index::value_type;
+
+        iterator() {}
+
+        bool operator==(const iterator& other) const
+        {
+            return (m_path.empty() == other.m_path.empty()) && (m_labels == other.m_labels);
+        }
+        bool operator!=(const iterator& other) const { return ! (*this == other); }
+
+        iterator& operator++()
+        {
+            if (! m_path.empty()) {
+                if (m_p_guide->child(m_path.back()) == 0) {
+                    next_sibling();
+                } else {
+                    push(m_p_guide->child(m_path.back()));
+                }
+                if (! m_path.empty()) {
+                    first_key();
+                }
+            }
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator it = *this;
+            ++(*this);
+            return it;
+        }
+
+        std::basic_string_view<char_type> key() const { return m_key; }
+
+        value_type value() const { return m_p_dict->value(m_path.back()); }
+
+    private:
+        iterator(const dict_type& dict, const guide_type& guide)
+            : m_p_dict(&dict)
+            , m_p_guide(&guide)
+        {}
+
+        /*
+         *  \brief  Descends by the first children to the nearest key.
+         */
+        void first_key()
+        {
+            while (! m_p_dict->has_value(m_path.back())) {
+                push(m_p_guide->child(m_path.back()));
+            }
+            codec::decode(m_labels.data(), m_labels.size(), m_key);
+        }
+
+        /*
+         *  \brief  Moves to the next sibling of the nearest unit of the path
+         *          which has it, or to the end.
+         */
+        void next_sibling()
+        {
+            while (m_path.size() > 1) {
+                const label_type sibling = m_p_guide->sibling(m_path.back());
+                m_path.pop_back();
+                m_labels.pop_back();
+                if (sibling != 0) {
+                    push(sibling);
+                    return;
+                }
+            }
+            m_path.clear();
+            m_labels.clear();
+            m_key.clear();
+        }
+
+        void push(const label_type label)
+        {
+            base_type idx = m_path.back();
+            m_p_dict->follow_label(label, idx);
+            m_path.push_back(idx);
+            m_labels.push_back(label);
+        }
+
+    private:
+        const dict_type* m_p_dict = nullptr;
+        const guide_type* m_p_guide = nullptr;
+
+        std::vector<base_type> m_path;
+        std::vector<label_type> m_labels;
+        std::basic_string<char_type> m_key;
+    };
+
+    ordered_index(const dict_type& dict, const guide_type& guide)
+        : m_dict(dict)
+        , m_guide(guide)
+        , m_p_fold(details::fold_table<uchar_type>(dict.key_normalization()))
+    {}
+
+    iterator begin() const { return select(0); }
+
+    iterator end() const { return iterator(m_dict, m_guide); }
+
+    /*
+     *  \brief  Returns the count of keys less than the key: the position of
+     *          the key in the order of keys, if the dictionary contains it.
+     *          The key is normalized like keys of the dictionary.
+     */
+    size_type rank(const std::basic_string_view<char_type>& key) const
+    {
+        if (empty()) {
+            return 0;
+        }
+
+        size_type result = 0;
+        base_type idx = m_dict.root();
+        for (size_type i = 0; i < key.size(); ++i) {
+            char_type ch = key[i];
+            if (m_p_fold != nullptr) {
+                ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+            }
+            label_type labels[codec::max_labels];
+            const size_type count = codec::encode(ch, labels);
+            for (size_type j = 0; j < count; ++j) {
+                // The key of the unit is the prefix of the key.
+                result += m_dict.has_value(idx) ? 1 : 0;
+                for (label_type label = m_guide.child(idx); (label != 0) && (label < labels[j]); ) {
+                    base_type child_idx = idx;
+                    m_dict.follow_label(label, child_idx);
+                    result += m_guide.count(child_idx);
+                    label = m_guide.sibling(child_idx);
+                }
+                if (! m_dict.follow_label(labels[j], idx)) {
+                    return result;
+                }
+            }
+        }
+        return result;
+    }
+
+    /*
+     *  \brief  Returns the iterator to the key with the rank or end().
+     */
+    iterator select(size_type rank) const
+    {
+        iterator it(m_dict, m_guide);
+        if (rank >= size()) {
+            return it;
+        }
+
+        it.m_path.push_back(m_dict.root());
+        while (true) {
+            const base_type idx = it.m_path.back();
+            if (m_dict.has_value(idx)) {
+                if (rank == 0) {
+                    break;
+                }
+                --rank;
+            }
+
+            label_type label = m_guide.child(idx);
+            while (true) {
+                base_type child_idx = idx;
+                m_dict.follow_label(label, child_idx);
+                if (rank < m_guide.count(child_idx)) {
+                    it.m_path.push_back(child_idx);
+                    it.m_labels.push_back(label);
+                    break;
+                }
+                rank -= m_guide.count(child_idx);
+                label = m_guide.sibling(child_idx);
+            }
+        }
+        codec::decode(it.m_labels.data(), it.m_labels.size(), it.m_key);
+        return it;
+    }
+
+    /*
+     *  \brief  Returns true if the dictionary is empty or the guide is not
+     *          the guide of the dictionary.
+     */
+    bool empty() const { return m_dict.empty() || (m_guide.size() != m_dict.size()); }
+
+    /*
+     *  \brief  Returns the count of keys.
+     */
+    size_type size() const { return empty() ? 0 : m_guide.count(m_dict.root()); }
+
+private:
+    const dict_type& m_dict;
+    const guide_type& m_guide;
+    const uchar_type* m_p_fold;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_ORDERED_INDEX_H_ */
@@ -0,0 +1,393 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_PATTERN_MATCHER_H_
+#define _WORDDICT_WORDDICT_PATTERN_MATCHER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "worddict/guide.h"
+#include "worddict/worddict.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/char_walker.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Matcher of keys of the dictionary by the wildcard pattern.
+ *
+ *  The pattern consists of characters, '?' (any character), '*' (any
+ *  sequence of characters), character classes '[abc]', '[a-z]', '[^abc]'
+ *  and escaped characters '\?'.
+ *
+ *  The pattern is compiled to the NFA, which states are positions in the
+ *  pattern, so the set of active states is the 64-bit mask. The dictionary
+ *  is walked depth-first together with the set of active states: the walk
+ *  is cut when the set is empty, and the pairs (unit, set of states) from
+ *  which no key is matched are remembered, so the shared suffixes of keys
+ *  are not walked twice with the same set.
+ *
+ *  If keys of the dictionary are normalized, literals and classes of the
+ *  pattern are normalized when the pattern is compiled, so the pattern is
+ *  matched against normalized keys and they are reported as stored.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class pattern_matcher final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type  = word_dict<char_type, base_type, value_type>;
+    using guide_type = guide<char_type, base_type, value_type>;
+
+    /// Maximum count of tokens of the pattern.
+    static constexpr size_type max_tokens = 63;
+    /// Maximum count of characters of the class, which are followed
+    /// directly instead of the enumeration of transitions.
+    static constexpr size_type max_direct_chars = 16;
+
+    pattern_matcher(const dict_type& dict, const guide_type& guide)
+        : m_dict(dict)
+        , m_guide(guide)
+        , m_walker(dict, guide)
+        , m_p_fold(details::fold_table<uchar_type>(dict.key_normalization()))
+    {}
+
+    /*
+     *  \brief  Reports all keys matched by the pattern in the order of keys.
+     *  \param  callback - callable as callback(key, value).
+     *  \return false if the pattern is malformed.
+     */
+    template<typename TCallback>
+    bool match(const std::basic_string_view<char_type>& pattern, TCallback&& callback)
+    {
+        if (! compile(pattern)) {
+            return false;
+        }
+
+        m_failed.clear();
+        m_key.clear();
+        // The guide of another dictionary is not followed.
+        if (! m_dict.empty() && (m_guide.size() == m_dict.size())) {
+            walk(m_dict.root(), closure(1), callback);
+        }
+        return true;
+    }
+
+private:
+    enum class token_kind
+    {
+        literal,
+        any,
+        star,
+        char_class
+    };
+
+    struct token final
+    {
+        token_kind kind;
+        bool is_negated;
+        uchar_type ch;
+        size_type ranges_begin;
+        size_type ranges_end;
+    };
+
+    struct state_hash final
+    {
+        size_t operator()(const std::pair<base_type, uint64_t>& s) const
+        {
+            return std::hash<uint64_t>()(s.second * 0x9E3779B97F4A7C15ULL ^ s.first);
+        }
+    };
+
+    bool compile(const std::basic_string_view<char_type>& pattern)
+    {
+        m_tokens.clear();
+        m_ranges.clear();
+        for (size_type i = 0; i < pattern.size(); ++i) {
+            const uchar_type ch = static_cast<uchar_type>(pattern[i]);
+            token t = {token_kind::literal, false, ch, 0, 0};
+            if (ch == '?') {
+                t.kind = token_kind::any;
+            } else if (ch == '*') {
+                // Consecutive stars are the same star.
+                if (! m_tokens.empty() && (m_tokens.back().kind == token_kind::star)) {
+                    continue;
+                }
+                t.kind = token_kind::star;
+            } else if (ch == '\\') {
+                if (++i == pattern.size()) {
+                    return false;
+                }
+                t.ch = static_cast<uchar_type>(pattern[i]);
+            } else if (ch == '[') {
+                t.kind = token_kind::char_class;
+                if (! compile_class(pattern, i, t)) {
+                    return false;
+                }
+            }
+            if (t.kind == token_kind::literal) {
+                t.ch = fold(t.ch);
+            }
+
+            if (m_tokens.size() == max_tokens) {
+                return false;
+            }
+            m_tokens.push_back(t);
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Compiles the class started at the position i and moves i to
+     *          the closing bracket.
+     */
+    bool compile_class(const std::basic_string_view<char_type>& pattern, size_type& i, token& t)
+    {
+        ++i;
+        if ((i < pattern.size()) && (pattern[i] == '^')) {
+            t.is_negated = true;
+            ++i;
+        }
+
+        t.ranges_begin = m_ranges.size();
+        for (; (i < pattern.size()) && (pattern[i] != ']'); ++i) {
+            if ((pattern[i] == '\\') && (++i == pattern.size())) {
+                return false;
+            }
+            const uchar_type first = static_cast<uchar_type>(pattern[i]);
+            uchar_type last = first;
+            if ((i + 2 < pattern.size()) && (pattern[i + 1] == '-') && (pattern[i + 2] != ']')) {
+                i += 2;
+                if ((pattern[i] == '\\') && (++i == pattern.size())) {
+                    return false;
+                }
+                last = static_cast<uchar_type>(pattern[i]);
+                if (last < first) {
+                    return false;
+                }
+            }
+            m_ranges.emplace_back(first, last);
+        }
+        if ((i == pattern.size()) || (t.ranges_begin == m_ranges.size())) {
+            return false;
+        }
+        if (m_p_fold != nullptr) {
+            fold_class(t.ranges_begin);
+        }
+        t.ranges_end = m_ranges.size();
+        return true;
+    }
+
+    /*
+     *  \brief  Replaces ranges of the class, which are the last ones, by
+     *          ranges of their normalized characters.
+     */
+    void fold_class(const size_type ranges_begin)
+    {
+        std::vector<bool> is_folded(size_t(std::numeric_limits<uchar_type>::max()) + 1, false);
+        for (size_type r = ranges_begin; r < m_ranges.size(); ++r) {
+            for (uint32_t ch = m_ranges[r].first; ch <= m_ranges[r].second; ++ch) {
+                is_folded[m_p_fold[ch]] = true;
+            }
+        }
+        m_ranges.resize(ranges_begin);
+        for (uint32_t ch = 0; ch < is_folded.size(); ++ch) {
+            if (! is_folded[ch]) {
+                continue;
+            }
+            if ((m_ranges.size() > ranges_begin) && (m_ranges.back().second + uint32_t(1) == ch)) {
+                m_ranges.back().second = static_cast<uchar_type>(ch);
+            } else {
+                m_ranges.emplace_back(static_cast<uchar_type>(ch), static_cast<uchar_type>(ch));
+            }
+        }
+    }
+
+    uchar_type fold(const uchar_type ch) const { return (m_p_fold != nullptr) ? m_p_fold[ch] : ch; }
+
+    /*
+     *  \brief  Adds the states reachable by empty sequences of characters:
+     *          the star may match nothing. Bit i is the position i, bit of
+     *          the count of tokens is the final state.
+     */
+    uint64_t closure(uint64_t states) const
+    {
+        for (size_type pos = 0; pos < m_tokens.size(); ++pos) {
+            if ((states & bit(pos)) && (m_tokens[pos].kind == token_kind::star)) {
+                states |= bit(pos + 1);
+            }
+        }
+        return states;
+    }
+
+    uint64_t step(const uint64_t states, const uchar_type ch) const
+    {
+        uint64_t next = 0;
+        for (size_type pos = 0; pos < m_tokens.size(); ++pos) {
+            if (states & bit(pos)) {
+                const token& t = m_tokens[pos];
+                if (t.kind == token_kind::star) {
+                    next |= bit(pos);
+                } else if (is_matched(t, ch)) {
+                    next |= bit(pos + 1);
+                }
+            }
+        }
+        return closure(next);
+    }
+
+    bool is_matched(const token& t, const uchar_type ch) const
+    {
+        switch (t.kind) {
+            case token_kind::literal: return ch == t.ch;
+            case token_kind::any:     return true;
+            case token_kind::star:    return true;
+            case token_kind::char_class:
+                for (size_type r = t.ranges_begin; r < t.ranges_end; ++r) {
+                    if ((m_ranges[r].first <= ch) && (ch <= m_ranges[r].second)) {
+                        return ! t.is_negated;
+                    }
+                }
+                return t.is_negated;
+        }
+        return false;
+    }
+
+    /*
+     *  \brief  Collects the characters, which can be matched by the active
+     *          states, if they are few.
+     *  \return false if transitions of the unit must be enumerated.
+     */
+    bool direct_chars(const uint64_t states, std::vector<uchar_type>& chars) const
+    {
+        chars.clear();
+        for (size_type pos = 0; pos < m_tokens.size(); ++pos) {
+            if ((states & bit(pos)) == 0) {
+                continue;
+            }
+            const token& t = m_tokens[pos];
+            if (t.kind == token_kind::literal) {
+                chars.push_back(t.ch);
+            } else if ((t.kind == token_kind::char_class) && ! t.is_negated) {
+                for (size_type r = t.ranges_begin; r < t.ranges_end; ++r) {
+                    if ((size_type)(m_ranges[r].second - m_ranges[r].first) >= max_direct_chars) {
+                        return false;
+                    }
+                    for (uchar_type ch = m_ranges[r].first; ; ++ch) {
+                        chars.push_back(ch);
+                        if (ch == m_ranges[r].second) {
+                            break;
+                        }
+                    }
+                }
+            } else {
+                return false;
+            }
+            if (chars.size() > max_direct_chars) {
+                return false;
+            }
+        }
+        std::sort(chars.begin(), chars.end());
+        chars.erase(std::unique(chars.begin(), chars.end()), chars.end());
+        return true;
+    }
+
+    /*
+     *  \return true if some key is matched from the unit.
+     */
+    template<typename TCallback>
+    bool walk(const base_type idx, const uint64_t states, TCallback& callback)
+    {
+        if (m_failed.find(std::make_pair(idx, states)) != m_failed.end()) {
+            return false;
+        }
+
+        bool is_found = false;
+        if ((states & bit(m_tokens.size())) && m_dict.has_value(idx)) {
+            callback(std::basic_string_view<char_type>(m_key), m_dict.value(idx));
+            is_found = true;
+        }
+
+        std::vector<uchar_type> chars;
+        if (direct_chars(states, chars)) {
+            for (const uchar_type ch : chars) {
+                base_type next_idx = idx;
+                if (m_dict.follow(static_cast<char_type>(ch), next_idx)) {
+                    is_found |= walk_char(next_idx, states, ch, callback);
+                }
+            }
+        } else {
+            is_found |= m_walker.for_each_char(idx, [this, states, &callback](const base_type next_idx, const uchar_type ch) {
+                return walk_char(next_idx, states, ch, callback);
+            });
+        }
+
+        if (! is_found) {
+            m_failed.emplace(idx, states);
+        }
+        return is_found;
+    }
+
+    template<typename TCallback>
+    bool walk_char(const base_type idx, const uint64_t states, const uchar_type ch, TCallback& callback)
+    {
+        const uint64_t next = step(states, ch);
+        if (next == 0) {
+            return false;
+        }
+
+        m_key.push_back(static_cast<char_type>(ch));
+        const bool is_found = walk(idx, next, callback);
+        m_key.pop_back();
+        return is_found;
+    }
+
+    static uint64_t bit(const size_type pos) { return uint64_t(1) << pos; }
+
+private:
+    const dict_type& m_dict;
+    const guide_type& m_guide;
+    details::char_walker<char_type, base_type, value_type> m_walker;
+    const uchar_type* m_p_fold;
+
+    std::vector<token> m_tokens;
+    std::vector<std::pair<uchar_type, uchar_type>> m_ranges;
+
+    std::unordered_set<std::pair<base_type, uint64_t>, state_hash> m_failed;
+    std::basic_string<char_type> m_key;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_PATTERN_MATCHER_H_ */
@@ -0,0 +1,136 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_PAYLOAD_DICT_H_
+#define _WORDDICT_WORDDICT_PAYLOAD_DICT_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/mem_region.h"
+#include "worddict/details/payload_heap.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Dictionary of keys with byte payloads (lemmas, tags, etc.).
+ *
+ *  Payloads are stored in the contiguous heap, equal payloads once, and the
+ *  value of the key in the dictionary is the index of its payload in the
+ *  heap. Keys with equal payloads have equal values, so they share suffixes
+ *  of the DAWG. Payloads are returned as views into the heap, which is
+ *  owned by the dictionary or mapped from the file, so the lookup copies
+ *  nothing. The dictionary is built by the builder (see
+ *  builder::insert_payload and builder::build(payload_dict_type&)).
+ *
+ *  The heap is saved next to the dictionary into the file path + ".payloads".
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class payload_dict final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<TChar, TBase, TValue>;
+
+    payload_dict() {}
+
+    void clear()
+    {
+        m_dict.clear();
+        m_heap.clear();
+    }
+
+    const dict_type& dict() const { return m_dict; }
+
+    bool empty() const { return m_dict.empty(); }
+
+    /*
+     *  \brief  Finds the payload of the key.
+     *  \return false if there is no such key.
+     */
+    bool find(const std::basic_string_view<char_type>& key, std::string_view& payload) const
+    {
+        const value_type value = m_dict.find(key);
+        // The heap may be saved apart from the dictionary.
+        if ((value == -1) || (static_cast<size_type>(value) >= m_heap.count())) {
+            return false;
+        }
+        payload = m_heap[value];
+        return true;
+    }
+
+    bool load(const std::string& path, const page_policy policy = page_policy::regular)
+    {
+        clear();
+        if (! m_dict.load(path, policy) || ! m_heap.load(heap_path(path))) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool map(const std::string& path, const page_policy policy = page_policy::regular, const bool populate = false)
+    {
+        clear();
+        if (! m_dict.map(path, policy, populate) || ! m_heap.map(heap_path(path), policy, populate)) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     *  \brief  Returns the payload by its index: the value of the key in
+     *          the dictionary.
+     */
+    std::string_view payload(const size_type idx) const { return m_heap[idx]; }
+
+    /*
+     *  \brief  Returns the count of distinct payloads.
+     */
+    size_type payloads_count() const { return m_heap.count(); }
+
+    /*
+     *  \brief  Returns the size of distinct payloads in bytes.
+     */
+    size_type payloads_size() const { return m_heap.size_bytes(); }
+
+    bool save(const std::string& path) const { return m_dict.save(path) && m_heap.save(heap_path(path)); }
+
+private:
+    static std::string heap_path(const std::string& path) { return path + ".payloads"; }
+
+private:
+    dict_type m_dict;
+    details::payload_heap m_heap;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_PAYLOAD_DICT_H_ */
@@ -0,0 +1,194 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_QUERY_ENGINE_H_
+#define _WORDDICT_WORDDICT_QUERY_ENGINE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "worddict/lookup_executor.h"
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/work_pool.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Batch lookups of large arrays of keys and texts by the pool of
+ *          threads sharing the read-only dictionary.
+ *
+ *  The input is split into chunks, which are run by the work-stealing pool
+ *  (see details::work_pool). Every thread looks up its chunks by its own
+ *  interleaved executor and writes results to the preallocated output, so
+ *  threads share nothing but the dictionary on the hot path.
+ *
+ *  The pool runs up to details::work_pool::max_chunks (2^32 - 1) chunks at
+ *  once: larger inputs are run by several rounds of the pool, each of them
+ *  waits for the previous one.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class query_engine final
+{
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<char_type, base_type, value_type>;
+
+    /*
+     *  \brief  Token of the text found in the dictionary.
+     */
+    struct token final
+    {
+        size_type offset;
+        size_type length;
+        value_type value;
+    };
+
+    static constexpr size_type default_chunk_size = 4096;
+
+    /*
+     *  \param  threads - count of threads including the calling one, 0 for
+     *          the count of hardware threads.
+     *  \param  chunk_size - count of keys or characters of the text in the
+     *          chunk of the work.
+     */
+    explicit query_engine(const dict_type& dict, size_type threads = 0,
+                          const size_type chunk_size = default_chunk_size)
+        : m_pool((threads != 0) ? threads : std::max<size_type>(std::thread::hardware_concurrency(), 1))
+        , m_chunk_size(std::max<size_type>(chunk_size, 1))
+    {
+        for (size_type i = 0; i < m_pool.size(); ++i) {
+            m_executors.emplace_back(new executor_type(dict));
+        }
+    }
+
+    size_type chunk_size() const { return m_chunk_size; }
+
+    /*
+     *  \brief  Finds values of keys, -1 for missing ones.
+     */
+    void find(const std::basic_string_view<char_type>* p_keys, const size_type count, value_type* p_values)
+    {
+        m_pool.run(count / m_chunk_size + ((count % m_chunk_size) != 0 ? 1 : 0), [&](const size_t worker, const size_t chunk) {
+            const size_type first = chunk * m_chunk_size;
+            const size_type size = std::min(m_chunk_size, count - first);
+            m_executors[worker]->find(p_keys + first, size, p_values + first);
+        });
+    }
+
+    /*
+     *  \brief  Looks up tokens of the text split by separators. Tokens are
+     *          reported in the order of the text, missing ones are skipped.
+     *  \param  is_separator - callable as is_separator(ch).
+     */
+    template<typename TIsSeparator>
+    void find_tokens(const std::basic_string_view<char_type>& text, TIsSeparator&& is_separator,
+                     std::vector<token>& tokens)
+    {
+        tokens.clear();
+
+        // Chunks are cut at separators, so tokens do not cross them.
+        std::vector<size_type> bounds(1, 0);
+        while (bounds.back() < text.size()) {
+            size_type bound = std::min<size_type>(bounds.back() + m_chunk_size, text.size());
+            while ((bound < text.size()) && ! is_separator(text[bound])) {
+                ++bound;
+            }
+            bounds.push_back(bound);
+        }
+
+        std::vector<std::vector<token>> chunk_tokens(bounds.size() - 1);
+        m_pool.run(chunk_tokens.size(), [&](const size_t worker, const size_t chunk) {
+            find_chunk_tokens(*m_executors[worker], text, bounds[chunk], bounds[chunk + 1], is_separator,
+                              chunk_tokens[chunk]);
+        });
+
+        size_type count = 0;
+        for (const std::vector<token>& t : chunk_tokens) {
+            count += t.size();
+        }
+        tokens.reserve(count);
+        for (const std::vector<token>& t : chunk_tokens) {
+            tokens.insert(tokens.end(), t.cbegin(), t.cend());
+        }
+    }
+
+    /*
+     *  \brief  Looks up tokens of the text split by whitespaces.
+     */
+    void find_tokens(const std::basic_string_view<char_type>& text, std::vector<token>& tokens)
+    {
+        find_tokens(text, [](const char_type ch) {
+            return (ch == ' ') || (ch == '\t') || (ch == '\n') || (ch == '\r') || (ch == '\f') || (ch == '\v');
+        }, tokens);
+    }
+
+    size_type threads_count() const { return m_pool.size(); }
+
+private:
+    using executor_type = lookup_executor<char_type, base_type, value_type>;
+
+    template<typename TIsSeparator>
+    static void find_chunk_tokens(executor_type& executor, const std::basic_string_view<char_type>& text,
+                                  const size_type first, const size_type end, TIsSeparator& is_separator,
+                                  std::vector<token>& tokens)
+    {
+        std::vector<std::basic_string_view<char_type>> keys;
+        std::vector<size_type> offsets;
+        for (size_type i = first; i < end; ) {
+            while ((i < end) && is_separator(text[i])) {
+                ++i;
+            }
+            const size_type start = i;
+            while ((i < end) && ! is_separator(text[i])) {
+                ++i;
+            }
+            if (i > start) {
+                keys.push_back(text.substr(start, i - start));
+                offsets.push_back(start);
+            }
+        }
+
+        std::vector<value_type> values(keys.size());
+        executor.find(keys.data(), keys.size(), values.data());
+        for (size_type i = 0; i < keys.size(); ++i) {
+            if (values[i] != -1) {
+                tokens.push_back({offsets[i], keys[i].size(), values[i]});
+            }
+        }
+    }
+
+private:
+    details::work_pool m_pool;
+    const size_type m_chunk_size;
+    std::vector<std::unique_ptr<executor_type>> m_executors;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_QUERY_ENGINE_H_ */
@@ -0,0 +1,256 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_SCANNER_H_
+#define _WORDDICT_WORDDICT_SCANNER_H_
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <tmmintrin.h>
+    #define _WORDDICT_HAS_SSSE3_INTRINSICS 1
+#endif
+
+#include <array>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+#include "worddict/details/scanner_builder.h"
+
+namespace wstux {
+namespace wd {
+
+template<typename TChar, typename TBase, typename TValue>
+class builder;
+
+/*
+ *  \brief  Aho-Corasick automaton over the keys of the dictionary: finds
+ *          all occurrences of all keys in the text in one pass.
+ *
+ *  In the root state characters which can not start a key are skipped by
+ *  the bitmap of the first labels of keys. Texts of bytes are skipped by
+ *  16 bytes at once, if the CPU supports SSSE3: the set of bytes, which can
+ *  start a key, is looked up by the low and the high nibbles of bytes with
+ *  PSHUFB.
+ *
+ *  If keys are normalized, characters of the text are normalized in the
+ *  same way, so occurrences are found regardless of the case.
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class scanner final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+    using codec     = details::label_codec<TChar, TBase, TValue>;
+    using node_type = details::scanner_node<TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    scanner() {}
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_labels.clear();
+        m_start_bitmap.clear();
+        m_start_nibbles = {};
+        m_p_fold = nullptr;
+    }
+
+    bool empty() const { return m_nodes.size() <= 1; }
+
+    /*
+     *  \brief  Reports all occurrences of keys in the text.
+     *  \param  callback - callable as callback(offset, length, value), the
+     *          offset and the length are counted in characters.
+     */
+    template<typename TCallback>
+    void scan(const std::basic_string_view<char_type>& text, TCallback&& callback) const
+    {
+        if (empty()) {
+            return;
+        }
+
+        base_type node = 0;
+        for (size_type i = 0; i < text.size(); ++i) {
+            if (node == 0) {
+                i = skip(text, i);
+                if (i == text.size()) {
+                    break;
+                }
+            }
+
+            label_type labels[codec::max_labels];
+            const size_type count = codec::encode(fold(text[i]), labels);
+            for (size_type j = 0; j < count; ++j) {
+                node = next(node, labels[j]);
+            }
+
+            for (base_type out = (m_nodes[node].value >= 0) ? node : m_nodes[node].output;
+                 out != 0; out = m_nodes[out].output) {
+                const size_type length = m_nodes[out].depth;
+                callback(i + 1 - length, length, m_nodes[out].value);
+            }
+        }
+    }
+
+    /*
+     *  \brief  Returns the count of states of the automaton.
+     */
+    size_type size() const { return m_nodes.size(); }
+
+private:
+    void assign(std::vector<node_type>&& nodes, std::vector<label_type>&& labels, const normalization norm)
+    {
+        clear();
+        m_nodes = std::move(nodes);
+        m_labels = std::move(labels);
+        m_p_fold = details::fold_table<uchar_type>(norm);
+
+        m_start_bitmap.assign((size_type(1) << (sizeof(label_type) * 8)) / 64, 0);
+        for (base_type child = m_nodes[0].first_child; child < m_nodes[0].first_child + m_nodes[0].children; ++child) {
+            m_start_bitmap[m_labels[child] / 64] |= uint64_t(1) << (m_labels[child] % 64);
+        }
+        // Bytes of the text, which are folded to the first labels of keys:
+        // the bit (hi % 8) of the row (hi / 8) at the column lo is set for
+        // the byte (hi << 4 | lo).
+        if constexpr (sizeof(char_type) == 1) {
+            for (size_type ch = 0; ch <= std::numeric_limits<uchar_type>::max(); ++ch) {
+                if (is_start(static_cast<char_type>(ch))) {
+                    m_start_nibbles[ch >> 7][ch & 0x0F] |= static_cast<unsigned char>(1 << ((ch >> 4) & 0x07));
+                }
+            }
+        }
+    }
+
+    char_type fold(const char_type ch) const
+    {
+        return (m_p_fold != nullptr) ? static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]) : ch;
+    }
+
+    base_type next(base_type node, const label_type label) const
+    {
+        while (true) {
+            const base_type child = find_child(node, label);
+            if ((child != 0) || (node == 0)) {
+                return child;
+            }
+            node = m_nodes[node].fail;
+        }
+    }
+
+    base_type find_child(const base_type node, const label_type label) const
+    {
+        const base_type first = m_nodes[node].first_child;
+        const base_type last = first + m_nodes[node].children;
+        if ((last - first) <= 8) {
+            for (base_type child = first; child < last; ++child) {
+                if (m_labels[child] == label) {
+                    return child;
+                }
+            }
+            return 0;
+        }
+        return details::scanner_builder<TChar, TBase, TValue>::find_child(m_nodes, m_labels, node, label);
+    }
+
+    bool is_start(const char_type ch) const
+    {
+        label_type labels[codec::max_labels];
+        codec::encode(fold(ch), labels);
+        return (m_start_bitmap[labels[0] / 64] >> (labels[0] % 64)) & 1;
+    }
+
+    /*
+     *  \brief  Returns the position of the first character in the text,
+     *          which can start a key.
+     */
+    size_type skip(const std::basic_string_view<char_type>& text, size_type i) const
+    {
+#if defined(_WORDDICT_HAS_SSSE3_INTRINSICS)
+        if constexpr (sizeof(char_type) == 1) {
+            static const bool is_ssse3 = __builtin_cpu_supports("ssse3");
+            if (is_ssse3) {
+                i = skip_ssse3(text, i);
+            }
+        }
+#endif
+        while ((i < text.size()) && ! is_start(text[i])) {
+            ++i;
+        }
+        return i;
+    }
+
+#if defined(_WORDDICT_HAS_SSSE3_INTRINSICS)
+    __attribute__((target("ssse3")))
+    size_type skip_ssse3(const std::basic_string_view<char_type>& text, size_type i) const
+    {
+        const __m128i low_rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_start_nibbles[0].data()));
+        const __m128i high_rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_start_nibbles[1].data()));
+        // The bit of the high nibble in its row and the mask of high rows.
+        const __m128i hi_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m128i hi_rows = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; i + 16 <= text.size(); i += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+            const __m128i lo = _mm_and_si128(chunk, nibble);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble);
+
+            const __m128i is_high = _mm_shuffle_epi8(hi_rows, hi);
+            const __m128i row = _mm_or_si128(_mm_andnot_si128(is_high, _mm_shuffle_epi8(low_rows, lo)),
+                                             _mm_and_si128(is_high, _mm_shuffle_epi8(high_rows, lo)));
+            const __m128i is_miss = _mm_cmpeq_epi8(_mm_and_si128(row, _mm_shuffle_epi8(hi_bits, hi)), zero);
+            const int mask = ~_mm_movemask_epi8(is_miss) & 0xFFFF;
+            if (mask != 0) {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        return i;
+    }
+#endif
+
+private:
+    std::vector<node_type> m_nodes;
+    std::vector<label_type> m_labels;
+
+    std::vector<uint64_t> m_start_bitmap;
+    /// Rows of bytes, which can start a key, by low nibbles: bytes of high
+    /// nibbles 0-7 and 8-15 (see skip_ssse3).
+    std::array<std::array<unsigned char, 16>, 2> m_start_nibbles = {};
+
+    const uchar_type* m_p_fold = nullptr;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_SCANNER_H_ */
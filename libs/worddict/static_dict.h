@@ -0,0 +1,332 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_STATIC_DICT_H_
+#define _WORDDICT_WORDDICT_STATIC_DICT_H_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "worddict/details/dict_unit.h"
+#include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Dictionary of the small set of keys fixed at compile time.
+ *
+ *  The double-array is built by the constexpr constructor into the array of
+ *  the fixed capacity, so the constexpr dictionary is placed in read-only
+ *  data and needs neither the startup nor allocations. The value of the key
+ *  is its index in the array of keys. Keys are not minimized into the DAWG,
+ *  so the dictionary is meant for hundreds or a few thousands of keys.
+ *
+ *  Units have the layout of word_dict units, so find() may be evaluated at
+ *  compile time as well as at run time, and word_dict may use units in
+ *  place (see word_dict::attach_units).
+ *
+ *      constexpr std::string_view keys[] = {"and", "or", "the"};
+ *      constexpr wstux::wd::static_dict<char, 1024> stop_words(keys);
+ *      static_assert(stop_words.is_built() && (stop_words.find("or") == 1));
+ */
+template<typename TChar, size_t NUnits, typename TBase = uint32_t,
+         typename TValue = typename details::char_traits<TChar>::value_type>
+class static_dict final
+{
+    using codec = details::label_codec<TChar, TBase, TValue>;
+    using unit  = details::dict_unit<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    /// Children of the unit are placed in its block of units.
+    static constexpr size_type block_size = size_type(1) << unit::label_bits;
+
+    static_assert(unit::label_bits == 8, "static_dict: byte labels are required");
+    static_assert((NUnits >= block_size) && ((NUnits % block_size) == 0),
+                  "static_dict: the capacity must be a multiple of 256 units");
+
+    constexpr static_dict()
+        : m_units{}
+    {}
+
+    /*
+     *  \brief  Builds the dictionary of keys sorted in the ascending order of
+     *          unsigned characters. Keys must be distinct and not empty.
+     *          If keys do not fit the capacity or are not sorted, the
+     *          dictionary is empty and is_built() returns false.
+     */
+    template<size_t NKeys>
+    constexpr explicit static_dict(const std::basic_string_view<char_type> (&keys)[NKeys])
+        : m_units{}
+    {
+        builder b(keys, NKeys, m_units);
+        if (b.build()) {
+            m_size = b.size();
+            m_keys_count = NKeys;
+            m_is_built = true;
+        } else {
+            m_units = {};
+        }
+    }
+
+    static constexpr size_type capacity() { return NUnits; }
+
+    constexpr const base_type* data() const { return m_units.data(); }
+
+    constexpr bool empty() const { return m_keys_count == 0; }
+
+    /*
+     *  \brief  Returns the index of the key or -1.
+     */
+    constexpr value_type find(const std::basic_string_view<char_type>& key) const
+    {
+        if (empty()) {
+            return -1;
+        }
+
+        base_type idx = 0;
+        label_type labels[codec::max_labels] = {};
+        for (const char_type ch : key) {
+            const size_type count = codec::encode(ch, labels);
+            for (size_type i = 0; i < count; ++i) {
+                const base_type next_idx = idx ^ unit::offset(m_units[idx]) ^ labels[i];
+                if (unit::label(m_units[next_idx]) != labels[i]) {
+                    return -1;
+                }
+                idx = next_idx;
+            }
+        }
+        return unit::has_leaf(m_units[idx]) ? unit::value(m_units[idx ^ unit::offset(m_units[idx])]) : -1;
+    }
+
+    constexpr bool is_built() const { return m_is_built; }
+
+    /*
+     *  \brief  Returns the count of keys.
+     */
+    constexpr size_type keys_count() const { return m_keys_count; }
+
+    /*
+     *  \brief  Returns the count of used units: the prefix of the array
+     *          which is looked up.
+     */
+    constexpr size_type size() const { return m_size; }
+
+private:
+    /*
+     *  \brief  Builder of the double-array over the trie of keys.
+     *
+     *  Children of the state are placed by the first fit: the first base
+     *  whose units of labels of children are free. Every base is used once,
+     *  and free units are labelled by the base unused in their block, so
+     *  transitions by missing labels never match (like in dict_builder).
+     */
+    class builder final
+    {
+    public:
+        constexpr builder(const std::basic_string_view<char_type>* p_keys, const size_type count,
+                          std::array<base_type, NUnits>& units)
+            : m_p_keys(p_keys)
+            , m_count(count)
+            , m_units(units)
+            , m_is_used{}
+            , m_is_fixed{}
+        {}
+
+        constexpr bool build()
+        {
+            for (size_type i = 0; i < m_count; ++i) {
+                if (m_p_keys[i].empty() || ((i > 0) && ! is_less(m_p_keys[i - 1], m_p_keys[i]))) {
+                    return false;
+                }
+            }
+            if (m_count == 0) {
+                return true;
+            }
+            if ((uint64_t)m_count > (uint64_t)unit::value_max) {
+                return false;
+            }
+
+            // The root is not a child of any state, and the base 0 would
+            // place the leaf of the root into the root.
+            m_is_fixed[0] = true;
+            m_is_used[0] = true;
+            m_next_free = 1;
+            return arrange(0, m_count, 0, 0) && fix_blocks();
+        }
+
+        constexpr size_type size() const { return m_size; }
+
+    private:
+        static constexpr bool is_less(const std::basic_string_view<char_type>& lhs,
+                                      const std::basic_string_view<char_type>& rhs)
+        {
+            for (size_type i = 0; (i < lhs.size()) && (i < rhs.size()); ++i) {
+                if (static_cast<uchar_type>(lhs[i]) != static_cast<uchar_type>(rhs[i])) {
+                    return static_cast<uchar_type>(lhs[i]) < static_cast<uchar_type>(rhs[i]);
+                }
+            }
+            return lhs.size() < rhs.size();
+        }
+
+        /*
+         *  \brief  Returns the label of the key at the position or 0 if the
+         *          key is shorter.
+         */
+        static constexpr label_type label_at(const std::basic_string_view<char_type>& key, const size_type pos)
+        {
+            size_type count = 0;
+            label_type labels[codec::max_labels] = {};
+            for (const char_type ch : key) {
+                const size_type len = codec::encode(ch, labels);
+                if (pos < count + len) {
+                    return labels[pos - count];
+                }
+                count += len;
+            }
+            return 0;
+        }
+
+        /*
+         *  \brief  Arranges children of the state of keys [first, last),
+         *          which share the first depth labels, and their subtrees.
+         */
+        constexpr bool arrange(const size_type first, const size_type last, const size_type depth, const base_type idx)
+        {
+            // The key which ends at the state is the first one of the range.
+            label_type labels[block_size] = {};
+            size_type count = 0;
+            for (size_type i = first; i < last; ++i) {
+                const label_type label = label_at(m_p_keys[i], depth);
+                if ((count == 0) || (labels[count - 1] != label)) {
+                    labels[count++] = label;
+                }
+            }
+
+            base_type base = 0;
+            if (! find_base(labels, count, base) || ! unit::set_offset(m_units[idx], idx ^ base)) {
+                return false;
+            }
+            m_is_used[base] = true;
+            for (size_type i = 0; i < count; ++i) {
+                const base_type child = base ^ labels[i];
+                m_is_fixed[child] = true;
+                m_size = (child >= m_size) ? ((child | (block_size - 1)) + 1) : m_size;
+            }
+
+            size_type i = first;
+            for (size_type c = 0; c < count; ++c) {
+                const base_type child = base ^ labels[c];
+                if (labels[c] == 0) {
+                    unit::set_has_leaf(m_units[idx]);
+                    unit::set_value(m_units[child], static_cast<value_type>(i));
+                    ++i;
+                    continue;
+                }
+
+                unit::set_label(m_units[child], labels[c]);
+                size_type end = i + 1;
+                while ((end < last) && (label_at(m_p_keys[end], depth) == labels[c])) {
+                    ++end;
+                }
+                if (! arrange(i, end, depth + 1, child)) {
+                    return false;
+                }
+                i = end;
+            }
+            return true;
+        }
+
+        /*
+         *  \brief  Finds the first unused base, whose units of labels are
+         *          free and lie in the capacity.
+         */
+        constexpr bool find_base(const label_type* p_labels, const size_type count, base_type& base)
+        {
+            while ((m_next_free < NUnits) && m_is_fixed[m_next_free]) {
+                ++m_next_free;
+            }
+            for (size_type free = m_next_free; free < NUnits; ++free) {
+                if (m_is_fixed[free]) {
+                    continue;
+                }
+                base = static_cast<base_type>(free ^ p_labels[0]);
+                if (m_is_used[base]) {
+                    continue;
+                }
+                bool is_good = true;
+                for (size_type i = 1; is_good && (i < count); ++i) {
+                    is_good = ! m_is_fixed[base ^ p_labels[i]];
+                }
+                if (is_good) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        constexpr bool fix_blocks()
+        {
+            for (size_type begin = 0; begin < m_size; begin += block_size) {
+                size_type unused_base = begin;
+                while ((unused_base < begin + block_size) && m_is_used[unused_base]) {
+                    ++unused_base;
+                }
+                if (unused_base == begin + block_size) {
+                    return false;
+                }
+                for (size_type idx = begin; idx < begin + block_size; ++idx) {
+                    if (! m_is_fixed[idx]) {
+                        unit::set_label(m_units[idx], static_cast<label_type>(idx ^ unused_base));
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        const std::basic_string_view<char_type>* m_p_keys;
+        const size_type m_count;
+        std::array<base_type, NUnits>& m_units;
+
+        std::array<bool, NUnits> m_is_used;
+        std::array<bool, NUnits> m_is_fixed;
+        size_type m_next_free = 0;
+        size_type m_size = 0;
+    };
+
+private:
+    std::array<base_type, NUnits> m_units;
+    size_type m_size = 0;
+    size_type m_keys_count = 0;
+    bool m_is_built = false;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_STATIC_DICT_H_ */
@@ -0,0 +1,169 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WORDDICT_WORDDICT_UNION_DICT_H_
+#define _WORDDICT_WORDDICT_UNION_DICT_H_
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "worddict/worddict.h"
+#include "worddict/details/dictraits.h"
+
+namespace wstux {
+namespace wd {
+
+/*
+ *  \brief  Union of several source dictionaries (e.g. general, domain,
+ *          user and blacklist ones) looked up by the single walk.
+ *
+ *  Keys of all sources are built into one DAWG, whose value of the key is
+ *  the entry: the mask of sources which contain the key and values of the
+ *  key in them. Equal entries are stored once, so keys with equal entries
+ *  share suffixes of the DAWG like keys with equal values do, and the union
+ *  stays minimal across sources. The union is built by the builder (see
+ *  builder::build(union_dict_type&, const std::vector<key_set>&)).
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
+class union_dict final
+{
+    friend class builder<TChar, TBase, TValue>;
+
+public:
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    using dict_type = word_dict<TChar, TBase, TValue>;
+
+    static constexpr size_type max_sources = 64;
+
+    /*
+     *  \brief  Sources which contain the key and values of the key in them.
+     */
+    class entry final
+    {
+        friend class union_dict;
+
+    public:
+        entry() {}
+
+        bool contains(const size_type source) const
+        {
+            return (source < max_sources) && ((m_sources >> source) & 1);
+        }
+
+        bool empty() const { return m_sources == 0; }
+
+        /*
+         *  \brief  Returns the mask of sources: the bit i is set if the
+         *          source i contains the key.
+         */
+        uint64_t sources() const { return m_sources; }
+
+        /*
+         *  \brief  Returns the value of the key in the source or -1.
+         */
+        value_type value(const size_type source) const
+        {
+            if (! contains(source)) {
+                return -1;
+            }
+            // Values are stored in the order of sources.
+            return m_p_values[__builtin_popcountll(m_sources & ((uint64_t(1) << source) - 1))];
+        }
+
+    private:
+        entry(const uint64_t sources, const value_type* p_values)
+            : m_sources(sources)
+            , m_p_values(p_values)
+        {}
+
+    private:
+        uint64_t m_sources = 0;
+        const value_type* m_p_values = nullptr;
+    };
+
+    union_dict() {}
+
+    void clear()
+    {
+        m_dict.clear();
+        m_sources.clear();
+        m_offsets.clear();
+        m_values.clear();
+        m_sources_count = 0;
+    }
+
+    /*
+     *  \brief  Reports keys which are prefixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, entry).
+     */
+    template<typename TCallback>
+    void common_prefix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        m_dict.common_prefix_search(key, [this, &callback](const size_type len, const value_type value) {
+            callback(len, make_entry(value));
+        });
+    }
+
+    const dict_type& dict() const { return m_dict; }
+
+    bool empty() const { return m_dict.empty(); }
+
+    /*
+     *  \brief  Returns the count of distinct entries of keys.
+     */
+    size_type entries_count() const { return m_sources.size(); }
+
+    /*
+     *  \brief  Returns sources which contain the key, the empty entry if
+     *          there are no such sources.
+     */
+    entry find(const std::basic_string_view<char_type>& key) const
+    {
+        const value_type value = m_dict.find(key);
+        return (value != -1) ? make_entry(value) : entry();
+    }
+
+    size_type sources_count() const { return m_sources_count; }
+
+private:
+    entry make_entry(const value_type idx) const
+    {
+        return entry(m_sources[idx], m_values.data() + m_offsets[idx]);
+    }
+
+private:
+    dict_type m_dict;
+
+    /// Masks of sources of entries.
+    std::vector<uint64_t> m_sources;
+    /// Offsets of values of entries.
+    std::vector<size_type> m_offsets;
+    std::vector<value_type> m_values;
+    size_type m_sources_count = 0;
+};
+
+} // namespace wd
+} // namespace wstux
+
+#endif /* _WORDDICT_WORDDICT_UNION_DICT_H_ */
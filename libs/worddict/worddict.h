@@ -19,44 +19,793 @@
 #ifndef _WORDDICT_WORDDICT_WORDDICT_H_
 #define _WORDDICT_WORDDICT_WORDDICT_H_
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include "worddict/lookup_stats.h"
+#include "worddict/details/case_folding.h"
+#include "worddict/details/dict_file.h"
+#include "worddict/details/dict_unit.h"
 #include "worddict/details/dictraits.h"
+#include "worddict/details/label_codec.h"
+#include "worddict/details/mem_region.h"
+#include "worddict/details/packed_values.h"
+#include "worddict/details/xor_filter.h"
 
 namespace wstux {
 namespace wd {
 
-template<typename TChar>
+template<typename TChar, typename TBase, typename TValue>
+class builder;
+
+template<typename TChar, typename TBase, typename TValue>
+class cold_dict;
+
+/*
+ *  \brief  Dictionary represented by the double-array.
+ *
+ *  The units of the dictionary are owned by the heap array (built or
+ *  loaded dictionary) or by the read-only mapping of the file.
+ *
+ *  Values are stored in the leaf units or, if the dictionary is built with
+ *  the packed coding of values, leaf units keep indexes of the distinct
+ *  values in the bit-packed array.
+ *
+ *  Keys of the dictionary built with the normalization are normalized, so
+ *  the queried keys are normalized in the same way character by character
+ *  when they are followed.
+ *
+ *  The file is self-describing: the header keeps the traits of the
+ *  dictionary and the layout of sections, which are checked by CRC32C
+ *  checksums of chunks (see details::file_header).
+ */
+template<typename TChar, typename TBase = uint32_t, typename TValue = typename details::char_traits<TChar>::value_type>
 class word_dict final
 {
+    friend class builder<TChar, TBase, TValue>;
+    friend class cold_dict<TChar, TBase, TValue>;
+
+    using codec = details::label_codec<TChar, TBase, TValue>;
+    using unit  = details::dict_unit<TChar, TBase, TValue>;
+
 public:
-    using base_type  = typename details::traits<TChar>::base_type;
-    using char_type  = typename details::traits<TChar>::char_type;
-    using size_type  = typename details::traits<TChar>::size_type;
-    using uchar_type = typename details::traits<TChar>::uchar_type;
-    using value_type = typename details::traits<TChar>::value_type;
+    using base_type  = typename details::traits<TChar, TBase, TValue>::base_type;
+    using char_type  = typename details::traits<TChar, TBase, TValue>::char_type;
+    using label_type = typename details::traits<TChar, TBase, TValue>::label_type;
+    using size_type  = typename details::traits<TChar, TBase, TValue>::size_type;
+    using uchar_type = typename details::traits<TChar, TBase, TValue>::uchar_type;
+    using value_type = typename details::traits<TChar, TBase, TValue>::value_type;
+
+    word_dict() {}
+
+    word_dict(const word_dict&) = delete;
+    word_dict(word_dict&& other) { *this = std::move(other); }
+
+    word_dict& operator=(const word_dict&) = delete;
+    word_dict& operator=(word_dict&& other)
+    {
+        if (this != &other) {
+            m_units = std::move(other.m_units);
+            m_region = std::move(other.m_region);
+            m_p_units = std::exchange(other.m_p_units, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_hot_size = std::exchange(other.m_hot_size, 0);
+            m_dead_state = std::exchange(other.m_dead_state, 0);
+            m_values = std::move(other.m_values);
+            m_normalization = std::exchange(other.m_normalization, normalization::none);
+            m_p_fold = std::exchange(other.m_p_fold, nullptr);
+            m_states_count = std::exchange(other.m_states_count, 0);
+            m_transitions_count = std::exchange(other.m_transitions_count, 0);
+            m_checksums = std::move(other.m_checksums);
+            m_chunk_size = std::exchange(other.m_chunk_size, 0);
+            m_dispatch = std::move(other.m_dispatch);
+            m_dispatch_depth = std::exchange(other.m_dispatch_depth, 0);
+            m_filter = std::move(other.m_filter);
+            other.m_filter.clear();
+        }
+        return *this;
+    }
+
+    void clear()
+    {
+        m_units.clear();
+        m_region.release();
+        m_p_units = nullptr;
+        m_size = 0;
+        m_hot_size = 0;
+        m_dead_state = 0;
+        m_values.clear();
+        m_normalization = normalization::none;
+        m_p_fold = nullptr;
+        m_states_count = 0;
+        m_transitions_count = 0;
+        m_checksums.clear();
+        m_chunk_size = 0;
+        m_dispatch.clear();
+        m_dispatch_depth = 0;
+        m_filter.clear();
+    }
+
+    /*
+     *  \brief  Uses units of the double-array with values stored in leaf
+     *          units in place, e.g. units of static_dict. Units must outlive
+     *          the dictionary.
+     */
+    void attach_units(const base_type* p_units, const size_type size)
+    {
+        clear();
+        m_p_units = (size != 0) ? p_units : nullptr;
+        m_size = (p_units != nullptr) ? size : 0;
+    }
+
+    /*
+     *  \brief  Builds the table of states after the first characters of
+     *          keys, so find() starts from the state of the first depth
+     *          characters instead of walking them from the root. The table
+     *          is indexed by characters coded by one label and holds up to
+     *          64K states: 1 or 2 characters of 8-bit labels, 1 character of
+     *          16-bit labels. The depth 0 drops the table.
+     *  \return false if the depth is not supported.
+     */
+    bool build_dispatch(const size_type depth)
+    {
+        m_dispatch.clear();
+        m_dispatch_depth = 0;
+        size_type entries = 1;
+        for (size_type i = 0; i < depth; ++i) {
+            entries *= dispatch_alphabet;
+        }
+        if (entries > max_dispatch_entries) {
+            return false;
+        }
+        if ((depth == 0) || empty()) {
+            return true;
+        }
+
+        m_dispatch.assign(entries, root());
+        for (size_type i = 0; i < entries; ++i) {
+            base_type idx = root();
+            // The first character is the most significant digit of the index.
+            for (size_type j = 0, divisor = entries; j < depth; ++j) {
+                divisor /= dispatch_alphabet;
+                const label_type label = static_cast<label_type>((i / divisor) % dispatch_alphabet);
+                if ((label == 0) || ! follow_label(label, idx)) {
+                    idx = root();
+                    break;
+                }
+            }
+            m_dispatch[i] = idx;
+        }
+        m_dispatch_depth = depth;
+        return true;
+    }
+
+    const base_type* data() const { return m_p_units; }
+
+    size_type dispatch_depth() const { return m_dispatch_depth; }
+
+    bool empty() const { return m_size == 0; }
+
+    /*
+     *  \brief  Returns the size of the filter of keys in bytes, 0 if the
+     *          dictionary has no filter.
+     */
+    size_type filter_size() const { return m_filter.size_bytes(); }
+
+    /*
+     *  \brief  Returns the count of units in the prefix of the array which
+     *          holds the hot states of the profile-driven layout.
+     */
+    size_type hot_size() const { return m_hot_size; }
+
+    /*
+     *  \brief  Returns true if the array ends with the block of the dead
+     *          state, so find() walks keys without branches on missed
+     *          transitions (see builder::set_branch_free).
+     */
+    bool has_dead_state() const { return m_dead_state != 0; }
+
+    /*
+     *  \brief  Returns the normalization of keys.
+     */
+    normalization key_normalization() const { return m_normalization; }
+
+    /*
+     *  \brief  Returns true if the units are mapped from the file.
+     */
+    bool is_mapped() const { return m_region.is_mapped(); }
+
+    /*
+     *  \brief  Returns true if the units are backed by huge pages.
+     */
+    bool is_huge_paged() const { return m_region.is_huge(); }
+
+    /*
+     *  \brief  Returns true if values are stored in the bit-packed array.
+     */
+    bool is_values_packed() const { return ! m_values.empty(); }
+
+    /*
+     *  \brief  Loads the dictionary from the file into anonymous memory
+     *          backed by the pages of the policy.
+     *  \param  mode - verification of checksums of the loaded sections.
+     */
+    bool load(const std::string& path, const page_policy policy = page_policy::regular,
+              const verification mode = verification::full)
+    {
+        clear();
+
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = in.tellg();
+        details::file_header header;
+        if (! in.seekg(0) || ! in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || ! is_valid_header(header, file_size)) {
+            return false;
+        }
+
+        details::mem_region region;
+        if (! region.allocate(header.units_count * sizeof(base_type), policy)) {
+            return false;
+        }
+        if (! in.read(reinterpret_cast<char*>(region.data()), header.units_count * sizeof(base_type))) {
+            return false;
+        }
+        region.protect();
+
+        std::vector<uint64_t> words(header.values_words, 0);
+        std::vector<uint8_t> fingerprints(header.filter_bytes, 0);
+        std::vector<uint32_t> checksums(header.checksums_count, 0);
+        if (! in.seekg(header.values_offset) || ! in.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint64_t))
+            || ! in.seekg(header.filter_offset) || ! in.read(reinterpret_cast<char*>(fingerprints.data()), fingerprints.size())
+            || ! in.seekg(header.checksums_offset)
+            || ! in.read(reinterpret_cast<char*>(checksums.data()), checksums.size() * sizeof(uint32_t))) {
+            return false;
+        }
+
+        details::packed_values<value_type> values;
+        if ((header.values_words != 0) && ! values.assign(std::move(words))) {
+            return false;
+        }
+        details::xor_filter filter;
+        if ((header.filter_bytes != 0)
+            && ! filter.assign(std::move(fingerprints), header.filter_block_size, header.filter_seed, header.filter_bits)) {
+            return false;
+        }
+        return attach(header, std::move(region), reinterpret_cast<const base_type*>(region.data()), std::move(values),
+                      std::move(filter), std::move(checksums), mode);
+    }
+
+    /*
+     *  \brief  Maps the file of the dictionary read-only.
+     *  \param  populate - prefault the whole mapping (MAP_POPULATE).
+     *  \param  mode - verification of checksums of the mapped sections: the
+     *          sampled verification touches a few chunks of sections, so the
+     *          file is not read entirely, and the full one may be run later
+     *          by verify().
+     */
+    bool map(const std::string& path, const page_policy policy = page_policy::regular, const bool populate = false,
+             const verification mode = verification::sampled)
+    {
+        clear();
+
+        details::mem_region region;
+        details::file_header header;
+        if (! region.map(path, policy, populate) || (region.size() < sizeof(header))) {
+            return false;
+        }
+        std::memcpy(&header, region.data(), sizeof(header));
+        if (! is_valid_header(header, region.size())) {
+            return false;
+        }
+
+        const char* p_data = reinterpret_cast<const char*>(region.data());
+        details::packed_values<value_type> values;
+        if ((header.values_words != 0)
+            && ! values.attach(reinterpret_cast<const uint64_t*>(p_data + header.values_offset), header.values_words)) {
+            return false;
+        }
+        details::xor_filter filter;
+        if ((header.filter_bytes != 0)
+            && ! filter.attach(reinterpret_cast<const uint8_t*>(p_data + header.filter_offset), header.filter_bytes,
+                               header.filter_block_size, header.filter_seed, header.filter_bits)) {
+            return false;
+        }
+
+        const uint32_t* p_checksums = reinterpret_cast<const uint32_t*>(p_data + header.checksums_offset);
+        std::vector<uint32_t> checksums(p_checksums, p_checksums + header.checksums_count);
+        const base_type* p_units = reinterpret_cast<const base_type*>(p_data + header.units_offset);
+        return attach(header, std::move(region), p_units, std::move(values), std::move(filter), std::move(checksums), mode);
+    }
+
+    bool save(const std::string& path) const
+    {
+        details::file_header header = {};
+        header.magic = details::file_header::magic_value;
+        header.version = details::file_header::version_value;
+        header.traits = details::file_header::make_traits<TChar, TBase, TValue>();
+        header.units_count = m_size;
+        header.hot_size = m_hot_size;
+        header.dead_state = m_dead_state;
+        header.values_words = m_values.words_count();
+        header.normalization = (uint64_t)m_normalization;
+        header.states_count = m_states_count;
+        header.transitions_count = m_transitions_count;
+        header.chunk_size = details::file_header::default_chunk_size;
+        header.units_offset = sizeof(header);
+        header.values_offset = details::file_header::align(header.units_offset + m_size * sizeof(base_type));
+        header.filter_offset = details::file_header::align(header.values_offset + header.values_words * sizeof(uint64_t));
+        header.filter_bytes = m_filter.size_bytes();
+        header.filter_block_size = m_filter.block_size();
+        header.filter_seed = m_filter.seed();
+        header.filter_bits = m_filter.bits();
+        header.checksums_offset = details::file_header::align(header.filter_offset + header.filter_bytes);
+
+        std::vector<uint32_t> checksums;
+        details::make_checksums(m_p_units, m_size * sizeof(base_type), header.chunk_size, checksums);
+        details::make_checksums(m_values.data(), header.values_words * sizeof(uint64_t), header.chunk_size, checksums);
+        details::make_checksums(m_filter.data(), header.filter_bytes, header.chunk_size, checksums);
+        header.checksums_count = checksums.size();
+        header.checksums_crc = details::crc32c(checksums.data(), checksums.size() * sizeof(uint32_t));
+        header.header_crc = details::header_crc(header);
+
+        const uint64_t padding = 0;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(m_p_units), m_size * sizeof(base_type));
+        out.write(reinterpret_cast<const char*>(&padding), header.values_offset - header.units_offset - m_size * sizeof(base_type));
+        out.write(reinterpret_cast<const char*>(m_values.data()), header.values_words * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(&padding),
+                  header.filter_offset - header.values_offset - header.values_words * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(m_filter.data()), header.filter_bytes);
+        out.write(reinterpret_cast<const char*>(&padding), header.checksums_offset - header.filter_offset - header.filter_bytes);
+        out.write(reinterpret_cast<const char*>(checksums.data()), checksums.size() * sizeof(uint32_t));
+        return out.good();
+    }
+
+    /*
+     *  \brief  Returns the count of states of the DAWG of the dictionary.
+     */
+    size_type states_count() const { return m_states_count; }
+
+    /*
+     *  \brief  Returns the count of transitions of the DAWG of the dictionary.
+     */
+    size_type transitions_count() const { return m_transitions_count; }
+
+    /*
+     *  \brief  Checks the sections of the loaded or mapped dictionary by the
+     *          checksums of the file, e.g. in background after the sampled
+     *          verification at mapping.
+     *  \return false if some chunk is corrupted. The built dictionary has no
+     *          checksums and is always valid.
+     */
+    bool verify(const verification mode = verification::full) const
+    {
+        if (m_checksums.empty() || (mode == verification::none)) {
+            return true;
+        }
+
+        const uint64_t units_bytes = m_size * sizeof(base_type);
+        const uint64_t values_bytes = m_values.words_count() * sizeof(uint64_t);
+        const uint64_t units_chunks = details::file_header::chunks_count(units_bytes, m_chunk_size);
+        const uint64_t values_chunks = details::file_header::chunks_count(values_bytes, m_chunk_size);
+        return details::verify_checksums(m_p_units, units_bytes, m_chunk_size, m_checksums.data(), mode)
+            && details::verify_checksums(m_values.data(), values_bytes, m_chunk_size, m_checksums.data() + units_chunks, mode)
+            && details::verify_checksums(m_filter.data(), m_filter.size_bytes(), m_chunk_size,
+                                         m_checksums.data() + units_chunks + values_chunks, mode);
+    }
+
+    /*
+     *  \brief  Reports keys which are prefixes of the key, shortest first.
+     *  \param  callback - callable as callback(length, value).
+     */
+    template<typename TCallback>
+    void common_prefix_search(const std::basic_string_view<char_type>& key, TCallback&& callback) const
+    {
+        base_type idx = root();
+        for (size_type i = 0; (i < key.length()) && ! empty(); ++i) {
+            if (! follow(key[i], idx)) {
+                return;
+            }
+            if (has_value(idx)) {
+                callback(i + 1, value(idx));
+            }
+        }
+    }
+
+    value_type find(const std::basic_string_view<char_type>& key) const
+    {
+        details::lookup_probe probe;
+        if (empty()) {
+            probe.early_miss(0);
+            return -1;
+        }
+
+        if (! may_contain(key)) {
+            probe.early_miss(0);
+            return -1;
+        }
+
+        base_type idx = root();
+        size_type first = 0;
+        if (! follow_dispatch(key, idx, first)) {
+            probe.early_miss(first);
+            return -1;
+        }
+        if (m_dead_state != 0) {
+            // Missed transitions lead to the dead state, which has no value,
+            // so the key is checked once after the walk.
+            for (size_type i = first; i < key.length(); ++i) {
+                idx = follow_branch_free(key[i], idx);
+            }
+            if (! has_value(idx)) {
+                probe.leaf_miss(key.length());
+                return -1;
+            }
+            probe.hit(key.length());
+            return value(idx);
+        }
+        for (size_type i = first; i < key.length(); ++i) {
+            if (! follow(key[i], idx)) {
+                probe.early_miss(i);
+                return -1;
+            }
+        }
+        if (! has_value(idx)) {
+            probe.leaf_miss(key.length());
+            return -1;
+        }
+        probe.hit(key.length());
+        return value(idx);
+    }
+
+    /*
+     *  \brief  Finds the key like find(), but loads 8 bytes of the key at
+     *          once and takes labels of characters from the loaded word.
+     *          Dictionaries of several labels per character are searched
+     *          by find().
+     */
+    value_type find_by_words(const std::basic_string_view<char_type>& key) const
+    {
+        if constexpr (codec::max_labels != 1) {
+            return find(key);
+        } else {
+            details::lookup_probe probe;
+            if (empty() || ! may_contain(key)) {
+                probe.early_miss(0);
+                return -1;
+            }
 
-    value_type find(const std::basic_string_view<char_type>& /*key*/) const { return -1; }
+            base_type idx = root();
+            size_type i = 0;
+            if (! follow_dispatch(key, idx, i)) {
+                probe.early_miss(i);
+                return -1;
+            }
+            for (; i + word_chars <= key.length(); i += word_chars) {
+                uint64_t word;
+                std::memcpy(&word, key.data() + i, sizeof(word));
+                for (size_type j = 0; j < word_chars; ++j) {
+                    if (! follow_label(word_label(word, j), idx)) {
+                        probe.early_miss(i + j);
+                        return -1;
+                    }
+                }
+            }
+            for (; i < key.length(); ++i) {
+                if (! follow(key[i], idx)) {
+                    probe.early_miss(i);
+                    return -1;
+                }
+            }
+            if (! has_value(idx)) {
+                probe.leaf_miss(key.length());
+                return -1;
+            }
+            probe.hit(key.length());
+            return value(idx);
+        }
+    }
 
     bool follow(const std::basic_string_view<char_type>& key, base_type& idx) const
     {
         for (size_type i = 0; i < key.length(); ++i) {
             if (! follow(key[i], idx)) {
+                details::lookup_probe::follow(i);
                 return false;
             }
         }
+        details::lookup_probe::follow(key.length());
         return true;
     }
 
-    bool follow(const char_type /*label*/, base_type& /*idx*/) const { return false; }
+    bool follow(char_type ch, base_type& idx) const
+    {
+        if (m_p_fold != nullptr) {
+            ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+        }
+
+        if constexpr (codec::max_labels == 1) {
+            return follow_label(static_cast<label_type>(static_cast<uchar_type>(ch)), idx);
+        } else {
+            label_type labels[codec::max_labels];
+            const size_type count = codec::encode(ch, labels);
+            base_type next_idx = idx;
+            for (size_type i = 0; i < count; ++i) {
+                if (! follow_label(labels[i], next_idx)) {
+                    return false;
+                }
+            }
+            idx = next_idx;
+            return true;
+        }
+    }
+
+    /*
+     *  \brief  Follows the first characters of the key from the root by the
+     *          dispatch table.
+     *  \param  count - count of followed characters: the depth of the table
+     *          or 0, if there is no table or the key does not fit it.
+     *  \return false if the key has left the dictionary.
+     */
+    bool follow_dispatch(const std::basic_string_view<char_type>& key, base_type& idx, size_type& count) const
+    {
+        count = 0;
+        if ((m_dispatch_depth == 0) || (key.length() < m_dispatch_depth)) {
+            return true;
+        }
+
+        size_type index = 0;
+        for (size_type i = 0; i < m_dispatch_depth; ++i) {
+            uchar_type ch = static_cast<uchar_type>(key[i]);
+            if (m_p_fold != nullptr) {
+                ch = m_p_fold[ch];
+            }
+            if (ch >= dispatch_alphabet) {
+                return true;
+            }
+            index = index * dispatch_alphabet + ch;
+        }
+        count = m_dispatch_depth;
+        idx = m_dispatch[index];
+        return idx != root();
+    }
+
+    /*
+     *  \brief  Checks the key by the filter of keys built by the builder and
+     *          saved with the dictionary.
+     *  \return false if the key is not in the dictionary for sure, true if
+     *          it may be there or the dictionary has no filter.
+     */
+    bool may_contain(const std::basic_string_view<char_type>& key) const
+    {
+        if (m_filter.empty()) {
+            return true;
+        }
+
+        // Keys are hashed by labels of normalized characters, like keys of
+        // the DAWG are hashed by the builder.
+        details::key_hasher hasher;
+        label_type labels[codec::max_labels];
+        for (const char_type ch : key) {
+            const uchar_type c = static_cast<uchar_type>(ch);
+            const char_type folded = (m_p_fold != nullptr) ? static_cast<char_type>(m_p_fold[c]) : ch;
+            const size_type count = codec::encode(folded, labels);
+            for (size_type i = 0; i < count; ++i) {
+                hasher.add(labels[i]);
+            }
+        }
+        return m_filter.contains(hasher.value());
+    }
+
+    bool follow_label(const label_type label, base_type& idx) const
+    {
+        const base_type next_idx = idx ^ unit::offset(m_p_units[idx]) ^ label;
+        if (unit::label(m_p_units[next_idx]) != label) {
+            return false;
+        }
+        idx = next_idx;
+        return true;
+    }
 
-    bool has_value(const base_type& /*idx*/) const { return false; }
+    bool has_value(const base_type& idx) const { return unit::has_leaf(m_p_units[idx]); }
 
     base_type root() const { return 0; }
+
+    size_type size() const { return m_size; }
+
+    /*
+     *  \brief  Returns words of the bit-packed array of values, nullptr if
+     *          values are stored in units.
+     */
+    const uint64_t* values_data() const { return m_values.data(); }
+
+    /*
+     *  \brief  Returns the size of the bit-packed array of values in bytes.
+     */
+    size_type values_size() const { return m_values.words_count() * sizeof(uint64_t); }
+
+    value_type value(const base_type& idx) const
+    {
+        const value_type value = unit::value(m_p_units[idx ^ unit::offset(m_p_units[idx])]);
+        return m_values.empty() ? value : m_values[value];
+    }
+
+private:
+    /// Characters coded by one label.
+    static constexpr size_type dispatch_alphabet = (codec::max_labels == 1) ? (size_type(1) << unit::label_bits) : 0x80;
+    static constexpr size_type max_dispatch_entries = size_type(1) << 16;
+    /// Characters of the key loaded at once by find_by_words().
+    static constexpr size_type word_chars = sizeof(uint64_t) / sizeof(char_type);
+
+    void assign(std::vector<base_type>&& units, const size_type hot_size,
+                details::packed_values<value_type>&& values = details::packed_values<value_type>(),
+                const normalization norm = normalization::none)
+    {
+        clear();
+        m_units = std::move(units);
+        m_p_units = m_units.data();
+        m_size = m_units.size();
+        m_hot_size = hot_size;
+        m_values = std::move(values);
+        set_normalization(norm);
+    }
+
+    /*
+     *  \brief  Returns the label of the character of the loaded word.
+     */
+    label_type word_label(const uint64_t word, const size_type pos) const
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        const size_type shift = pos * sizeof(char_type) * 8;
+#else
+        const size_type shift = (word_chars - 1 - pos) * sizeof(char_type) * 8;
+#endif
+        const uchar_type ch = static_cast<uchar_type>(word >> shift);
+        return static_cast<label_type>((m_p_fold != nullptr) ? m_p_fold[ch] : ch);
+    }
+
+    /*
+     *  \brief  Follows the character like follow(), but the missed
+     *          transition leads to the dead state instead of the branch.
+     */
+    base_type follow_branch_free(char_type ch, base_type idx) const
+    {
+        if (m_p_fold != nullptr) {
+            ch = static_cast<char_type>(m_p_fold[static_cast<uchar_type>(ch)]);
+        }
+
+        if constexpr (codec::max_labels == 1) {
+            return follow_label_branch_free(static_cast<label_type>(static_cast<uchar_type>(ch)), idx);
+        } else {
+            label_type labels[codec::max_labels];
+            const size_type count = codec::encode(ch, labels);
+            for (size_type i = 0; i < count; ++i) {
+                idx = follow_label_branch_free(labels[i], idx);
+            }
+            return idx;
+        }
+    }
+
+    base_type follow_label_branch_free(const label_type label, const base_type idx) const
+    {
+        const base_type next_idx = idx ^ unit::offset(m_p_units[idx]) ^ label;
+        // All bits are set, if the label of the unit is another one.
+        const base_type miss = base_type(0) - base_type(unit::label(m_p_units[next_idx]) != label);
+        return (next_idx & ~miss) | (m_dead_state & miss);
+    }
+
+    void set_dead_state(const base_type dead_state) { m_dead_state = dead_state; }
+
+    void set_normalization(const normalization norm)
+    {
+        m_normalization = norm;
+        m_p_fold = details::fold_table<uchar_type>(norm);
+    }
+
+    bool attach(const details::file_header& header, details::mem_region&& region, const base_type* p_units,
+                details::packed_values<value_type>&& values, details::xor_filter&& filter, std::vector<uint32_t>&& checksums,
+                const verification mode)
+    {
+        m_region = std::move(region);
+        m_p_units = p_units;
+        m_size = header.units_count;
+        m_hot_size = header.hot_size;
+        m_dead_state = header.dead_state;
+        m_values = std::move(values);
+        m_filter = std::move(filter);
+        set_normalization(static_cast<normalization>(header.normalization));
+        m_states_count = header.states_count;
+        m_transitions_count = header.transitions_count;
+        m_checksums = std::move(checksums);
+        m_chunk_size = header.chunk_size;
+
+        const uint32_t crc = details::crc32c(m_checksums.data(), m_checksums.size() * sizeof(uint32_t));
+        if ((crc != header.checksums_crc) || ! verify(mode)) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    void set_dawg_counts(const size_type states_count, const size_type transitions_count)
+    {
+        m_states_count = states_count;
+        m_transitions_count = transitions_count;
+    }
+
+    /*
+     *  \brief  Checks the header against the traits of the dictionary and
+     *          the layout of sections against the size of the file.
+     */
+    static bool is_valid_header(const details::file_header& h, const uint64_t file_size)
+    {
+        using details::file_header;
+
+        if ((h.magic != file_header::magic_value) || (h.version != file_header::version_value)
+            || (h.traits != file_header::make_traits<TChar, TBase, TValue>()) || (h.header_crc != details::header_crc(h))) {
+            return false;
+        }
+        if ((h.units_count == 0) || (h.hot_size > h.units_count) || ((h.values_words != 0) && (h.values_words < 3))
+            || (h.normalization > (uint64_t)normalization::case_fold) || (h.chunk_size == 0) || ((h.chunk_size % 8) != 0)) {
+            return false;
+        }
+
+        const uint64_t block_size = uint64_t(1) << unit::label_bits;
+        if ((h.dead_state != 0)
+            && (((h.dead_state % block_size) != 0) || (h.dead_state + block_size != h.units_count))) {
+            return false;
+        }
+
+        if ((h.filter_bytes != 0) ? ! details::xor_filter::is_valid(h.filter_bytes, h.filter_block_size, h.filter_bits)
+                                  : ((h.filter_block_size != 0) || (h.filter_seed != 0) || (h.filter_bits != 0))) {
+            return false;
+        }
+
+        const uint64_t units_bytes = h.units_count * sizeof(base_type);
+        const uint64_t values_bytes = h.values_words * sizeof(uint64_t);
+        return (h.units_offset == sizeof(file_header))
+            && (h.values_offset == file_header::align(h.units_offset + units_bytes))
+            && (h.filter_offset == file_header::align(h.values_offset + values_bytes))
+            && (h.checksums_offset == file_header::align(h.filter_offset + h.filter_bytes))
+            && (h.checksums_count == file_header::chunks_count(units_bytes, h.chunk_size)
+                                     + file_header::chunks_count(values_bytes, h.chunk_size)
+                                     + file_header::chunks_count(h.filter_bytes, h.chunk_size))
+            && (file_size >= h.checksums_offset + h.checksums_count * sizeof(uint32_t));
+    }
+
+private:
+    std::vector<base_type> m_units;
+    details::mem_region m_region;
+
+    const base_type* m_p_units = nullptr;
+    size_type m_size = 0;
+    size_type m_hot_size = 0;
+    base_type m_dead_state = 0;
+
+    details::packed_values<value_type> m_values;
+
+    normalization m_normalization = normalization::none;
+    const uchar_type* m_p_fold = nullptr;
+
+    size_type m_states_count = 0;
+    size_type m_transitions_count = 0;
+
+    std::vector<uint32_t> m_checksums;
+    uint64_t m_chunk_size = 0;
+
+    std::vector<base_type> m_dispatch;
+    size_type m_dispatch_depth = 0;
+
+    details::xor_filter m_filter;
 };
 
 } // namespace wd
 } // namespace wstux
 
 #endif /* _WORDDICT_WORDDICT_WORDDICT_H_ */
-
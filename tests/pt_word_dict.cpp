@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <testing/perfdefs.h>
+
+#include "worddict/builder.h"
+#include "worddict/lookup_executor.h"
+#include "worddict/query_engine.h"
+
+namespace {
+
+using char_type = char;
+using string_type = std::basic_string<char_type>;
+using builder_type = wstux::wd::builder<char_type>;
+using dict_type = wstux::wd::word_dict<char_type>;
+
+constexpr size_t words_count = 200000;
+constexpr size_t queries_count = 1000000;
+constexpr size_t profile_count = 100000;
+
+class wd_perf_fixture : public ::testing::Test
+{
+public:
+    virtual void SetUp() override
+    {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<size_t> len_dist(3, 12);
+        std::uniform_int_distribution<int> char_dist('a', 'z');
+
+        std::set<string_type> words;
+        while (words.size() < words_count) {
+            string_type w(len_dist(gen), 'a');
+            for (char_type& c : w) {
+                c = char_dist(gen);
+            }
+            words.emplace(std::move(w));
+        }
+        m_words.assign(words.cbegin(), words.cend());
+
+        // Zipf-like distribution of queries over randomly ranked words.
+        std::vector<size_t> ranks(m_words.size());
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            ranks[i] = i;
+        }
+        std::shuffle(ranks.begin(), ranks.end(), gen);
+
+        std::vector<double> weights(m_words.size());
+        for (size_t i = 0; i < weights.size(); ++i) {
+            weights[i] = 1.0 / (i + 1);
+        }
+        std::discrete_distribution<size_t> rank_dist(weights.cbegin(), weights.cend());
+
+        m_queries.reserve(queries_count);
+        for (size_t i = 0; i < queries_count; ++i) {
+            m_queries.emplace_back(ranks[rank_dist(gen)]);
+        }
+    }
+
+protected:
+    bool build(dict_type& dict, const builder_type::profile_type* p_profile) const
+    {
+        builder_type builder;
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            if (! builder.insert(m_words[i], i)) {
+                return false;
+            }
+        }
+        return (p_profile == nullptr) ? builder.build(dict) : builder.build(dict, *p_profile);
+    }
+
+    size_t lookup(const dict_type& dict) const
+    {
+        size_t found = 0;
+        for (const size_t q : m_queries) {
+            found += (dict.find(m_words[q]) == (dict_type::value_type)q) ? 1 : 0;
+        }
+        return found;
+    }
+
+protected:
+    std::vector<string_type> m_words;
+    std::vector<size_t> m_queries;
+};
+
+} // <anonumous> namespace
+
+PERF_TEST_F(wd_perf_fixture, find_profile_layout)
+{
+    PERF_INIT_TIMER(dfs_layout);
+    PERF_INIT_TIMER(profile_layout);
+
+    builder_type::profile_type profile;
+    for (size_t i = 0; i < profile_count; ++i) {
+        ++profile[m_words[m_queries[i]]];
+    }
+
+    dict_type dfs_dict;
+    dict_type profile_dict;
+    PERF_ASSERT_TRUE(build(dfs_dict, nullptr));
+    PERF_ASSERT_TRUE(build(profile_dict, &profile));
+
+    size_t dfs_found = 0;
+    size_t profile_found = 0;
+    PERF_CHECK_TIME(dfs_layout, dfs_found = lookup(dfs_dict));
+    PERF_CHECK_TIME(profile_layout, profile_found = lookup(profile_dict));
+
+    PERF_ASSERT_TRUE(dfs_found == queries_count);
+    PERF_ASSERT_TRUE(profile_found == queries_count);
+
+    PERF_MESSAGE() << "units: dfs = " << dfs_dict.size() << ", profile = " << profile_dict.size();
+    PERF_MESSAGE() << "find: dfs = " << PERF_TIMER_MSECS(dfs_layout) << " ms, profile = "
+                   << PERF_TIMER_MSECS(profile_layout) << " ms";
+}
+
+PERF_TEST_F(wd_perf_fixture, find_short_keys)
+{
+    PERF_INIT_TIMER(short_keys);
+    PERF_INIT_TIMER(long_keys);
+    PERF_INIT_TIMER(short_keys_by_words);
+    PERF_INIT_TIMER(long_keys_by_words);
+
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    // Queries of the short-token workload (up to 8 characters) and of longer
+    // keys, so the cost of the character of short keys is tracked.
+    std::vector<size_t> short_queries;
+    std::vector<size_t> long_queries;
+    size_t short_chars = 0;
+    size_t long_chars = 0;
+    for (const size_t q : m_queries) {
+        if (m_words[q].size() <= 8) {
+            short_queries.push_back(q);
+            short_chars += m_words[q].size();
+        } else {
+            long_queries.push_back(q);
+            long_chars += m_words[q].size();
+        }
+    }
+
+    const auto lookup_queries = [this, &dict](const std::vector<size_t>& queries) {
+        size_t found = 0;
+        for (const size_t q : queries) {
+            found += (dict.find(m_words[q]) == (dict_type::value_type)q) ? 1 : 0;
+        }
+        return found;
+    };
+    const auto lookup_queries_by_words = [this, &dict](const std::vector<size_t>& queries) {
+        size_t found = 0;
+        for (const size_t q : queries) {
+            found += (dict.find_by_words(m_words[q]) == (dict_type::value_type)q) ? 1 : 0;
+        }
+        return found;
+    };
+
+    size_t short_found = 0;
+    size_t long_found = 0;
+    PERF_CHECK_TIME(short_keys, short_found = lookup_queries(short_queries));
+    PERF_CHECK_TIME(long_keys, long_found = lookup_queries(long_queries));
+    PERF_ASSERT_TRUE(short_found == short_queries.size());
+    PERF_ASSERT_TRUE(long_found == long_queries.size());
+
+    PERF_CHECK_TIME(short_keys_by_words, short_found = lookup_queries_by_words(short_queries));
+    PERF_CHECK_TIME(long_keys_by_words, long_found = lookup_queries_by_words(long_queries));
+    PERF_ASSERT_TRUE(short_found == short_queries.size());
+    PERF_ASSERT_TRUE(long_found == long_queries.size());
+
+    PERF_MESSAGE() << "find: short keys = " << PERF_TIMER_MSECS(short_keys) << " ms (" << short_queries.size()
+                   << " keys, " << short_chars << " chars), long keys = " << PERF_TIMER_MSECS(long_keys) << " ms ("
+                   << long_queries.size() << " keys, " << long_chars << " chars)";
+    PERF_MESSAGE() << "find by words: short keys = " << PERF_TIMER_MSECS(short_keys_by_words)
+                   << " ms, long keys = " << PERF_TIMER_MSECS(long_keys_by_words) << " ms";
+}
+
+PERF_TEST_F(wd_perf_fixture, find_misses)
+{
+    PERF_INIT_TIMER(hits);
+    PERF_INIT_TIMER(misses);
+    PERF_INIT_TIMER(branch_free_hits);
+    PERF_INIT_TIMER(branch_free_misses);
+
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    builder_type builder;
+    builder.set_branch_free(true);
+    for (size_t i = 0; i < m_words.size(); ++i) {
+        PERF_ASSERT_TRUE(builder.insert(m_words[i], i));
+    }
+    dict_type branch_free_dict;
+    PERF_ASSERT_TRUE(builder.build(branch_free_dict));
+
+    // Misses leave the dictionary at a random character, so the exit of the
+    // walk is not predictable.
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<size_t> word_dist(0, m_words.size() - 1);
+    std::vector<string_type> hit_keys(queries_count / 2);
+    std::vector<string_type> miss_keys(queries_count / 2);
+    for (size_t i = 0; i < hit_keys.size(); ++i) {
+        hit_keys[i] = m_words[word_dist(gen)];
+        miss_keys[i] = m_words[word_dist(gen)];
+        miss_keys[i][gen() % miss_keys[i].size()] = '0';
+    }
+
+    const auto lookup_keys = [](const dict_type& d, const std::vector<string_type>& keys) {
+        size_t found = 0;
+        for (const string_type& key : keys) {
+            found += (d.find(key) != -1) ? 1 : 0;
+        }
+        return found;
+    };
+
+    size_t hits_found = 0;
+    size_t misses_found = 0;
+    PERF_CHECK_TIME(hits, hits_found = lookup_keys(dict, hit_keys));
+    PERF_CHECK_TIME(misses, misses_found = lookup_keys(dict, miss_keys));
+    PERF_ASSERT_TRUE(hits_found == hit_keys.size());
+    PERF_ASSERT_TRUE(misses_found == 0);
+
+    // Missed transitions lead to the dead state instead of the exit.
+    PERF_CHECK_TIME(branch_free_hits, hits_found = lookup_keys(branch_free_dict, hit_keys));
+    PERF_CHECK_TIME(branch_free_misses, misses_found = lookup_keys(branch_free_dict, miss_keys));
+    PERF_ASSERT_TRUE(hits_found == hit_keys.size());
+    PERF_ASSERT_TRUE(misses_found == 0);
+
+    PERF_MESSAGE() << "find: hits = " << PERF_TIMER_MSECS(hits) << " ms, misses = " << PERF_TIMER_MSECS(misses)
+                   << " ms";
+    PERF_MESSAGE() << "find: branch-free hits = " << PERF_TIMER_MSECS(branch_free_hits)
+                   << " ms, branch-free misses = " << PERF_TIMER_MSECS(branch_free_misses) << " ms";
+}
+
+PERF_TEST_F(wd_perf_fixture, find_interleaved)
+{
+    PERF_INIT_TIMER(sequential);
+    PERF_INIT_TIMER(interleaved);
+
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    // Uniform queries: lookups of the cold part of the dictionary wait for
+    // the memory.
+    std::mt19937 gen(41);
+    std::uniform_int_distribution<size_t> word_dist(0, m_words.size() - 1);
+    std::vector<size_t> queries(queries_count);
+    std::vector<std::basic_string_view<char_type>> keys;
+    keys.reserve(queries.size());
+    for (size_t& q : queries) {
+        q = word_dist(gen);
+        keys.emplace_back(m_words[q]);
+    }
+    std::vector<dict_type::value_type> values(keys.size());
+    wstux::wd::lookup_executor<char_type> executor(dict);
+
+    const auto sequential_lookup = [&]() {
+        size_t found = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            found += (dict.find(keys[i]) == (dict_type::value_type)queries[i]) ? 1 : 0;
+        }
+        return found;
+    };
+
+    size_t sequential_found = 0;
+    size_t interleaved_found = 0;
+    PERF_CHECK_TIME(sequential, sequential_found = sequential_lookup());
+    PERF_CHECK_TIME(interleaved, executor.find(keys.data(), keys.size(), values.data()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        interleaved_found += (values[i] == (dict_type::value_type)queries[i]) ? 1 : 0;
+    }
+
+    PERF_ASSERT_TRUE(sequential_found == queries_count);
+    PERF_ASSERT_TRUE(interleaved_found == queries_count);
+
+    PERF_MESSAGE() << "find: sequential = " << PERF_TIMER_MSECS(sequential) << " ms, interleaved = "
+                   << PERF_TIMER_MSECS(interleaved) << " ms";
+}
+
+PERF_TEST_F(wd_perf_fixture, find_dispatch)
+{
+    PERF_INIT_TIMER(root);
+    PERF_INIT_TIMER(dispatch);
+
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    std::mt19937 gen(43);
+    std::uniform_int_distribution<size_t> word_dist(0, m_words.size() - 1);
+    std::vector<size_t> queries(queries_count);
+    for (size_t& q : queries) {
+        q = word_dist(gen);
+    }
+
+    const auto lookup = [&]() {
+        size_t found = 0;
+        for (const size_t q : queries) {
+            found += (dict.find(m_words[q]) == (dict_type::value_type)q) ? 1 : 0;
+        }
+        return found;
+    };
+
+    size_t root_found = 0;
+    size_t dispatch_found = 0;
+    PERF_CHECK_TIME(root, root_found = lookup());
+    PERF_ASSERT_TRUE(dict.build_dispatch(2));
+    PERF_CHECK_TIME(dispatch, dispatch_found = lookup());
+
+    PERF_ASSERT_TRUE(root_found == queries_count);
+    PERF_ASSERT_TRUE(dispatch_found == queries_count);
+
+    PERF_MESSAGE() << "find: from root = " << PERF_TIMER_MSECS(root) << " ms, by dispatch table = "
+                   << PERF_TIMER_MSECS(dispatch) << " ms";
+}
+
+PERF_TEST_F(wd_perf_fixture, find_filtered_misses)
+{
+    PERF_INIT_TIMER(walk);
+    PERF_INIT_TIMER(filter);
+
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    builder_type builder;
+    builder.set_filter_rate(1.0 / 256);
+    for (size_t i = 0; i < m_words.size(); ++i) {
+        PERF_ASSERT_TRUE(builder.insert(m_words[i], i));
+    }
+    dict_type filtered_dict;
+    PERF_ASSERT_TRUE(builder.build(filtered_dict));
+
+    // 70% of queries are misses, which differ from words by the last
+    // character, so the walk fails at the end of the key.
+    std::mt19937 gen(44);
+    std::uniform_int_distribution<size_t> word_dist(0, m_words.size() - 1);
+    std::uniform_int_distribution<size_t> miss_dist(0, 9);
+    std::vector<string_type> keys(queries_count);
+    size_t misses_count = 0;
+    for (string_type& key : keys) {
+        key = m_words[word_dist(gen)];
+        if (miss_dist(gen) < 7) {
+            key.back() = '0';
+            ++misses_count;
+        }
+    }
+
+    const auto lookup_misses = [&keys](const dict_type& d) {
+        size_t misses = 0;
+        for (const string_type& key : keys) {
+            misses += (d.find(key) == -1) ? 1 : 0;
+        }
+        return misses;
+    };
+
+    size_t walk_misses = 0;
+    size_t filter_misses = 0;
+    PERF_CHECK_TIME(walk, walk_misses = lookup_misses(dict));
+    PERF_CHECK_TIME(filter, filter_misses = lookup_misses(filtered_dict));
+
+    PERF_ASSERT_TRUE(walk_misses == misses_count);
+    PERF_ASSERT_TRUE(filter_misses == misses_count);
+
+    PERF_MESSAGE() << "find: walk = " << PERF_TIMER_MSECS(walk) << " ms, filter = " << PERF_TIMER_MSECS(filter)
+                   << " ms, filter size = " << filtered_dict.filter_size() << " bytes";
+}
+
+PERF_TEST_F(wd_perf_fixture, query_engine_scaling)
+{
+    dict_type dict;
+    PERF_ASSERT_TRUE(build(dict, nullptr));
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> word_dist(0, m_words.size() - 1);
+    std::vector<size_t> queries(4 * queries_count);
+    std::vector<std::basic_string_view<char_type>> keys;
+    keys.reserve(queries.size());
+    for (size_t& q : queries) {
+        q = word_dist(gen);
+        keys.emplace_back(m_words[q]);
+    }
+    std::vector<dict_type::value_type> values(keys.size());
+
+    // Scaling curve: throughput by the count of threads up to the count of
+    // hardware threads.
+    const size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    double single_msecs = 0;
+    for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        wstux::wd::query_engine<char_type> engine(dict, threads);
+        const auto start = std::chrono::steady_clock::now();
+        engine.find(keys.data(), keys.size(), values.data());
+        const double msecs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        single_msecs = (threads == 1) ? msecs : single_msecs;
+
+        size_t found = 0;
+        for (size_t i = 0; i < values.size(); ++i) {
+            found += (values[i] == (dict_type::value_type)queries[i]) ? 1 : 0;
+        }
+        PERF_ASSERT_TRUE(found == queries.size());
+        PERF_MESSAGE() << "threads = " << threads << ": " << msecs << " ms, "
+                       << (keys.size() / msecs / 1000) << " M keys/s, speedup = " << (single_msecs / msecs);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    return RUN_ALL_PERF_TESTS();
+}
@@ -0,0 +1,120 @@
+/*
+ * worddict
+ * Copyright (C) 2023  Chistyakov Alexander
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Counters are collected only if the macro is defined before including
+// headers of the library.
+#define WORDDICT_LOOKUP_STATS
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <testing/testdefs.h>
+
+#include "worddict/builder.h"
+#include "worddict/lookup_stats.h"
+
+namespace {
+
+uint64_t latency_total(const wstux::wd::lookup_stats& stats)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < wstux::wd::lookup_stats::latency_buckets; ++i) {
+        total += stats.latency[i];
+    }
+    return total;
+}
+
+} // <anonumous> namespace
+
+TEST(lookup_stats, find)
+{
+    EXPECT_TRUE(wstux::wd::details::is_lookup_stats_enabled);
+
+    wstux::wd::builder<char> builder;
+    EXPECT_TRUE(builder.insert("bar", 1));
+    EXPECT_TRUE(builder.insert("bugaga", 2));
+    EXPECT_TRUE(builder.insert("foo", 3));
+    wstux::wd::word_dict<char> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    wstux::wd::reset_lookup_stats();
+    EXPECT_TRUE(dict.find("bugaga") == 2);
+    EXPECT_TRUE(dict.find("foo") == 3);
+    EXPECT_TRUE(dict.find("bug") == -1);
+    EXPECT_TRUE(dict.find("bux") == -1);
+    EXPECT_TRUE(dict.find("x") == -1);
+
+    wstux::wd::lookup_stats stats = wstux::wd::lookup_stats_snapshot();
+    EXPECT_TRUE(stats.lookups == 5) << stats.lookups;
+    EXPECT_TRUE(stats.hits == 2) << stats.hits;
+    EXPECT_TRUE(stats.early_misses == 2) << stats.early_misses;
+    EXPECT_TRUE(stats.leaf_misses == 1) << stats.leaf_misses;
+    EXPECT_TRUE(stats.transitions == 6 + 3 + 3 + 2 + 0) << stats.transitions;
+    EXPECT_TRUE(latency_total(stats) == 5) << latency_total(stats);
+    EXPECT_TRUE(stats.percentile(0.5) > 0);
+    EXPECT_TRUE(stats.percentile(0.5) <= stats.percentile(1.0));
+
+    wstux::wd::word_dict<char>::base_type idx = dict.root();
+    EXPECT_TRUE(dict.follow(std::string_view("ba"), idx));
+    stats = wstux::wd::lookup_stats_snapshot();
+    EXPECT_TRUE(stats.lookups == 5) << stats.lookups;
+    EXPECT_TRUE(stats.transitions == 16) << stats.transitions;
+
+    wstux::wd::reset_lookup_stats();
+    stats = wstux::wd::lookup_stats_snapshot();
+    EXPECT_TRUE((stats.lookups == 0) && (stats.transitions == 0) && (latency_total(stats) == 0));
+}
+
+TEST(lookup_stats, threads)
+{
+    wstux::wd::builder<char> builder;
+    EXPECT_TRUE(builder.insert("bar", 1));
+    EXPECT_TRUE(builder.insert("foo", 3));
+    wstux::wd::word_dict<char> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    constexpr size_t threads_count = 4;
+    constexpr size_t lookups_count = 10000;
+    wstux::wd::reset_lookup_stats();
+    EXPECT_TRUE(dict.find("foo") == 3);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_count; ++t) {
+        threads.emplace_back([&dict]() {
+            for (size_t i = 0; i < lookups_count; ++i) {
+                dict.find((i % 2 == 0) ? "bar" : "baz");
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    // Counters of finished threads are kept.
+    const wstux::wd::lookup_stats stats = wstux::wd::lookup_stats_snapshot();
+    EXPECT_TRUE(stats.lookups == threads_count * lookups_count + 1) << stats.lookups;
+    EXPECT_TRUE(stats.hits == threads_count * lookups_count / 2 + 1) << stats.hits;
+    EXPECT_TRUE(stats.early_misses == threads_count * lookups_count / 2) << stats.early_misses;
+    EXPECT_TRUE(latency_total(stats) == stats.lookups);
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <testing/testdefs.h>
+
+#include "worddict/builder.h"
+#include "worddict/scanner.h"
+
+#define __TO_UTF8_STRING(x) x
+#define __TO_WSTRING(x) L ## x
+#define __TO_UTF16_STRING(x) u ## x
+#define __TO_UTF32_STRING(x) U ## x
+
+#define U(TCHAR, x)                                                     \
+    []() -> std::basic_string<TCHAR> {                                  \
+        using const_ptr_t = const TCHAR*;                               \
+        if constexpr (std::is_same<TCHAR, wchar_t>::value) {            \
+            return reinterpret_cast<const_ptr_t>(__TO_WSTRING(x));      \
+        } else if constexpr (sizeof(TCHAR) == 1) {                      \
+            return reinterpret_cast<const_ptr_t>(__TO_UTF8_STRING(x));  \
+        } else if constexpr (sizeof(TCHAR) == 2) {                      \
+            return reinterpret_cast<const_ptr_t>(__TO_UTF16_STRING(x)); \
+        } else /* if constexpr (sizeof(TCHAR) == 4) */ {                \
+            return reinterpret_cast<const_ptr_t>(__TO_UTF32_STRING(x)); \
+        }                                                               \
+    }()
+
+namespace {
+
+template<typename TType>
+class scanner_fixture : public ::testing::Test {};
+
+using scanner_types = testing::Types<char, int8_t, uint8_t, //wchar_t,
+                                     //char16_t,
+                                     //int16_t,
+                                     uint16_t>;
+TYPED_TEST_SUITE(scanner_fixture, scanner_types);
+
+using match_type = std::tuple<size_t, size_t, int64_t>;
+
+template<typename TChar, typename TScanner>
+std::set<match_type> scan(const TScanner& scanner, const std::basic_string<TChar>& text)
+{
+    std::set<match_type> matches;
+    scanner.scan(text, [&matches](const size_t offset, const size_t length, const int64_t value) {
+        matches.emplace(offset, length, value);
+    });
+    return matches;
+}
+
+template<typename TChar>
+std::set<match_type> scan_naive(const std::map<std::basic_string<TChar>, int>& words, const std::basic_string<TChar>& text)
+{
+    std::set<match_type> matches;
+    for (size_t i = 0; i < text.size(); ++i) {
+        for (const std::pair<const std::basic_string<TChar>, int>& w : words) {
+            if (text.compare(i, w.first.size(), w.first) == 0) {
+                matches.emplace(i, w.first.size(), w.second);
+            }
+        }
+    }
+    return matches;
+}
+
+} // <anonumous> namespace
+
+TYPED_TEST(scanner_fixture, scan)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    std::map<string_type, int> words;
+    words.emplace(U(char_type, "he"), 1);
+    words.emplace(U(char_type, "hers"), 2);
+    words.emplace(U(char_type, "his"), 3);
+    words.emplace(U(char_type, "she"), 4);
+
+    wstux::wd::builder<char_type> builder;
+    EXPECT_TRUE(builder.insert(words));
+
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::scanner<char_type> scanner;
+    ASSERT_TRUE(builder.build(dict, scanner));
+    EXPECT_FALSE(scanner.empty());
+    EXPECT_TRUE(dict.find(U(char_type, "hers")) == 2) << dict.find(U(char_type, "hers"));
+
+    const string_type text = U(char_type, "ushers and his sheep, uhers");
+    const std::set<match_type> matches = scan(scanner, text);
+    EXPECT_TRUE(matches == scan_naive(words, text)) << matches.size();
+    EXPECT_TRUE(matches.count(match_type(1, 3, 4)) == 1);
+    EXPECT_TRUE(matches.count(match_type(2, 2, 1)) == 1);
+    EXPECT_TRUE(matches.count(match_type(2, 4, 2)) == 1);
+
+    EXPECT_TRUE(scan(scanner, U(char_type, "")).empty());
+    EXPECT_TRUE(scan(scanner, U(char_type, "xyzzy xyzzy xyzzy xyzzy")).empty());
+}
+
+TYPED_TEST(scanner_fixture, scan_random)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    // Few and many distinct first characters of keys; wide characters for
+    // 16-bit alphabets are coded by several labels.
+    const size_t alphabets[] = {3, 20};
+    for (const size_t alphabet : alphabets) {
+        std::mt19937 rng(alphabet);
+        const auto random_char = [&rng, alphabet]() -> char_type {
+            const size_t c = rng() % alphabet;
+            if constexpr (sizeof(char_type) == 2) {
+                return (c % 2 == 0) ? char_type('a' + c) : char_type(0x430 + c * 0x100);
+            } else {
+                return char_type('a' + c);
+            }
+        };
+
+        std::map<string_type, int> words;
+        while (words.size() < 200) {
+            string_type w;
+            for (size_t len = 1 + rng() % 5; len > 0; --len) {
+                w += random_char();
+            }
+            words.emplace(w, (int)words.size());
+        }
+
+        wstux::wd::builder<char_type> builder;
+        ASSERT_TRUE(builder.insert(words));
+        wstux::wd::word_dict<char_type> dict;
+        wstux::wd::scanner<char_type> scanner;
+        ASSERT_TRUE(builder.build(dict, scanner));
+
+        string_type text;
+        for (size_t i = 0; i < 2000; ++i) {
+            text += (rng() % 4 == 0) ? random_char() : char_type('z' - (rng() % 3));
+        }
+        const std::set<match_type> matches = scan(scanner, text);
+        EXPECT_FALSE(matches.empty());
+        EXPECT_TRUE(matches == scan_naive(words, text)) << matches.size() << " != " << scan_naive(words, text).size();
+    }
+}
+
+TYPED_TEST(scanner_fixture, scan_start_bytes)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    // Keys start with bytes of all high and low nibbles. Keys are inserted
+    // in the order of unsigned bytes.
+    std::map<string_type, int> words;
+    wstux::wd::builder<char_type> builder;
+    for (size_t b = 1; b < 256; b += 7) {
+        const string_type key = string_type(1, char_type(b)) + char_type('k');
+        words.emplace(key, (int)b);
+        ASSERT_TRUE(builder.insert(key, (int)b));
+    }
+
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::scanner<char_type> scanner;
+    ASSERT_TRUE(builder.build(dict, scanner));
+
+    std::mt19937 rng(42);
+    string_type text;
+    for (size_t i = 0; i < 4000; ++i) {
+        text += (rng() % 3 == 0) ? char_type('k') : char_type(1 + rng() % 255);
+    }
+    const std::set<match_type> matches = scan(scanner, text);
+    EXPECT_FALSE(matches.empty());
+    EXPECT_TRUE(matches == scan_naive(words, text)) << matches.size() << " != " << scan_naive(words, text).size();
+}
+
+TYPED_TEST(scanner_fixture, scan_normalized)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    std::map<string_type, int> words;
+    words.emplace(U(char_type, "he"), 1);
+    words.emplace(U(char_type, "hers"), 2);
+    words.emplace(U(char_type, "his"), 3);
+    words.emplace(U(char_type, "she"), 4);
+
+    wstux::wd::builder<char_type> builder(wstux::wd::value_coding::inline_units, wstux::wd::normalization::ascii_lower);
+    EXPECT_TRUE(builder.insert(U(char_type, "HE"), 1));
+    EXPECT_TRUE(builder.insert(U(char_type, "Hers"), 2));
+    EXPECT_TRUE(builder.insert(U(char_type, "his"), 3));
+    EXPECT_TRUE(builder.insert(U(char_type, "sHe"), 4));
+
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::scanner<char_type> scanner;
+    ASSERT_TRUE(builder.build(dict, scanner));
+
+    // The text is long enough to be skipped by SSSE3.
+    const string_type text = U(char_type, "USHERS and His sheep, uhers; xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx SHE");
+    string_type lower = text;
+    for (char_type& ch : lower) {
+        ch = ((ch >= 'A') && (ch <= 'Z')) ? char_type(ch - 'A' + 'a') : ch;
+    }
+    const std::set<match_type> matches = scan(scanner, text);
+    EXPECT_TRUE(matches == scan_naive(words, lower)) << matches.size() << " != " << scan_naive(words, lower).size();
+    EXPECT_TRUE(matches.count(match_type(1, 3, 4)) == 1);
+    EXPECT_TRUE(matches.count(match_type(62, 3, 4)) == 1);
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    return RUN_ALL_TESTS();
+}
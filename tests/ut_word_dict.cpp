@@ -1,6 +1,26 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+
 #include <testing/testdefs.h>
 
+#include "worddict/bidi_dict.h"
 #include "worddict/builder.h"
+#include "worddict/cold_dict.h"
+#include "worddict/dfa_matcher.h"
+#include "worddict/dict_warmer.h"
+#include "worddict/fst_dict.h"
+#include "worddict/lookup_executor.h"
+#include "worddict/numa_dict.h"
+#include "worddict/ordered_index.h"
+#include "worddict/pattern_matcher.h"
+#include "worddict/payload_dict.h"
+#include "worddict/query_engine.h"
+#include "worddict/static_dict.h"
+#include "worddict/union_dict.h"
 
 #define __TO_UTF8_STRING(x) x
 #define __TO_WSTRING(x) L ## x
@@ -32,6 +52,53 @@ using wd_types = testing::Types<char, int8_t, uint8_t, //wchar_t,
                                 uint16_t>;
 TYPED_TEST_SUITE(wd_fixture, wd_types);
 
+template<typename TChar>
+bool is_glob_matched(const TChar* p_pattern, const TChar* p_pattern_end, const TChar* p_key, const TChar* p_key_end)
+{
+    using uchar_type = typename std::make_unsigned<TChar>::type;
+
+    if (p_pattern == p_pattern_end) {
+        return p_key == p_key_end;
+    }
+    if (*p_pattern == '*') {
+        for (const TChar* p = p_key; ; ++p) {
+            if (is_glob_matched(p_pattern + 1, p_pattern_end, p, p_key_end)) {
+                return true;
+            }
+            if (p == p_key_end) {
+                return false;
+            }
+        }
+    }
+    if (p_key == p_key_end) {
+        return false;
+    }
+
+    const uchar_type ch = static_cast<uchar_type>(*p_key);
+    bool is_matched = false;
+    if (*p_pattern == '?') {
+        is_matched = true;
+    } else if (*p_pattern == '[') {
+        ++p_pattern;
+        const bool is_negated = (*p_pattern == '^');
+        p_pattern += is_negated ? 1 : 0;
+        for (; *p_pattern != ']'; ++p_pattern) {
+            const uchar_type first = static_cast<uchar_type>(*p_pattern);
+            uchar_type last = first;
+            if ((p_pattern[1] == '-') && (p_pattern[2] != ']')) {
+                last = static_cast<uchar_type>(p_pattern[2]);
+                p_pattern += 2;
+            }
+            is_matched |= (first <= ch) && (ch <= last);
+        }
+        is_matched ^= is_negated;
+    } else {
+        p_pattern += (*p_pattern == '\\') ? 1 : 0;
+        is_matched = (static_cast<uchar_type>(*p_pattern) == ch);
+    }
+    return is_matched && is_glob_matched(p_pattern + 1, p_pattern_end, p_key + 1, p_key_end);
+}
+
 } // <anonumous> namespace
 
 TYPED_TEST(wd_fixture, build)
@@ -118,6 +185,82 @@ TYPED_TEST(wd_fixture, find)
     EXPECT_TRUE(dict.find(s4) == 4) << dict.find(s4);
 }
 
+TYPED_TEST(wd_fixture, lookup_stats_disabled)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    const string_type s1 = U(char_type, "bugaga");
+
+    wstux::wd::builder<char_type> builder;
+    EXPECT_TRUE(builder.insert(s1, 1));
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    // Lookup statistics are not compiled in, so lookups are not counted.
+    EXPECT_FALSE(wstux::wd::details::is_lookup_stats_enabled);
+    EXPECT_TRUE(dict.find(s1) == 1) << dict.find(s1);
+    EXPECT_TRUE(dict.find(U(char_type, "bug")) == -1) << dict.find(U(char_type, "bug"));
+    EXPECT_TRUE(wstux::wd::lookup_stats_snapshot().lookups == 0);
+}
+
+TYPED_TEST(wd_fixture, find_profile_layout)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    const string_type s1 = U(char_type, "bugaga");
+    const string_type s2 = U(char_type, "bugagb");
+    const string_type s3 = U(char_type, "bugagc");
+    const string_type s4 = U(char_type, "bugora");
+
+    wstux::wd::builder<char_type> builder;
+    EXPECT_TRUE(builder.insert(s1, 1));
+    EXPECT_TRUE(builder.insert(s2, 2));
+    EXPECT_TRUE(builder.insert(s3, 3));
+    EXPECT_TRUE(builder.insert(s4, 4));
+
+    const typename wstux::wd::builder<char_type>::profile_type profile = {
+        {U(char_type, "bugora"), 100},
+        {U(char_type, "bugagc"), 10},
+        {U(char_type, "bug"), 5},
+    };
+
+    wstux::wd::word_dict<char_type> dict;
+    EXPECT_TRUE(builder.build(dict, profile));
+
+    EXPECT_TRUE(dict.find(s1) == 1) << dict.find(s1);
+    EXPECT_TRUE(dict.find(s2) == 2) << dict.find(s2);
+    EXPECT_TRUE(dict.find(s3) == 3) << dict.find(s3);
+    EXPECT_TRUE(dict.find(s4) == 4) << dict.find(s4);
+    EXPECT_TRUE(dict.find(U(char_type, "bug")) == -1) << dict.find(U(char_type, "bug"));
+    EXPECT_TRUE(dict.find(U(char_type, "bugor")) == -1) << dict.find(U(char_type, "bugor"));
+
+    // Keys of the profile are normalized like the keys of the dictionary.
+    const typename wstux::wd::builder<char_type>::profile_type mixed_profile = {
+        {U(char_type, "BugOra"), 100},
+        {U(char_type, "BUGAGC"), 10},
+        {U(char_type, "Bug"), 5},
+    };
+    wstux::wd::word_dict<char_type> lower_dicts[2];
+    for (size_t i = 0; i < 2; ++i) {
+        wstux::wd::builder<char_type> lower_builder(wstux::wd::value_coding::inline_units,
+                                                    wstux::wd::normalization::ascii_lower);
+        EXPECT_TRUE(lower_builder.insert(s1, 1));
+        EXPECT_TRUE(lower_builder.insert(s2, 2));
+        EXPECT_TRUE(lower_builder.insert(s3, 3));
+        EXPECT_TRUE(lower_builder.insert(s4, 4));
+        EXPECT_TRUE(lower_builder.build(lower_dicts[i], (i == 0) ? profile : mixed_profile));
+    }
+    EXPECT_TRUE(lower_dicts[1].hot_size() == lower_dicts[0].hot_size())
+        << lower_dicts[1].hot_size() << " != " << lower_dicts[0].hot_size();
+    EXPECT_TRUE(lower_dicts[1].size() == lower_dicts[0].size());
+    for (size_t u = 0; u < lower_dicts[0].size(); ++u) {
+        ASSERT_TRUE(lower_dicts[1].data()[u] == lower_dicts[0].data()[u]) << u;
+    }
+    EXPECT_TRUE(lower_dicts[1].find(U(char_type, "BUGORA")) == 4) << lower_dicts[1].find(U(char_type, "BUGORA"));
+}
+
 TYPED_TEST(wd_fixture, build_many_words)
 {
     using char_type = TypeParam;
@@ -142,7 +285,9 @@ TYPED_TEST(wd_fixture, build_many_words)
 
     str = U(char_type, "bugaga");
     for (size_t i = 0, j = 0; i < std::numeric_limits<uint16_t>::max(); ++i) {
-        ASSERT_TRUE((size_t)dict.find(str) == i) << i;
+        // The same key is inserted again on the next step and its value is overwritten.
+        const bool is_overwritten = (j < str.size()) && (str[j] == 'z') && (i + 1 < std::numeric_limits<uint16_t>::max());
+        ASSERT_TRUE((size_t)dict.find(str) == (is_overwritten ? i + 1 : i)) << i << ": " << dict.find(str);
         if (j == str.size()) {
             str += 'a';
         } else if (str[j] == 'z') {
@@ -153,6 +298,1868 @@ TYPED_TEST(wd_fixture, build_many_words)
     }
 }
 
+TYPED_TEST(wd_fixture, build_report)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    std::map<string_type, int> words;
+    std::srand(40);
+    for (int i = 0; i < 20000; ++i) {
+        string_type word;
+        for (int len = 2 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 8);
+        }
+        words.emplace(word, i % 100);
+    }
+
+    std::vector<wstux::wd::build_stage> stages;
+    size_t packed = 0;
+    bool is_monotonic = true;
+    wstux::wd::builder<char_type> builder;
+    builder.set_progress([&](const wstux::wd::build_stage stage, const size_t done, const size_t total) {
+        if (stages.empty() || (stages.back() != stage)) {
+            stages.push_back(stage);
+        }
+        if (stage == wstux::wd::build_stage::packing) {
+            is_monotonic = is_monotonic && (done >= packed) && (done <= total);
+            packed = done;
+        }
+    });
+    for (const std::pair<const string_type, int>& w : words) {
+        ASSERT_TRUE(builder.insert(w.first, w.second));
+    }
+    EXPECT_TRUE(builder.insert(words.rbegin()->first, 1));
+
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    const std::vector<wstux::wd::build_stage> expected = {
+        wstux::wd::build_stage::inserting, wstux::wd::build_stage::minimizing,
+        wstux::wd::build_stage::packing, wstux::wd::build_stage::done};
+    EXPECT_TRUE(stages == expected) << stages.size();
+    EXPECT_TRUE(is_monotonic);
+    EXPECT_TRUE(packed == dict.states_count()) << packed << " != " << dict.states_count();
+
+    const wstux::wd::build_report& report = builder.report();
+    EXPECT_TRUE(report.keys_count == words.size() + 1) << report.keys_count;
+    EXPECT_TRUE(report.keys_per_second() > 0);
+    EXPECT_TRUE(report.states_count == dict.states_count());
+    EXPECT_TRUE(report.transitions_count == dict.transitions_count());
+    EXPECT_TRUE(report.merged_states_count > 0);
+    EXPECT_TRUE(report.merging_states_count > 0);
+    EXPECT_TRUE(report.register_lookups == report.register_hits + report.states_count - 1)
+        << report.register_lookups << " != " << report.register_hits << " + " << report.states_count << " - 1";
+    EXPECT_TRUE((report.register_hit_rate() > 0) && (report.register_hit_rate() < 1)) << report.register_hit_rate();
+    EXPECT_TRUE(report.units_count == dict.size());
+    EXPECT_TRUE((report.packing_density() > 0.5) && (report.packing_density() <= 1)) << report.packing_density();
+    EXPECT_TRUE(report.peak_rss_bytes > 0);
+    EXPECT_TRUE((report.minimize_seconds >= 0) && (report.pack_seconds > 0) && (report.extras_seconds >= 0));
+
+    // The report of the next build covers only the keys inserted after the previous one.
+    EXPECT_TRUE(builder.insert(words.begin()->first, 1));
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(builder.report().keys_count == 1) << builder.report().keys_count;
+    EXPECT_TRUE(builder.report().states_count == dict.states_count());
+}
+
+TYPED_TEST(wd_fixture, save_load)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    const string_type s1 = U(char_type, "bugaga");
+    const string_type s2 = U(char_type, "bugagb");
+    const string_type s3 = U(char_type, "bugagc");
+    const string_type s4 = U(char_type, "bugora");
+
+    wstux::wd::builder<char_type> builder;
+    EXPECT_TRUE(builder.insert(s1, 1));
+    EXPECT_TRUE(builder.insert(s2, 2));
+    EXPECT_TRUE(builder.insert(s3, 3));
+    EXPECT_TRUE(builder.insert(s4, 4));
+
+    wstux::wd::word_dict<char_type> dict;
+    EXPECT_TRUE(builder.build(dict));
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(dict.save(path));
+
+    const wstux::wd::page_policy policies[] = {wstux::wd::page_policy::regular,
+                                               wstux::wd::page_policy::transparent_huge,
+                                               wstux::wd::page_policy::explicit_huge};
+    for (const wstux::wd::page_policy policy : policies) {
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE(loaded.load(path, policy));
+        EXPECT_TRUE(loaded.size() == dict.size()) << loaded.size() << " != " << dict.size();
+        EXPECT_TRUE(loaded.is_huge_paged() == (policy != wstux::wd::page_policy::regular));
+        EXPECT_TRUE(loaded.find(s1) == 1) << loaded.find(s1);
+        EXPECT_TRUE(loaded.find(s4) == 4) << loaded.find(s4);
+        EXPECT_TRUE(loaded.find(U(char_type, "bugor")) == -1) << loaded.find(U(char_type, "bugor"));
+
+        wstux::wd::word_dict<char_type> mapped;
+        ASSERT_TRUE(mapped.map(path, policy));
+        EXPECT_TRUE(mapped.size() == dict.size()) << mapped.size() << " != " << dict.size();
+        EXPECT_TRUE(mapped.find(s2) == 2) << mapped.find(s2);
+        EXPECT_TRUE(mapped.find(s3) == 3) << mapped.find(s3);
+        EXPECT_TRUE(mapped.find(U(char_type, "bugagd")) == -1) << mapped.find(U(char_type, "bugagd"));
+    }
+
+    wstux::wd::numa_dict<char_type> numa;
+    EXPECT_TRUE(numa.local().find(s1) == -1) << numa.local().find(s1);
+    ASSERT_TRUE(numa.load(path));
+    EXPECT_TRUE(numa.replicas_count() > 0);
+    EXPECT_TRUE(numa.local().find(s1) == 1) << numa.local().find(s1);
+    EXPECT_TRUE(numa.local().find(s4) == 4) << numa.local().find(s4);
+
+    std::remove(path.c_str());
+
+    wstux::wd::word_dict<char_type> missing;
+    EXPECT_FALSE(missing.load(path));
+    EXPECT_FALSE(missing.map(path));
+    EXPECT_TRUE(missing.find(s1) == -1) << missing.find(s1);
+    EXPECT_FALSE(numa.load(path));
+    EXPECT_TRUE(numa.replicas_count() == 0);
+    EXPECT_TRUE(numa.local().find(s1) == -1) << numa.local().find(s1);
+}
+
+TYPED_TEST(wd_fixture, file_format)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    const char check[] = "123456789";
+    EXPECT_TRUE(wstux::wd::details::crc32c(check, 9) == 0xE3069283) << wstux::wd::details::crc32c(check, 9);
+    EXPECT_TRUE(~wstux::wd::details::crc32c_sw(~0u, reinterpret_cast<const unsigned char*>(check), 9) == 0xE3069283);
+
+    wstux::wd::builder<char_type> builder(wstux::wd::value_coding::packed);
+    string_type str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(builder.insert(str, i * 3));
+        str += 'a' + (i % 26);
+    }
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(dict.states_count() > 0);
+    EXPECT_TRUE(dict.transitions_count() >= dict.states_count()) << dict.transitions_count();
+    EXPECT_TRUE(dict.verify());
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_format_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(dict.save(path));
+    {
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE(loaded.load(path));
+        EXPECT_TRUE(loaded.states_count() == dict.states_count());
+        EXPECT_TRUE(loaded.transitions_count() == dict.transitions_count());
+        EXPECT_TRUE(loaded.verify());
+        EXPECT_TRUE(loaded.find(U(char_type, "bugagaa")) == 3) << loaded.find(U(char_type, "bugagaa"));
+
+        // The file of other traits.
+        wstux::wd::word_dict<char_type, uint64_t> wide;
+        EXPECT_FALSE(wide.load(path));
+        EXPECT_FALSE(wide.map(path));
+    }
+
+    std::vector<char> image;
+    {
+        std::ifstream in(path, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const auto write_image = [&path](const std::vector<char>& bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    };
+
+    // Corrupted unit: detected by the checksum of the chunk, unless the
+    // verification is disabled.
+    std::vector<char> corrupted = image;
+    corrupted[sizeof(wstux::wd::details::file_header) + 5] ^= 0x10;
+    write_image(corrupted);
+    {
+        wstux::wd::word_dict<char_type> loaded;
+        EXPECT_FALSE(loaded.load(path));
+        EXPECT_TRUE(loaded.empty());
+        EXPECT_FALSE(loaded.map(path));
+        EXPECT_TRUE(loaded.map(path, wstux::wd::page_policy::regular, false, wstux::wd::verification::none));
+        EXPECT_FALSE(loaded.verify());
+    }
+
+    // Corrupted header and truncated file.
+    corrupted = image;
+    corrupted[3 * sizeof(uint64_t)] ^= 0x01;
+    write_image(corrupted);
+    {
+        wstux::wd::word_dict<char_type> loaded;
+        EXPECT_FALSE(loaded.load(path, wstux::wd::page_policy::regular, wstux::wd::verification::none));
+        EXPECT_FALSE(loaded.map(path, wstux::wd::page_policy::regular, false, wstux::wd::verification::none));
+    }
+    corrupted.assign(image.cbegin(), image.cend() - 1);
+    write_image(corrupted);
+    {
+        wstux::wd::word_dict<char_type> loaded;
+        EXPECT_FALSE(loaded.load(path, wstux::wd::page_policy::regular, wstux::wd::verification::none));
+        EXPECT_FALSE(loaded.map(path, wstux::wd::page_policy::regular, false, wstux::wd::verification::none));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(lz_codec, round_trip)
+{
+    std::srand(38);
+    std::vector<std::vector<uint8_t>> inputs(4);
+    for (size_t i = 0; i < 100000; ++i) {
+        inputs[1].push_back(std::rand() & 0xFF);
+        inputs[2].push_back((i % 1000 < 900) ? (i % 7) : (std::rand() & 0xFF));
+        inputs[3].push_back(0);
+    }
+    inputs.push_back(std::vector<uint8_t>(13, 'a'));
+    inputs.push_back(std::vector<uint8_t>(3, 'b'));
+
+    for (const std::vector<uint8_t>& input : inputs) {
+        std::vector<uint8_t> compressed;
+        wstux::wd::details::lz_codec::compress(input.data(), input.size(), compressed);
+        std::vector<uint8_t> output(input.size(), 0xAA);
+        EXPECT_TRUE(wstux::wd::details::lz_codec::decompress(compressed.data(), compressed.size(), output.data(), output.size()));
+        EXPECT_TRUE(output == input) << input.size();
+        EXPECT_FALSE(wstux::wd::details::lz_codec::decompress(compressed.data(), compressed.size(), output.data(), output.size() + 1));
+        if (input.size() > 10000) {
+            EXPECT_FALSE(wstux::wd::details::lz_codec::decompress(compressed.data(), compressed.size() / 2, output.data(), output.size()));
+        }
+    }
+}
+
+TEST(xor_filter, false_positives)
+{
+    std::mt19937_64 gen(44);
+    std::vector<uint64_t> hashes(10000);
+    for (uint64_t& h : hashes) {
+        h = gen();
+    }
+    const std::vector<uint64_t> keys = hashes;
+
+    const unsigned bits[] = {4, 8, 12};
+    for (const unsigned b : bits) {
+        std::vector<uint64_t> build_hashes = keys;
+        wstux::wd::details::xor_filter filter;
+        ASSERT_TRUE(filter.build(build_hashes, b));
+        EXPECT_TRUE(filter.bits() == b);
+        for (const uint64_t h : keys) {
+            EXPECT_TRUE(filter.contains(h)) << b << ": " << h;
+        }
+
+        size_t positives = 0;
+        const size_t misses = 100000;
+        for (size_t i = 0; i < misses; ++i) {
+            positives += filter.contains(gen()) ? 1 : 0;
+        }
+        // Twice the expected rate of 2^-bits.
+        EXPECT_TRUE(positives * (size_t(1) << b) < 2 * misses) << b << ": " << positives;
+    }
+
+    EXPECT_TRUE(wstux::wd::details::xor_filter::fingerprint_bits(0.01) == 7);
+    EXPECT_TRUE(wstux::wd::details::xor_filter::fingerprint_bits(1.0 / 256) == 8);
+    EXPECT_TRUE(wstux::wd::details::xor_filter::fingerprint_bits(1e-9) == 16);
+
+    // Duplicated hashes are built once.
+    std::vector<uint64_t> duplicates = {1, 2, 2, 3, 3, 3};
+    wstux::wd::details::xor_filter filter;
+    ASSERT_TRUE(filter.build(duplicates, 8));
+    EXPECT_TRUE(filter.contains(1) && filter.contains(2) && filter.contains(3));
+}
+
+TYPED_TEST(wd_fixture, cold_dict)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    std::map<string_type, int64_t> words;
+    std::srand(38);
+    for (int64_t i = 0; i < 5000; ++i) {
+        string_type word;
+        for (int len = 2 + std::rand() % 10; len > 0; --len) {
+            word.push_back('a' + std::rand() % 26);
+        }
+        words.emplace(word, i);
+    }
+
+    wstux::wd::builder<char_type> builder;
+    for (const std::pair<const string_type, int64_t>& w : words) {
+        ASSERT_TRUE(builder.insert(w.first, w.second));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_cold_" + std::to_string(sizeof(char_type)) + ".wdc")).string();
+    const size_t block_units[] = {256, 4096};
+    for (const size_t units : block_units) {
+        wstux::wd::cold_dict<char_type> cold(4);
+        EXPECT_FALSE(cold.compress(dict, units + 1));
+        ASSERT_TRUE(cold.compress(dict, units));
+        EXPECT_TRUE(cold.size() == dict.size());
+        EXPECT_TRUE(cold.blocks_count() == (dict.size() + units - 1) / units);
+        EXPECT_TRUE(cold.image_size() < dict.size() * sizeof(typename wstux::wd::word_dict<char_type>::base_type))
+            << cold.image_size() << " >= " << dict.size() * sizeof(typename wstux::wd::word_dict<char_type>::base_type);
+        ASSERT_TRUE(cold.save(path));
+
+        wstux::wd::cold_dict<char_type> loaded;
+        ASSERT_TRUE(loaded.load(path));
+        wstux::wd::cold_dict<char_type> mapped(2);
+        ASSERT_TRUE(mapped.map(path));
+        for (const std::pair<const string_type, int64_t>& w : words) {
+            ASSERT_TRUE(cold.find(w.first) == w.second) << cold.find(w.first) << " != " << w.second;
+            ASSERT_TRUE(loaded.find(w.first) == w.second) << loaded.find(w.first) << " != " << w.second;
+            ASSERT_TRUE(mapped.find(w.first) == w.second) << mapped.find(w.first) << " != " << w.second;
+        }
+        EXPECT_TRUE(cold.find(U(char_type, "0")) == -1);
+        EXPECT_TRUE(cold.cache_hits() > cold.cache_misses()) << cold.cache_hits() << " <= " << cold.cache_misses();
+
+        size_t prefixes = 0;
+        const string_type& key = words.begin()->first;
+        cold.common_prefix_search(key + key, [&prefixes](const size_t, const int64_t) { ++prefixes; });
+        EXPECT_TRUE(prefixes >= 1);
+    }
+
+    // Corrupted blocks are not used, corrupted header is rejected.
+    std::vector<char> image;
+    {
+        std::ifstream in(path, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    for (size_t i = image.size() / 2; i < image.size() / 2 + 64; ++i) {
+        image[i] ^= 0x5A;
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), image.size());
+    }
+    wstux::wd::cold_dict<char_type> corrupted;
+    ASSERT_TRUE(corrupted.load(path));
+    size_t found = 0;
+    for (const std::pair<const string_type, int64_t>& w : words) {
+        const int64_t value = corrupted.find(w.first);
+        EXPECT_TRUE((value == -1) || (value == w.second)) << value << " != " << w.second;
+        found += (value == w.second) ? 1 : 0;
+    }
+    EXPECT_TRUE((found > 0) && (found < words.size())) << found;
+
+    image[2 * sizeof(uint64_t)] ^= 0x01;
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), image.size());
+    }
+    EXPECT_FALSE(corrupted.load(path));
+    EXPECT_FALSE(corrupted.map(path));
+    std::remove(path.c_str());
+}
+
+TYPED_TEST(wd_fixture, packed_values)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using value_type = typename wstux::wd::word_dict<char_type>::value_type;
+
+    const auto value_of = [](const size_t i) -> value_type {
+        return (i % 3 == 0) ? (value_type)(i % 7) : (value_type)((i * 7919) % 1000000 + 1000000);
+    };
+
+    const wstux::wd::value_coding codings[] = {wstux::wd::value_coding::inline_units,
+                                               wstux::wd::value_coding::packed,
+                                               wstux::wd::value_coding::frame_of_reference};
+    for (const wstux::wd::value_coding coding : codings) {
+        wstux::wd::builder<char_type> builder(coding);
+        string_type str = U(char_type, "bugaga");
+        for (size_t i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(builder.insert(str, value_of(i)));
+            str += 'a' + (i % 26);
+        }
+
+        wstux::wd::word_dict<char_type> dict;
+        ASSERT_TRUE(builder.build(dict));
+        EXPECT_TRUE(dict.is_values_packed() == (coding != wstux::wd::value_coding::inline_units));
+
+        const std::string path = (std::filesystem::temp_directory_path()
+                                  / ("ut_word_dict_packed_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+        ASSERT_TRUE(dict.save(path));
+
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE(loaded.load(path));
+        wstux::wd::word_dict<char_type> mapped;
+        ASSERT_TRUE(mapped.map(path));
+        std::remove(path.c_str());
+
+        str = U(char_type, "bugaga");
+        for (size_t i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(dict.find(str) == value_of(i)) << i << ": " << dict.find(str);
+            ASSERT_TRUE(loaded.find(str) == value_of(i)) << i << ": " << loaded.find(str);
+            ASSERT_TRUE(mapped.find(str) == value_of(i)) << i << ": " << mapped.find(str);
+            str += 'a' + (i % 26);
+        }
+        EXPECT_TRUE(mapped.find(U(char_type, "bugag")) == -1) << mapped.find(U(char_type, "bugag"));
+    }
+
+    // Blocks out of the array are rejected.
+    std::vector<value_type> values;
+    for (size_t i = 0; i < 1000; ++i) {
+        values.push_back(value_of(i));
+    }
+    wstux::wd::details::packed_values<value_type> packed;
+    packed.assign(values, wstux::wd::value_coding::frame_of_reference);
+    const std::vector<uint64_t> words(packed.data(), packed.data() + packed.words_count());
+    const size_t last_header = 2 + 2 * (words[1] - 1) + 1;
+
+    wstux::wd::details::packed_values<value_type> attached;
+    EXPECT_TRUE(attached.attach(words.data(), words.size()));
+    EXPECT_FALSE(attached.attach(words.data(), words.size() - 1));
+
+    std::vector<uint64_t> corrupted = words;
+    corrupted[last_header] += uint64_t(64) << 8;
+    EXPECT_FALSE(attached.attach(corrupted.data(), corrupted.size()));
+    corrupted = words;
+    corrupted[last_header] = (corrupted[last_header] & ~uint64_t(0xFF)) | 64;
+    EXPECT_FALSE(attached.attach(corrupted.data(), corrupted.size()));
+    corrupted = words;
+    corrupted[last_header] &= ~uint64_t(0xFF);
+    EXPECT_FALSE(attached.attach(corrupted.data(), corrupted.size()));
+    corrupted = words;
+    corrupted[1] = uint64_t(-1);
+    EXPECT_FALSE(attached.attach(corrupted.data(), corrupted.size()));
+}
+
+TYPED_TEST(wd_fixture, unit_width)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using narrow_dict = wstux::wd::word_dict<char_type, uint32_t, int64_t>;
+    using wide_dict = wstux::wd::word_dict<char_type, uint64_t, int64_t>;
+
+    // Values do not fit the leaf unit of the narrow dictionary.
+    const auto value_of = [](const size_t i) -> int64_t { return ((int64_t)1 << 40) + (int64_t)i; };
+
+    wstux::wd::builder<char_type, uint32_t, int64_t> narrow_builder;
+    wstux::wd::builder<char_type, uint64_t, int64_t> wide_builder;
+    string_type str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(narrow_builder.insert(str, value_of(i)));
+        ASSERT_TRUE(wide_builder.insert(str, value_of(i)));
+        str += (sizeof(char_type) == 1) ? char_type('a' + (i % 26)) : char_type(0x3B1 + (i % 4) * 0x1000);
+    }
+
+    narrow_dict narrow;
+    ASSERT_TRUE(narrow_builder.build(narrow));
+    EXPECT_TRUE(narrow.is_values_packed());
+    wide_dict wide;
+    ASSERT_TRUE(wide_builder.build(wide));
+    EXPECT_FALSE(wide.is_values_packed());
+
+    str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(narrow.find(str) == value_of(i)) << i << ": " << narrow.find(str);
+        ASSERT_TRUE(wide.find(str) == value_of(i)) << i << ": " << wide.find(str);
+        str += (sizeof(char_type) == 1) ? char_type('a' + (i % 26)) : char_type(0x3B1 + (i % 4) * 0x1000);
+    }
+    EXPECT_TRUE(narrow.find(U(char_type, "bugag")) == -1) << narrow.find(U(char_type, "bugag"));
+    EXPECT_TRUE(wide.find(U(char_type, "bugag")) == -1) << wide.find(U(char_type, "bugag"));
+
+    // The minimal widths are reported for keys in any order.
+    using key_set = typename wstux::wd::builder<char_type, uint64_t, int64_t>::key_set;
+    key_set keys = {{U(char_type, "яблоко"), 3}, {U(char_type, "Bugaga"), 1}, {U(char_type, "able"), 2}};
+    size_t unit_bytes = 0;
+    size_t value_bytes = 0;
+    ASSERT_TRUE(wide_builder.fit_widths(keys, unit_bytes, value_bytes));
+    EXPECT_TRUE(unit_bytes == sizeof(uint32_t)) << unit_bytes;
+    EXPECT_TRUE(value_bytes == sizeof(int32_t)) << value_bytes;
+
+    keys.push_back({U(char_type, "bugaga"), value_of(0)});
+    ASSERT_TRUE(wide_builder.fit_widths(keys, unit_bytes, value_bytes));
+    EXPECT_TRUE(unit_bytes == sizeof(uint32_t)) << unit_bytes;
+    EXPECT_TRUE(value_bytes == sizeof(int64_t)) << value_bytes;
+
+    // Keys are sorted after the normalization.
+    keys.push_back({U(char_type, "Zz"), 4});
+    wstux::wd::builder<char_type, uint64_t, int64_t> lower_builder(wstux::wd::value_coding::inline_units,
+                                                                   wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(lower_builder.fit_widths(keys, unit_bytes, value_bytes));
+    EXPECT_TRUE(unit_bytes == sizeof(uint32_t)) << unit_bytes;
+    EXPECT_TRUE(value_bytes == sizeof(int64_t)) << value_bytes;
+}
+
+TYPED_TEST(wd_fixture, bidi_dict)
+{
+    using char_type = TypeParam;
+    using match_type = std::pair<size_t, int64_t>;
+
+    const wstux::wd::value_coding codings[] = {wstux::wd::value_coding::inline_units,
+                                               wstux::wd::value_coding::frame_of_reference};
+    for (const wstux::wd::value_coding coding : codings) {
+        wstux::wd::builder<char_type> builder(coding);
+        EXPECT_TRUE(builder.insert(U(char_type, "able"), 1));
+        EXPECT_TRUE(builder.insert(U(char_type, "ble"), 2));
+        EXPECT_TRUE(builder.insert(U(char_type, "bugaga"), 3));
+        EXPECT_TRUE(builder.insert(U(char_type, "e"), 4));
+        EXPECT_TRUE(builder.insert(U(char_type, "read"), 5));
+        EXPECT_TRUE(builder.insert(U(char_type, "readable"), 6));
+        EXPECT_TRUE(builder.insert(U(char_type, "яблоко"), 7));
+
+        wstux::wd::bidi_dict<char_type> dict;
+        ASSERT_TRUE(builder.build(dict));
+        EXPECT_TRUE(dict.forward().is_values_packed() == dict.reverse().is_values_packed());
+        EXPECT_TRUE(dict.find(U(char_type, "readable")) == 6) << dict.find(U(char_type, "readable"));
+        EXPECT_TRUE(dict.reverse().find(U(char_type, "agagub")) == 3) << dict.reverse().find(U(char_type, "agagub"));
+
+        std::vector<match_type> matches;
+        dict.common_suffix_search(U(char_type, "readable"), [&matches](const size_t len, const int64_t value) {
+            matches.emplace_back(len, value);
+        });
+        const std::vector<match_type> suffixes = {{1, 4}, {3, 2}, {4, 1}, {8, 6}};
+        EXPECT_TRUE(matches == suffixes) << matches.size();
+
+        matches.clear();
+        dict.common_prefix_search(U(char_type, "readable"), [&matches](const size_t len, const int64_t value) {
+            matches.emplace_back(len, value);
+        });
+        const std::vector<match_type> prefixes = {{4, 5}, {8, 6}};
+        EXPECT_TRUE(matches == prefixes) << matches.size();
+
+        EXPECT_TRUE(dict.has_prefix(U(char_type, "rea")));
+        EXPECT_FALSE(dict.has_prefix(U(char_type, "rb")));
+        EXPECT_TRUE(dict.has_suffix(U(char_type, "gaga")));
+        EXPECT_TRUE(dict.has_suffix(U(char_type, "dable")));
+        EXPECT_FALSE(dict.has_suffix(U(char_type, "gag")));
+        EXPECT_TRUE(dict.has_suffix(U(char_type, "локо")));
+        EXPECT_FALSE(dict.has_suffix(U(char_type, "лок")));
+
+        matches.clear();
+        dict.common_suffix_search(U(char_type, "большое яблоко"), [&matches](const size_t len, const int64_t value) {
+            matches.emplace_back(len, value);
+        });
+        EXPECT_TRUE((matches.size() == 1) && (matches[0].second == 7)) << matches.size();
+    }
+}
+
+TYPED_TEST(wd_fixture, pattern_matcher)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using match_type = std::pair<string_type, int64_t>;
+
+    std::map<string_type, int64_t> words;
+    words.emplace(U(char_type, "bugaga"), 1);
+    words.emplace(U(char_type, "bugagb"), 2);
+    words.emplace(U(char_type, "bugora"), 3);
+    words.emplace(U(char_type, "cugara"), 4);
+    words.emplace(U(char_type, "a*b"), 5);
+    words.emplace(U(char_type, "яблоко"), 6);
+    std::srand(33);
+    for (int64_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 5);
+        }
+        words.emplace(word, 7 + i);
+    }
+
+    // Keys are inserted in the order of unsigned characters.
+    std::vector<match_type> sorted(words.cbegin(), words.cend());
+    std::sort(sorted.begin(), sorted.end(), [](const match_type& lhs, const match_type& rhs) {
+        using ustring_type = std::basic_string<typename std::make_unsigned<char_type>::type>;
+        return ustring_type(lhs.first.cbegin(), lhs.first.cend()) < ustring_type(rhs.first.cbegin(), rhs.first.cend());
+    });
+
+    wstux::wd::builder<char_type> builder;
+    for (const match_type& w : sorted) {
+        ASSERT_TRUE(builder.insert(w.first, w.second));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::guide<char_type> guide;
+    ASSERT_TRUE(builder.build(dict, guide));
+    EXPECT_TRUE(guide.size() == dict.size()) << guide.size() << " != " << dict.size();
+
+    const string_type patterns[] = {
+        U(char_type, "b?ga*"), U(char_type, "[abc]ug?ra"), U(char_type, "*a"), U(char_type, "a*b*c"),
+        U(char_type, "[^a-c]*"), U(char_type, "*"), U(char_type, "?"), U(char_type, "a\\*b"),
+        U(char_type, "*[d-e]?[a]"), U(char_type, "**e**e**"), U(char_type, "я*"), U(char_type, "*ко"),
+        U(char_type, "[ab][ab][ab]"), U(char_type, "zz*"), U(char_type, "")
+    };
+    wstux::wd::pattern_matcher<char_type> matcher(dict, guide);
+    for (const string_type& pattern : patterns) {
+        std::vector<match_type> expected;
+        for (const std::pair<const string_type, int64_t>& w : words) {
+            if (is_glob_matched(pattern.data(), pattern.data() + pattern.size(), w.first.data(), w.first.data() + w.first.size())) {
+                expected.emplace_back(w.first, w.second);
+            }
+        }
+
+        std::vector<match_type> matches;
+        EXPECT_TRUE(matcher.match(pattern, [&matches](const std::basic_string_view<char_type>& key, const int64_t value) {
+            matches.emplace_back(string_type(key), value);
+        }));
+        std::sort(matches.begin(), matches.end());
+        EXPECT_TRUE(matches == expected) << matches.size() << " != " << expected.size();
+    }
+
+    const string_type malformed[] = {U(char_type, "a["), U(char_type, "[]"), U(char_type, "[z-a]"), U(char_type, "ab\\")};
+    for (const string_type& pattern : malformed) {
+        EXPECT_FALSE(matcher.match(pattern, [](const std::basic_string_view<char_type>&, const int64_t) {}));
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_guide_" + std::to_string(sizeof(char_type)) + ".wdg")).string();
+    ASSERT_TRUE(guide.save(path));
+    wstux::wd::guide<char_type> loaded;
+    ASSERT_TRUE(loaded.load(path));
+    EXPECT_TRUE(loaded.size() == guide.size());
+    size_t count = 0;
+    wstux::wd::pattern_matcher<char_type>(dict, loaded).match(U(char_type, "*"), [&count](const auto&, const int64_t) {
+        ++count;
+    });
+    EXPECT_TRUE(count == words.size()) << count << " != " << words.size();
+
+    // The damaged guide is rejected.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+        file.seekp(-1, std::ios::end);
+        file.put('x');
+    }
+    EXPECT_FALSE(loaded.load(path));
+    EXPECT_TRUE(loaded.empty());
+    std::remove(path.c_str());
+
+    // The guide of another dictionary is not followed.
+    wstux::wd::builder<char_type> other_builder;
+    ASSERT_TRUE(other_builder.insert(U(char_type, "bugaga"), 1));
+    wstux::wd::word_dict<char_type> other;
+    wstux::wd::guide<char_type> other_guide;
+    ASSERT_TRUE(other_builder.build(other, other_guide));
+    ASSERT_TRUE(other_guide.size() != dict.size());
+    count = 0;
+    EXPECT_TRUE(wstux::wd::pattern_matcher<char_type>(dict, other_guide).match(U(char_type, "*"), [&count](const auto&, const int64_t) {
+        ++count;
+    }));
+    EXPECT_TRUE(count == 0) << count;
+
+    // Patterns are normalized like keys of the normalized dictionary.
+    wstux::wd::builder<char_type> folded_builder(wstux::wd::value_coding::inline_units,
+                                                 wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abc"), 1));
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abd"), 2));
+    wstux::wd::word_dict<char_type> folded;
+    wstux::wd::guide<char_type> folded_guide;
+    ASSERT_TRUE(folded_builder.build(folded, folded_guide));
+
+    const match_type abc(U(char_type, "abc"), 1);
+    const match_type abd(U(char_type, "abd"), 2);
+    const std::pair<string_type, std::vector<match_type>> folded_patterns[] = {
+        {U(char_type, "[Aa]bc"), {abc}}, {U(char_type, "ABC"), {abc}}, {U(char_type, "AB?"), {abc, abd}},
+        {U(char_type, "[A-C]b[^D]"), {abc}}, {U(char_type, "A*"), {abc, abd}}, {U(char_type, "abC"), {abc}}
+    };
+    wstux::wd::pattern_matcher<char_type> folded_matcher(folded, folded_guide);
+    for (const std::pair<string_type, std::vector<match_type>>& p : folded_patterns) {
+        std::vector<match_type> matches;
+        EXPECT_TRUE(folded_matcher.match(p.first, [&matches](const std::basic_string_view<char_type>& key, const int64_t value) {
+            matches.emplace_back(string_type(key), value);
+        }));
+        EXPECT_TRUE(matches == p.second) << matches.size() << " != " << p.second.size();
+    }
+}
+
+TYPED_TEST(wd_fixture, dfa_matcher)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using match_type = std::pair<string_type, int64_t>;
+    using dfa_type = wstux::wd::dfa<char_type>;
+
+    std::vector<match_type> words;
+    words.emplace_back(U(char_type, "bugaga"), 1);
+    words.emplace_back(U(char_type, "bugora"), 2);
+    words.emplace_back(U(char_type, "яблоко"), 3);
+    std::srand(34);
+    for (int64_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 5);
+        }
+        words.emplace_back(word, 4 + i);
+    }
+    std::sort(words.begin(), words.end(), [](const match_type& lhs, const match_type& rhs) {
+        using ustring_type = std::basic_string<uchar_type>;
+        return ustring_type(lhs.first.cbegin(), lhs.first.cend()) < ustring_type(rhs.first.cbegin(), rhs.first.cend());
+    });
+    words.erase(std::unique(words.begin(), words.end(),
+                            [](const match_type& lhs, const match_type& rhs) { return lhs.first == rhs.first; }),
+                words.end());
+
+    wstux::wd::builder<char_type> builder;
+    for (const match_type& w : words) {
+        ASSERT_TRUE(builder.insert(w.first, w.second));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::guide<char_type> guide;
+    ASSERT_TRUE(builder.build(dict, guide));
+
+    const char_type max_char = static_cast<char_type>(std::numeric_limits<uchar_type>::max());
+
+    // Even count of 'a' and the last character is 'b' or 'c'.
+    dfa_type parity;
+    for (int s = 0; s < 4; ++s) {
+        parity.add_state(s == 1);
+    }
+    for (int s = 0; s < 4; ++s) {
+        const int even = s & 2;
+        EXPECT_TRUE(parity.add_transition(s, 'a', (even ^ 2)));
+        EXPECT_TRUE(parity.add_transition(s, 'b', 'c', even | 1));
+        EXPECT_TRUE(parity.add_transition(s, 'd', max_char, even));
+        EXPECT_FALSE(parity.add_transition(s, 'c', 'd', even));
+    }
+
+    // "bug" followed by 'a' or 'o' and any characters.
+    dfa_type prefix;
+    for (int s = 0; s < 5; ++s) {
+        prefix.add_state(s == 4);
+    }
+    EXPECT_TRUE(prefix.add_transition(0, 'b', 1));
+    EXPECT_TRUE(prefix.add_transition(1, 'u', 2));
+    EXPECT_TRUE(prefix.add_transition(2, 'g', 3));
+    EXPECT_TRUE(prefix.add_transition(3, 'a', 4));
+    EXPECT_TRUE(prefix.add_transition(3, 'o', 4));
+    EXPECT_TRUE(prefix.add_transition(4, 0, max_char, 4));
+    EXPECT_FALSE(prefix.add_transition(4, 'a', 5));
+
+    wstux::wd::dfa_matcher<char_type> matcher(dict, guide);
+    for (const dfa_type* p_dfa : {&parity, &prefix}) {
+        std::vector<match_type> expected;
+        for (const match_type& w : words) {
+            typename dfa_type::state_type state = 0;
+            for (size_t i = 0; (i < w.first.size()) && (state != dfa_type::npos); ++i) {
+                state = p_dfa->next(state, static_cast<uchar_type>(w.first[i]));
+            }
+            if ((state != dfa_type::npos) && p_dfa->is_final(state)) {
+                expected.push_back(w);
+            }
+        }
+
+        std::vector<match_type> matches;
+        EXPECT_TRUE(matcher.match(*p_dfa, [&matches](const std::basic_string_view<char_type>& key, const int64_t value) {
+            matches.emplace_back(string_type(key), value);
+        }));
+        EXPECT_TRUE(! matches.empty() && (matches == expected)) << matches.size() << " != " << expected.size();
+    }
+    EXPECT_FALSE(matcher.match(dfa_type(), [](const std::basic_string_view<char_type>&, const int64_t) {}));
+
+    // The DFA is matched against keys of the normalized dictionary as they
+    // are stored, by direct transitions and by enumerated ones alike.
+    wstux::wd::builder<char_type> folded_builder(wstux::wd::value_coding::inline_units,
+                                                 wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abc"), 1));
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abd"), 2));
+    wstux::wd::word_dict<char_type> folded;
+    wstux::wd::guide<char_type> folded_guide;
+    ASSERT_TRUE(folded_builder.build(folded, folded_guide));
+
+    // [Aa] [Bb] [C-Dc-d] by few characters and by wide ranges.
+    dfa_type narrow;
+    dfa_type wide;
+    for (int s = 0; s < 4; ++s) {
+        narrow.add_state(s == 3);
+        wide.add_state(s == 3);
+    }
+    const char_type upper[] = {'A', 'B', 'C'};
+    const char_type lower[] = {'a', 'b', 'c'};
+    for (int s = 0; s < 3; ++s) {
+        EXPECT_TRUE(narrow.add_transition(s, upper[s], upper[s] + (s / 2), s + 1));
+        EXPECT_TRUE(narrow.add_transition(s, lower[s], lower[s] + (s / 2), s + 1));
+        EXPECT_TRUE(wide.add_transition(s, 0, 'Z', s + 1));
+        EXPECT_TRUE(wide.add_transition(s, lower[s], lower[s] + (s / 2), s + 1));
+    }
+    dfa_type upper_only;
+    for (int s = 0; s < 4; ++s) {
+        upper_only.add_state(s == 3);
+    }
+    for (int s = 0; s < 3; ++s) {
+        EXPECT_TRUE(upper_only.add_transition(s, upper[s], s + 1));
+    }
+
+    const std::vector<match_type> both = {match_type(U(char_type, "abc"), 1), match_type(U(char_type, "abd"), 2)};
+    wstux::wd::dfa_matcher<char_type> folded_matcher(folded, folded_guide);
+    for (const dfa_type* p_dfa : {&narrow, &wide, &upper_only}) {
+        std::vector<match_type> matches;
+        EXPECT_TRUE(folded_matcher.match(*p_dfa, [&matches](const std::basic_string_view<char_type>& key, const int64_t value) {
+            matches.emplace_back(string_type(key), value);
+        }));
+        EXPECT_TRUE(matches == ((p_dfa == &upper_only) ? std::vector<match_type>() : both)) << matches.size();
+    }
+}
+
+TYPED_TEST(wd_fixture, ordered_index)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    std::vector<string_type> words = {U(char_type, "bugaga"), U(char_type, "яблоко"), U(char_type, "ябло")};
+    std::srand(35);
+    for (size_t i = 0; i < 3000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 6);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    wstux::wd::builder<char_type> builder;
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_TRUE(builder.insert(words[i], i % 7));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::guide<char_type> guide;
+    ASSERT_TRUE(builder.build(dict, guide));
+
+    wstux::wd::ordered_index<char_type> index(dict, guide);
+    ASSERT_TRUE(index.size() == words.size()) << index.size() << " != " << words.size();
+
+    size_t rank = 0;
+    for (typename wstux::wd::ordered_index<char_type>::iterator it = index.begin(); it != index.end(); ++it, ++rank) {
+        ASSERT_TRUE(rank < words.size());
+        EXPECT_TRUE(it.key() == words[rank]) << rank;
+        EXPECT_TRUE(it.value() == (int64_t)(rank % 7)) << rank;
+    }
+    EXPECT_TRUE(rank == words.size()) << rank << " != " << words.size();
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        EXPECT_TRUE(index.rank(words[i]) == i) << i << ": " << index.rank(words[i]);
+        EXPECT_TRUE(index.select(i).key() == words[i]) << i;
+    }
+    EXPECT_TRUE(index.select(words.size()) == index.end());
+
+    const string_type absent[] = {U(char_type, ""), U(char_type, "aaaaaaaaa"), U(char_type, "bugag"), U(char_type, "bugagaa"),
+                                  U(char_type, "fz"), U(char_type, "z"), U(char_type, "ябл"), U(char_type, "яя")};
+    for (const string_type& key : absent) {
+        const size_t expected = std::lower_bound(words.cbegin(), words.cend(), key, less) - words.cbegin();
+        EXPECT_TRUE(index.rank(key) == expected) << index.rank(key) << " != " << expected;
+    }
+
+    // Pagination.
+    typename wstux::wd::ordered_index<char_type>::iterator it = index.select(1000);
+    for (size_t i = 1000; i < 1100; ++i, ++it) {
+        ASSERT_TRUE(it != index.end());
+        EXPECT_TRUE(it.key() == words[i]) << i;
+    }
+
+    // Keys are ranked like they are found: normalized.
+    wstux::wd::builder<char_type> folded_builder(wstux::wd::value_coding::inline_units,
+                                                 wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abc"), 0));
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abd"), 1));
+    ASSERT_TRUE(folded_builder.insert(U(char_type, "abe"), 2));
+    wstux::wd::word_dict<char_type> folded;
+    wstux::wd::guide<char_type> folded_guide;
+    ASSERT_TRUE(folded_builder.build(folded, folded_guide));
+    const wstux::wd::ordered_index<char_type> folded_index(folded, folded_guide);
+    EXPECT_TRUE(folded.find(U(char_type, "ABD")) == 1);
+    EXPECT_TRUE(folded_index.rank(U(char_type, "ABD")) == 1) << folded_index.rank(U(char_type, "ABD"));
+    EXPECT_TRUE(folded_index.rank(U(char_type, "aBz")) == 3) << folded_index.rank(U(char_type, "aBz"));
+
+    // The guide of another dictionary is not followed.
+    const wstux::wd::ordered_index<char_type> mismatched(dict, folded_guide);
+    EXPECT_TRUE(mismatched.empty());
+    EXPECT_TRUE(mismatched.size() == 0) << mismatched.size();
+    EXPECT_TRUE(mismatched.begin() == mismatched.end());
+}
+
+TYPED_TEST(wd_fixture, lookup_executor)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+    using view_type = std::basic_string_view<char_type>;
+    using executor_type = wstux::wd::lookup_executor<char_type>;
+    using result_type = std::vector<std::pair<string_type, int64_t>>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    std::vector<string_type> words = {U(char_type, "bugaga"), U(char_type, "яблоко"), U(char_type, "ябло")};
+    std::srand(41);
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 5);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    wstux::wd::builder<char_type> builder;
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_TRUE(builder.insert(words[i], i));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::guide<char_type> guide;
+    ASSERT_TRUE(builder.build(dict, guide));
+
+    // Queries of all kinds over keys, their prefixes and missing keys.
+    std::vector<string_type> keys = words;
+    keys.push_back(U(char_type, "ябл"));
+    keys.push_back(U(char_type, "яблоки"));
+    keys.push_back(U(char_type, "bugagaga"));
+    keys.push_back(U(char_type, "zzz"));
+    keys.push_back(U(char_type, ""));
+    std::vector<typename executor_type::query> queries;
+    std::vector<result_type> expected;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const wstux::wd::query_kind kind = (i % 3 == 0) ? wstux::wd::query_kind::find
+            : ((i % 3 == 1) ? wstux::wd::query_kind::common_prefix : wstux::wd::query_kind::predictive);
+        queries.push_back({kind, keys[i]});
+
+        expected.emplace_back();
+        if (kind == wstux::wd::query_kind::find) {
+            if (dict.find(keys[i]) != -1) {
+                expected.back().emplace_back(keys[i], dict.find(keys[i]));
+            }
+        } else if (kind == wstux::wd::query_kind::common_prefix) {
+            dict.common_prefix_search(keys[i], [&](const size_t len, const int64_t value) {
+                expected.back().emplace_back(keys[i].substr(0, len), value);
+            });
+        } else {
+            for (size_t w = 0; w < words.size(); ++w) {
+                if (words[w].compare(0, keys[i].size(), keys[i]) == 0) {
+                    expected.back().emplace_back(words[w], w);
+                }
+            }
+        }
+    }
+
+    const size_t widths[] = {1, 3, 16};
+    for (const size_t width : widths) {
+        executor_type without_guide(dict, width);
+        EXPECT_FALSE(without_guide.run(queries, [](const size_t, const view_type&, const int64_t) {}));
+        const wstux::wd::guide<char_type> empty_guide;
+        executor_type other_guide(dict, empty_guide, width);
+        EXPECT_FALSE(other_guide.run(queries, [](const size_t, const view_type&, const int64_t) {}));
+
+        executor_type executor(dict, guide, width);
+        EXPECT_TRUE(executor.width() == width);
+        std::vector<result_type> results(queries.size());
+        EXPECT_TRUE(executor.run(queries, [&results](const size_t q, const view_type& key, const int64_t value) {
+            results[q].emplace_back(string_type(key), value);
+        }));
+        for (size_t i = 0; i < queries.size(); ++i) {
+            EXPECT_TRUE(results[i] == expected[i]) << width << ": " << i << ": " << results[i].size()
+                                                   << " != " << expected[i].size();
+        }
+
+        std::vector<view_type> views(keys.cbegin(), keys.cend());
+        std::vector<typename executor_type::value_type> values(views.size(), 0);
+        executor.find(views.data(), views.size(), values.data());
+        for (size_t i = 0; i < views.size(); ++i) {
+            EXPECT_TRUE(values[i] == dict.find(views[i])) << width << ": " << i << ": " << values[i];
+        }
+    }
+
+    // Queries are normalized like keys.
+    wstux::wd::builder<char_type> lower_builder(wstux::wd::value_coding::inline_units,
+                                                wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(lower_builder.insert(U(char_type, "Bugaga"), 1));
+    wstux::wd::word_dict<char_type> lower_dict;
+    ASSERT_TRUE(lower_builder.build(lower_dict));
+    const string_type key_str = U(char_type, "BUGAGA");
+    const view_type key(key_str);
+    typename executor_type::value_type value = -1;
+    executor_type(lower_dict).find(&key, 1, &value);
+    EXPECT_TRUE(value == 1) << value;
+}
+
+TYPED_TEST(wd_fixture, dispatch)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+    using view_type = std::basic_string_view<char_type>;
+    using executor_type = wstux::wd::lookup_executor<char_type>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    std::vector<string_type> words = {U(char_type, "a"), U(char_type, "bugaga"), U(char_type, "яблоко")};
+    std::srand(43);
+    for (size_t i = 0; i < 1000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 6; len > 0; --len) {
+            word.push_back('a' + std::rand() % 6);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    wstux::wd::builder<char_type> builder;
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_TRUE(builder.insert(words[i], i));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(dict.dispatch_depth() == 0);
+
+    std::vector<string_type> keys = words;
+    keys.push_back(U(char_type, "яблок"));
+    keys.push_back(U(char_type, "bugagaga"));
+    keys.push_back(U(char_type, "zz"));
+    keys.push_back(U(char_type, "z"));
+    keys.push_back(U(char_type, "af"));
+    keys.push_back(U(char_type, ""));
+    std::vector<int64_t> expected;
+    for (const string_type& key : keys) {
+        expected.push_back(dict.find(key));
+    }
+
+    const size_t depths[] = {1, 2};
+    for (const size_t depth : depths) {
+        ASSERT_TRUE(dict.build_dispatch(depth)) << depth;
+        EXPECT_TRUE(dict.dispatch_depth() == depth);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            EXPECT_TRUE(dict.find(keys[i]) == expected[i]) << depth << ": " << i;
+        }
+
+        std::vector<view_type> views(keys.cbegin(), keys.cend());
+        std::vector<typename executor_type::value_type> values(views.size(), 0);
+        executor_type(dict, 3).find(views.data(), views.size(), values.data());
+        for (size_t i = 0; i < views.size(); ++i) {
+            EXPECT_TRUE(values[i] == expected[i]) << depth << ": " << i << ": " << values[i];
+        }
+    }
+    // Tables of more than 64K states are not supported.
+    EXPECT_FALSE(dict.build_dispatch(3));
+    EXPECT_TRUE(dict.dispatch_depth() == 0);
+    EXPECT_TRUE(dict.build_dispatch(0));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_TRUE(dict.find(keys[i]) == expected[i]) << i;
+    }
+
+    // The table is built by the builder and follows the normalization.
+    wstux::wd::builder<char_type> lower_builder(wstux::wd::value_coding::inline_units,
+                                                wstux::wd::normalization::ascii_lower);
+    lower_builder.set_dispatch_depth(2);
+    ASSERT_TRUE(lower_builder.insert(U(char_type, "Bugaga"), 1));
+    wstux::wd::word_dict<char_type> lower_dict;
+    ASSERT_TRUE(lower_builder.build(lower_dict));
+    EXPECT_TRUE(lower_dict.dispatch_depth() == 2);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAGA")) == 1);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAG")) == -1);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BA")) == -1);
+}
+
+TYPED_TEST(wd_fixture, filter)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+    using view_type = std::basic_string_view<char_type>;
+    using executor_type = wstux::wd::lookup_executor<char_type>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    std::vector<string_type> words = {U(char_type, "bugaga"), U(char_type, "яблоко")};
+    std::srand(45);
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 2 + std::rand() % 6; len > 0; --len) {
+            word.push_back('a' + std::rand() % 26);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    wstux::wd::builder<char_type> builder;
+    builder.set_filter_rate(1.0 / 256);
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_TRUE(builder.insert(words[i], i));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(dict.filter_size() > words.size()) << dict.filter_size();
+    EXPECT_TRUE(dict.filter_size() < 2 * words.size()) << dict.filter_size();
+
+    std::vector<view_type> views;
+    for (size_t i = 0; i < words.size(); ++i) {
+        EXPECT_TRUE(dict.may_contain(words[i])) << i;
+        EXPECT_TRUE(dict.find(words[i]) == (int64_t)i) << i;
+        views.emplace_back(words[i]);
+    }
+
+    // Misses are rejected by the filter, except for false positives.
+    std::vector<string_type> misses;
+    size_t positives = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word(9, 'a');
+        for (char_type& ch : word) {
+            ch = 'a' + std::rand() % 26;
+        }
+        positives += dict.may_contain(word) ? 1 : 0;
+        EXPECT_TRUE(dict.find(word) == -1);
+        misses.push_back(word);
+    }
+    EXPECT_TRUE(positives < 40) << positives;
+    for (const string_type& word : misses) {
+        views.emplace_back(word);
+    }
+
+    std::vector<typename executor_type::value_type> values(views.size(), 0);
+    executor_type(dict).find(views.data(), views.size(), values.data());
+    for (size_t i = 0; i < views.size(); ++i) {
+        EXPECT_TRUE(values[i] == ((i < words.size()) ? (int64_t)i : -1)) << i << ": " << values[i];
+    }
+
+    // Dictionaries without the filter pass all keys.
+    wstux::wd::word_dict<char_type> moved(std::move(dict));
+    EXPECT_TRUE(dict.filter_size() == 0);
+    EXPECT_TRUE(dict.may_contain(misses[0]));
+    EXPECT_TRUE(moved.find(words[0]) == 0);
+
+    // The filter is saved with the dictionary.
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_filter_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(moved.save(path));
+    for (size_t i = 0; i < 2; ++i) {
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE((i == 0) ? loaded.load(path) : loaded.map(path));
+        EXPECT_TRUE(loaded.filter_size() != 0);
+        EXPECT_TRUE(loaded.filter_size() == moved.filter_size()) << loaded.filter_size() << " != " << moved.filter_size();
+        EXPECT_TRUE(loaded.verify());
+        for (size_t w = 0; w < words.size(); ++w) {
+            ASSERT_TRUE(loaded.find(words[w]) == (int64_t)w) << w;
+        }
+        for (const string_type& word : misses) {
+            ASSERT_TRUE(loaded.may_contain(word) == moved.may_contain(word));
+        }
+    }
+    std::remove(path.c_str());
+
+    // Keys are hashed after the normalization.
+    wstux::wd::builder<char_type> lower_builder(wstux::wd::value_coding::inline_units,
+                                                wstux::wd::normalization::ascii_lower);
+    lower_builder.set_filter_rate(1.0 / 65536);
+    ASSERT_TRUE(lower_builder.insert(U(char_type, "Bugaga"), 1));
+    wstux::wd::word_dict<char_type> lower_dict;
+    ASSERT_TRUE(lower_builder.build(lower_dict));
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAGA")) == 1);
+    EXPECT_FALSE(lower_dict.may_contain(U(char_type, "BUGAG")));
+}
+
+TYPED_TEST(wd_fixture, branch_free)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    std::vector<string_type> words = {U(char_type, "bugaga"), U(char_type, "яблоко"), U(char_type, "яблоня")};
+    std::srand(47);
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 7; len > 0; --len) {
+            word.push_back('a' + std::rand() % 8);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    wstux::wd::builder<char_type> builder;
+    wstux::wd::builder<char_type> branch_free_builder;
+    branch_free_builder.set_branch_free(true);
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_TRUE(builder.insert(words[i], i));
+        ASSERT_TRUE(branch_free_builder.insert(words[i], i));
+    }
+    wstux::wd::word_dict<char_type> dict;
+    wstux::wd::word_dict<char_type> branch_free_dict;
+    ASSERT_TRUE(builder.build(dict));
+    ASSERT_TRUE(branch_free_builder.build(branch_free_dict));
+    EXPECT_FALSE(dict.has_dead_state());
+    EXPECT_TRUE(branch_free_dict.has_dead_state());
+    EXPECT_TRUE(branch_free_dict.size() > dict.size());
+
+    // Misses leave the dictionary at any character, pass through it or stop
+    // at states without values.
+    std::vector<string_type> keys = words;
+    keys.push_back(U(char_type, "яблок"));
+    keys.push_back(U(char_type, "яблокоо"));
+    keys.push_back(U(char_type, "bugag"));
+    keys.push_back(U(char_type, "zbugaga"));
+    keys.push_back(U(char_type, ""));
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word = words[std::rand() % words.size()];
+        word[std::rand() % word.size()] = 'a' + std::rand() % 26;
+        word.push_back('a' + std::rand() % 8);
+        keys.push_back(word);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_TRUE(branch_free_dict.find(keys[i]) == dict.find(keys[i])) << i;
+    }
+
+    // The dead state is saved with the dictionary.
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_branch_free_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(branch_free_dict.save(path));
+    for (size_t i = 0; i < 2; ++i) {
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE((i == 0) ? loaded.load(path) : loaded.map(path));
+        EXPECT_TRUE(loaded.has_dead_state());
+        EXPECT_TRUE(loaded.verify());
+        for (size_t k = 0; k < keys.size(); ++k) {
+            ASSERT_TRUE(loaded.find(keys[k]) == dict.find(keys[k])) << k;
+        }
+    }
+    std::remove(path.c_str());
+
+    // The dead state is combined with the dispatch table and the normalization.
+    wstux::wd::builder<char_type> lower_builder(wstux::wd::value_coding::inline_units,
+                                                wstux::wd::normalization::ascii_lower);
+    lower_builder.set_branch_free(true);
+    lower_builder.set_dispatch_depth(2);
+    ASSERT_TRUE(lower_builder.insert(U(char_type, "Bugaga"), 1));
+    wstux::wd::word_dict<char_type> lower_dict;
+    ASSERT_TRUE(lower_builder.build(lower_dict));
+    EXPECT_TRUE(lower_dict.has_dead_state());
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAGA")) == 1);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAG")) == -1);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BUGAGAA")) == -1);
+    EXPECT_TRUE(lower_dict.find(U(char_type, "BA")) == -1);
+}
+
+TYPED_TEST(wd_fixture, find_by_words)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    // Keys are longer and shorter than the word, so both the words and the
+    // rest of the key are followed.
+    std::vector<string_type> words = {U(char_type, "bugaga"), U(char_type, "яблоко"), U(char_type, "яблоко-яблоня")};
+    std::srand(46);
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 20; len > 0; --len) {
+            word.push_back('a' + std::rand() % 4);
+        }
+        words.push_back(word);
+    }
+    std::sort(words.begin(), words.end(), less);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    std::vector<string_type> keys = words;
+    keys.push_back(U(char_type, "яблоко-яблон"));
+    keys.push_back(U(char_type, "BUGAGA"));
+    keys.push_back(U(char_type, ""));
+    for (size_t i = 0; i < 2000; ++i) {
+        string_type word = words[std::rand() % words.size()];
+        word[std::rand() % word.size()] = (std::rand() % 2 == 0) ? 'e' : 'A' + std::rand() % 4;
+        keys.push_back(word);
+    }
+
+    const wstux::wd::normalization norms[] = {wstux::wd::normalization::none, wstux::wd::normalization::ascii_lower};
+    for (const wstux::wd::normalization norm : norms) {
+        wstux::wd::builder<char_type> builder(wstux::wd::value_coding::inline_units, norm);
+        wstux::wd::builder<char_type, uint64_t> wide_builder(wstux::wd::value_coding::inline_units, norm);
+        for (size_t i = 0; i < words.size(); ++i) {
+            ASSERT_TRUE(builder.insert(words[i], i));
+            ASSERT_TRUE(wide_builder.insert(words[i], i));
+        }
+        wstux::wd::word_dict<char_type> dict;
+        ASSERT_TRUE(builder.build(dict));
+        wstux::wd::word_dict<char_type, uint64_t> wide_dict;
+        ASSERT_TRUE(wide_builder.build(wide_dict));
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const int64_t expected = dict.find(keys[i]);
+            EXPECT_TRUE(dict.find_by_words(keys[i]) == expected) << i;
+            EXPECT_TRUE(wide_dict.find(keys[i]) == expected) << i;
+            EXPECT_TRUE(wide_dict.find_by_words(keys[i]) == expected) << i;
+        }
+    }
+}
+
+TEST(static_dict, compile_time)
+{
+    using dict_type = wstux::wd::static_dict<char, 512>;
+
+    static constexpr std::string_view keys[] = {"a", "and", "bugaga", "or", "the", "then"};
+    static constexpr dict_type dict(keys);
+    static_assert(dict.is_built() && (dict.keys_count() == 6), "static_dict: not built");
+    static_assert((dict.find("a") == 0) && (dict.find("then") == 5) && (dict.find("the") == 4), "static_dict: hit");
+    static_assert((dict.find("an") == -1) && (dict.find("") == -1) && (dict.find("thenn") == -1), "static_dict: miss");
+
+    static constexpr std::string_view unsorted[] = {"or", "and"};
+    static_assert(! dict_type(unsorted).is_built(), "static_dict: unsorted keys");
+    static constexpr std::string_view duplicated[] = {"and", "and"};
+    static_assert(! dict_type(duplicated).is_built(), "static_dict: duplicated keys");
+    static_assert(dict_type().empty() && (dict_type().find("a") == -1), "static_dict: empty");
+
+    // Units are used by word_dict in place.
+    wstux::wd::word_dict<char> wd;
+    wd.attach_units(dict.data(), dict.size());
+    for (size_t i = 0; i < std::size(keys); ++i) {
+        EXPECT_TRUE(wd.find(keys[i]) == (int64_t)i) << i;
+    }
+    EXPECT_TRUE(wd.find("an") == -1);
+}
+
+TYPED_TEST(wd_fixture, static_dict)
+{
+    using char_type = TypeParam;
+    using uchar_type = typename std::make_unsigned<char_type>::type;
+    using string_type = std::basic_string<char_type>;
+    using ustring_type = std::basic_string<uchar_type>;
+    using view_type = std::basic_string_view<char_type>;
+    using dict_type = wstux::wd::static_dict<char_type, 8192>;
+
+    const auto less = [](const string_type& lhs, const string_type& rhs) {
+        return ustring_type(lhs.cbegin(), lhs.cend()) < ustring_type(rhs.cbegin(), rhs.cend());
+    };
+
+    // The array of keys is of the fixed size.
+    std::set<string_type, decltype(less)> words(less);
+    words.insert(U(char_type, "bugaga"));
+    words.insert(U(char_type, "яблоко"));
+    words.insert(U(char_type, "ябло"));
+    std::srand(46);
+    while (words.size() < 400) {
+        string_type word;
+        for (int len = 1 + std::rand() % 6; len > 0; --len) {
+            word.push_back('a' + std::rand() % 8);
+        }
+        words.insert(word);
+    }
+    std::vector<string_type> sorted(words.cbegin(), words.cend());
+    view_type keys[400];
+    std::copy(sorted.cbegin(), sorted.cend(), keys);
+
+    const std::unique_ptr<dict_type> p_dict(new dict_type(keys));
+    ASSERT_TRUE(p_dict->is_built());
+    EXPECT_TRUE(p_dict->size() <= dict_type::capacity());
+
+    wstux::wd::word_dict<char_type> wd;
+    wd.attach_units(p_dict->data(), p_dict->size());
+    for (size_t i = 0; i < std::size(keys); ++i) {
+        EXPECT_TRUE(p_dict->find(keys[i]) == (int64_t)i) << i;
+        EXPECT_TRUE(wd.find(keys[i]) == (int64_t)i) << i;
+    }
+
+    const string_type misses[] = {U(char_type, "ябл"), U(char_type, "яблоки"), U(char_type, "bugagaga"),
+                                  U(char_type, "zzz"), U(char_type, "z")};
+    for (const string_type& miss : misses) {
+        EXPECT_TRUE(p_dict->find(miss) == -1);
+        EXPECT_TRUE(wd.find(miss) == -1);
+    }
+
+    // Keys do not fit the capacity.
+    const std::unique_ptr<wstux::wd::static_dict<char_type, 256>> p_small(new wstux::wd::static_dict<char_type, 256>(keys));
+    EXPECT_FALSE(p_small->is_built());
+    EXPECT_TRUE(p_small->find(keys[0]) == -1);
+}
+
+TYPED_TEST(wd_fixture, union_dict)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using builder_type = wstux::wd::builder<char_type>;
+    using union_type = wstux::wd::union_dict<char_type>;
+
+    // Sources: general, domain, user and blacklist dictionaries.
+    std::vector<typename builder_type::key_set> sets(4);
+    std::srand(48);
+    std::map<string_type, std::vector<int64_t>> expected;
+    for (size_t i = 0; i < 3000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 6; len > 0; --len) {
+            word.push_back('a' + std::rand() % 6);
+        }
+        const size_t source = std::rand() % sets.size();
+        std::vector<int64_t>& values = expected.emplace(word, std::vector<int64_t>(sets.size(), -1)).first->second;
+        if (values[source] == -1) {
+            values[source] = std::rand() % 3;
+            sets[source].emplace_back(word, values[source]);
+        }
+    }
+    const string_type apple = U(char_type, "яблоко");
+    sets[0].emplace_back(apple, 7);
+    sets[3].emplace_back(apple, 8);
+    expected[apple] = {7, -1, -1, 8};
+
+    builder_type builder;
+    union_type dict;
+    ASSERT_TRUE(builder.build(dict, sets));
+    EXPECT_TRUE(dict.sources_count() == sets.size());
+    // 4 sources of 3 values give at most 4^4 - 1 entries.
+    EXPECT_TRUE(dict.entries_count() < 256) << dict.entries_count();
+
+    for (const std::pair<const string_type, std::vector<int64_t>>& p : expected) {
+        const typename union_type::entry e = dict.find(p.first);
+        EXPECT_FALSE(e.empty());
+        for (size_t source = 0; source < sets.size(); ++source) {
+            EXPECT_TRUE(e.contains(source) == (p.second[source] != -1)) << source;
+            EXPECT_TRUE(e.value(source) == p.second[source]) << source << ": " << e.value(source);
+        }
+        EXPECT_FALSE(e.contains(sets.size()));
+    }
+    EXPECT_TRUE(dict.find(U(char_type, "яблок")).empty());
+    EXPECT_TRUE(dict.find(U(char_type, "zzz")).sources() == 0);
+
+    size_t prefixes = 0;
+    dict.common_prefix_search(apple, [&prefixes](const size_t len, const typename union_type::entry& e) {
+        EXPECT_TRUE((e.value(0) == 7) && (e.value(3) == 8)) << len;
+        ++prefixes;
+    });
+    EXPECT_TRUE(prefixes == 1);
+
+    // The union is one automaton: it is smaller than dictionaries of sources.
+    size_t states_count = 0;
+    for (const typename builder_type::key_set& set : sets) {
+        typename builder_type::key_set sorted = set;
+        std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+            return std::basic_string<std::make_unsigned_t<char_type>>(lhs.first.cbegin(), lhs.first.cend())
+                 < std::basic_string<std::make_unsigned_t<char_type>>(rhs.first.cbegin(), rhs.first.cend());
+        });
+        builder_type source_builder;
+        for (const auto& key : sorted) {
+            ASSERT_TRUE(source_builder.insert(key.first, key.second));
+        }
+        wstux::wd::word_dict<char_type> source_dict;
+        ASSERT_TRUE(source_builder.build(source_dict));
+        states_count += source_dict.states_count();
+    }
+    EXPECT_TRUE(dict.dict().states_count() < states_count) << dict.dict().states_count() << " >= " << states_count;
+
+    // Keys repeated in the source and too many sources are rejected.
+    std::vector<typename builder_type::key_set> repeated(1);
+    repeated[0].emplace_back(U(char_type, "bugaga"), 1);
+    repeated[0].emplace_back(U(char_type, "bugaga"), 2);
+    EXPECT_FALSE(builder.build(dict, repeated));
+    EXPECT_TRUE(dict.empty());
+    EXPECT_FALSE(builder.build(dict, std::vector<typename builder_type::key_set>(65)));
+
+    // Keys of sources are merged after the normalization.
+    builder_type lower_builder(wstux::wd::value_coding::inline_units, wstux::wd::normalization::ascii_lower);
+    std::vector<typename builder_type::key_set> cased(2);
+    cased[0].emplace_back(U(char_type, "Bugaga"), 1);
+    cased[1].emplace_back(U(char_type, "bugaga"), 2);
+    ASSERT_TRUE(lower_builder.build(dict, cased));
+    const typename union_type::entry e = dict.find(U(char_type, "BUGAGA"));
+    EXPECT_TRUE((e.sources() == 3) && (e.value(0) == 1) && (e.value(1) == 2)) << e.sources();
+}
+
+TYPED_TEST(wd_fixture, query_engine)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using view_type = std::basic_string_view<char_type>;
+    using engine_type = wstux::wd::query_engine<char_type>;
+
+    std::map<string_type, int> words;
+    std::srand(42);
+    for (int i = 0; i < 3000; ++i) {
+        string_type word;
+        for (int len = 1 + std::rand() % 6; len > 0; --len) {
+            word.push_back('a' + std::rand() % 4);
+        }
+        words.emplace(word, i);
+    }
+    wstux::wd::builder<char_type> builder;
+    ASSERT_TRUE(builder.insert(words));
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict));
+
+    std::vector<string_type> keys;
+    string_type text;
+    for (int i = 0; i < 20000; ++i) {
+        string_type key;
+        for (int len = 1 + std::rand() % 7; len > 0; --len) {
+            key.push_back('a' + std::rand() % 5);
+        }
+        keys.push_back(key);
+        text += key;
+        text.append(1 + std::rand() % 3, (i % 5 == 0) ? '\n' : ' ');
+    }
+    const std::vector<view_type> views(keys.cbegin(), keys.cend());
+
+    std::vector<typename engine_type::token> expected;
+    for (size_t i = 0, offset = 0; i < keys.size(); ++i) {
+        offset = text.find(keys[i], offset);
+        if (dict.find(keys[i]) != -1) {
+            expected.push_back({offset, keys[i].size(), dict.find(keys[i])});
+        }
+        offset += keys[i].size();
+    }
+
+    const std::pair<size_t, size_t> configs[] = {{1, 4096}, {3, 7}, {4, 1000}};
+    for (const std::pair<size_t, size_t>& config : configs) {
+        engine_type engine(dict, config.first, config.second);
+        EXPECT_TRUE(engine.threads_count() == config.first);
+
+        std::vector<typename engine_type::value_type> values(views.size(), 0);
+        engine.find(views.data(), views.size(), values.data());
+        for (size_t i = 0; i < views.size(); ++i) {
+            ASSERT_TRUE(values[i] == dict.find(views[i])) << config.first << ": " << i;
+        }
+
+        std::vector<typename engine_type::token> tokens;
+        engine.find_tokens(text, tokens);
+        ASSERT_TRUE(tokens.size() == expected.size()) << tokens.size() << " != " << expected.size();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            ASSERT_TRUE((tokens[i].offset == expected[i].offset) && (tokens[i].length == expected[i].length)
+                        && (tokens[i].value == expected[i].value)) << config.first << ": " << i;
+        }
+
+        // The engine is reused for the next job.
+        engine.find(views.data(), 10, values.data());
+        engine.find(views.data(), 0, values.data());
+    }
+    EXPECT_TRUE(engine_type(dict).threads_count() >= 1);
+}
+
+TYPED_TEST(wd_fixture, normalization)
+{
+    using char_type = TypeParam;
+
+    const wstux::wd::normalization norms[] = {wstux::wd::normalization::ascii_lower,
+                                              wstux::wd::normalization::case_fold};
+    for (const wstux::wd::normalization norm : norms) {
+        wstux::wd::builder<char_type> builder(wstux::wd::value_coding::inline_units, norm);
+        EXPECT_TRUE(builder.insert(U(char_type, "bugaga"), 1));
+        EXPECT_TRUE(builder.insert(U(char_type, "BUGAGA"), 2));
+        EXPECT_TRUE(builder.insert(U(char_type, "Apple"), 3));
+        EXPECT_TRUE(builder.insert(U(char_type, "ЯБЛОКО"), 4));
+        EXPECT_TRUE(builder.insert(U(char_type, "Zebra"), 5));
+
+        wstux::wd::word_dict<char_type> dict;
+        ASSERT_TRUE(builder.build(dict));
+        EXPECT_TRUE(dict.key_normalization() == norm);
+
+        // The last inserted key of keys equal after the normalization is kept.
+        EXPECT_TRUE(dict.find(U(char_type, "BuGaGa")) == 2) << dict.find(U(char_type, "BuGaGa"));
+        EXPECT_TRUE(dict.find(U(char_type, "apple")) == 3) << dict.find(U(char_type, "apple"));
+        EXPECT_TRUE(dict.find(U(char_type, "APPLE")) == 3) << dict.find(U(char_type, "APPLE"));
+        EXPECT_TRUE(dict.find(U(char_type, "zEBRA")) == 5) << dict.find(U(char_type, "zEBRA"));
+        EXPECT_TRUE(dict.find(U(char_type, "ЯБЛОКО")) == 4) << dict.find(U(char_type, "ЯБЛОКО"));
+        EXPECT_TRUE(dict.find(U(char_type, "appl")) == -1) << dict.find(U(char_type, "appl"));
+
+        // Non-ASCII characters are folded for 16-bit characters only.
+        const bool is_folded = (norm == wstux::wd::normalization::case_fold) && (sizeof(char_type) == 2);
+        EXPECT_TRUE(dict.find(U(char_type, "яблоко")) == (is_folded ? 4 : -1)) << dict.find(U(char_type, "яблоко"));
+        EXPECT_TRUE(dict.find(U(char_type, "ЯблокО")) == (is_folded ? 4 : -1)) << dict.find(U(char_type, "ЯблокО"));
+
+        const std::string path = (std::filesystem::temp_directory_path()
+                                  / ("ut_word_dict_norm_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+        ASSERT_TRUE(dict.save(path));
+        wstux::wd::word_dict<char_type> loaded;
+        ASSERT_TRUE(loaded.load(path));
+        EXPECT_TRUE(loaded.key_normalization() == norm);
+        EXPECT_TRUE(loaded.find(U(char_type, "BUGAGA")) == 2) << loaded.find(U(char_type, "BUGAGA"));
+        std::remove(path.c_str());
+    }
+}
+
+TYPED_TEST(wd_fixture, fst_dict)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using builder_type = wstux::wd::builder<char_type>;
+    using fst_type = wstux::wd::fst_dict<char_type>;
+
+    std::srand(50);
+    std::set<std::basic_string<std::make_unsigned_t<char_type>>> sorted;
+    while (sorted.size() < 3000) {
+        std::basic_string<std::make_unsigned_t<char_type>> word;
+        for (int len = 1 + std::rand() % 8; len > 0; --len) {
+            word.push_back('a' + std::rand() % 6);
+        }
+        sorted.insert(word);
+    }
+
+    // Monotone ids and random values.
+    for (size_t mode = 0; mode < 2; ++mode) {
+        builder_type builder(wstux::wd::value_coding::transitions);
+        builder_type dict_builder;
+        std::map<string_type, int64_t> expected;
+        int64_t id = 0;
+        for (const auto& word : sorted) {
+            const string_type key(word.cbegin(), word.cend());
+            const int64_t value = (mode == 0) ? (id += 1 + std::rand() % 3) : (std::rand() % 1000);
+            ASSERT_TRUE(builder.insert(key, value));
+            ASSERT_TRUE(dict_builder.insert(key, value));
+            expected[key] = value;
+        }
+        const string_type apple = U(char_type, "яблоко");
+        ASSERT_TRUE(builder.insert(apple, 1000000));
+        expected[apple] = 1000000;
+
+        fst_type dict;
+        ASSERT_TRUE(builder.build(dict));
+        wstux::wd::word_dict<char_type> plain;
+        ASSERT_TRUE(dict_builder.build(plain));
+        for (const std::pair<const string_type, int64_t>& p : expected) {
+            ASSERT_TRUE(dict.find(p.first) == p.second) << mode << ": " << dict.find(p.first) << " != " << p.second;
+        }
+        EXPECT_TRUE(dict.find(U(char_type, "яблок")) == -1);
+        EXPECT_TRUE(dict.find(U(char_type, "zzz")) == -1);
+
+        size_t prefixes = 0;
+        dict.common_prefix_search(apple, [&](const size_t len, const int64_t value) {
+            EXPECT_TRUE(len == apple.size()) << len;
+            EXPECT_TRUE(value == 1000000) << value;
+            ++prefixes;
+        });
+        EXPECT_TRUE(prefixes == 1);
+
+        // Distinct monotone values do not prevent sharing of states.
+        if (mode == 0) {
+            EXPECT_TRUE(2 * dict.dict().states_count() < plain.states_count())
+                << dict.dict().states_count() << " vs " << plain.states_count();
+        }
+    }
+
+    // The repeated key updates the value, keys are normalized.
+    builder_type builder(wstux::wd::value_coding::transitions, wstux::wd::normalization::ascii_lower);
+    ASSERT_TRUE(builder.insert(U(char_type, "bugaga"), 10));
+    ASSERT_TRUE(builder.insert(U(char_type, "bugor"), 3));
+    ASSERT_TRUE(builder.insert(U(char_type, "BUGOR"), 7));
+    ASSERT_TRUE(builder.insert(U(char_type, "bug"), 5));
+    fst_type dict;
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(dict.find(U(char_type, "Bugaga")) == 10) << dict.find(U(char_type, "Bugaga"));
+    EXPECT_TRUE(dict.find(U(char_type, "bugor")) == 7) << dict.find(U(char_type, "bugor"));
+    EXPECT_TRUE(dict.find(U(char_type, "bug")) == 5) << dict.find(U(char_type, "bug"));
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_fst_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(dict.save(path));
+    for (size_t i = 0; i < 2; ++i) {
+        fst_type loaded;
+        ASSERT_TRUE((i == 0) ? loaded.load(path) : loaded.map(path));
+        EXPECT_TRUE(loaded.outputs_size() == dict.outputs_size());
+        EXPECT_TRUE(loaded.find(U(char_type, "BUGAGA")) == 10) << loaded.find(U(char_type, "BUGAGA"));
+        EXPECT_TRUE(loaded.find(U(char_type, "bugor")) == 7) << loaded.find(U(char_type, "bugor"));
+        EXPECT_TRUE(loaded.find(U(char_type, "bugo")) == -1) << loaded.find(U(char_type, "bugo"));
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".outputs").c_str());
+
+    // Transducers and dictionaries are built by builders of their codings.
+    wstux::wd::word_dict<char_type> plain;
+    ASSERT_TRUE(builder.insert(U(char_type, "bugaga"), 1));
+    EXPECT_FALSE(builder.build(plain));
+    builder_type plain_builder;
+    ASSERT_TRUE(plain_builder.insert(U(char_type, "bugaga"), 1));
+    EXPECT_FALSE(plain_builder.build(dict));
+    EXPECT_TRUE(dict.empty());
+}
+
+TYPED_TEST(wd_fixture, payload_dict)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+    using builder_type = wstux::wd::builder<char_type>;
+    using payload_type = wstux::wd::payload_dict<char_type>;
+
+    const std::string_view noun("NOUN\0lemma", 10);
+    const std::string_view verb("VERB");
+    builder_type builder(wstux::wd::value_coding::inline_units, wstux::wd::normalization::ascii_lower);
+    std::map<string_type, std::string_view> expected;
+    string_type str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 500; ++i) {
+        expected[str] = ((i % 2) == 0) ? noun : verb;
+        ASSERT_TRUE(builder.insert_payload(str, expected[str]));
+        str += 'a' + (i % 26);
+    }
+    ASSERT_TRUE(builder.insert_payload(U(char_type, "BUGOR"), std::string_view()));
+    const string_type bugor = U(char_type, "bugor");
+    expected[bugor] = std::string_view();
+
+    payload_type dict;
+    ASSERT_TRUE(builder.build(dict));
+    EXPECT_TRUE(dict.payloads_count() == 3) << dict.payloads_count();
+    EXPECT_TRUE(dict.payloads_size() == noun.size() + verb.size()) << dict.payloads_size();
+
+    std::string_view payload;
+    for (const std::pair<const string_type, std::string_view>& p : expected) {
+        ASSERT_TRUE(dict.find(p.first, payload));
+        EXPECT_TRUE(payload == p.second);
+    }
+    EXPECT_TRUE(dict.find(U(char_type, "BugaGA"), payload) && (payload == noun));
+    EXPECT_FALSE(dict.find(U(char_type, "bug"), payload));
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_payload_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(dict.save(path));
+    for (size_t i = 0; i < 2; ++i) {
+        payload_type loaded;
+        ASSERT_TRUE((i == 0) ? loaded.load(path) : loaded.map(path));
+        EXPECT_TRUE(loaded.dict().is_mapped() == (i == 1));
+        EXPECT_TRUE(loaded.payloads_count() == dict.payloads_count());
+        for (const std::pair<const string_type, std::string_view>& p : expected) {
+            ASSERT_TRUE(loaded.find(p.first, payload));
+            EXPECT_TRUE(payload == p.second);
+        }
+    }
+
+    // The damaged heap is rejected.
+    {
+        std::fstream heap(path + ".payloads", std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+        heap.seekp(-1, std::ios::end);
+        heap.put('x');
+    }
+    payload_type damaged;
+    EXPECT_FALSE(damaged.load(path));
+    EXPECT_FALSE(damaged.map(path));
+    EXPECT_TRUE(damaged.empty());
+
+    // The heap whose offsets do not cover its bytes is rejected, although
+    // its checksums are valid.
+    {
+        const uint64_t offsets[] = {0, verb.size() - 1};
+        wstux::wd::details::payload_header header = {};
+        header.magic = wstux::wd::details::payload_header::magic_value;
+        header.version = wstux::wd::details::payload_header::version_value;
+        header.count = 1;
+        header.bytes = verb.size();
+        header.data_crc = wstux::wd::details::crc32c(verb.data(), verb.size(),
+                                                      wstux::wd::details::crc32c(offsets, sizeof(offsets)));
+        header.header_crc = wstux::wd::details::crc32c(&header, offsetof(wstux::wd::details::payload_header, header_crc));
+
+        std::ofstream heap(path + ".payloads", std::ios::binary | std::ios::trunc);
+        heap.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        heap.write(reinterpret_cast<const char*>(offsets), sizeof(offsets));
+        heap.write(verb.data(), verb.size());
+    }
+    wstux::wd::details::payload_heap uncovered;
+    EXPECT_FALSE(uncovered.load(path + ".payloads"));
+    EXPECT_FALSE(uncovered.map(path + ".payloads"));
+    std::remove(path.c_str());
+    std::remove((path + ".payloads").c_str());
+
+    // Keys without payloads are rejected.
+    builder_type mixed;
+    ASSERT_TRUE(mixed.insert_payload(U(char_type, "bugaga"), noun));
+    ASSERT_TRUE(mixed.insert(U(char_type, "bugor"), 1));
+    EXPECT_FALSE(mixed.build(dict));
+    EXPECT_TRUE(dict.empty());
+
+    // The rejected build resets the builder.
+    ASSERT_TRUE(mixed.insert_payload(U(char_type, "bugor"), verb));
+    ASSERT_TRUE(mixed.build(dict));
+    EXPECT_TRUE(dict.payloads_count() == 1) << dict.payloads_count();
+    EXPECT_TRUE(dict.find(U(char_type, "bugor"), payload) && (payload == verb));
+    EXPECT_FALSE(dict.find(U(char_type, "bugaga"), payload));
+}
+
+TYPED_TEST(wd_fixture, warm_up)
+{
+    using char_type = TypeParam;
+    using string_type = std::basic_string<char_type>;
+
+    string_type str = U(char_type, "bugaga");
+
+    wstux::wd::builder<char_type> builder;
+    typename wstux::wd::builder<char_type>::profile_type profile;
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(builder.insert(str, i));
+        if ((i % 10) == 0) {
+            profile[str] = i;
+        }
+        str += 'a' + (i % 26);
+    }
+
+    wstux::wd::word_dict<char_type> dict;
+    ASSERT_TRUE(builder.build(dict, profile));
+    EXPECT_TRUE(dict.hot_size() > 0);
+    EXPECT_TRUE(dict.hot_size() <= dict.size()) << dict.hot_size() << " > " << dict.size();
+
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("ut_word_dict_warm_" + std::to_string(sizeof(char_type)) + ".wd")).string();
+    ASSERT_TRUE(dict.save(path));
+
+    const bool populate[] = {false, true};
+    for (const bool is_populate : populate) {
+        wstux::wd::word_dict<char_type> mapped;
+        ASSERT_TRUE(mapped.map(path, wstux::wd::page_policy::regular, is_populate));
+        EXPECT_TRUE(mapped.is_mapped());
+        EXPECT_TRUE(mapped.hot_size() == dict.hot_size()) << mapped.hot_size() << " != " << dict.hot_size();
+
+        wstux::wd::dict_warmer<char_type> warmer(mapped);
+        EXPECT_TRUE(warmer.start());
+        EXPECT_FALSE(warmer.start());
+        warmer.wait();
+        EXPECT_TRUE(warmer.is_hot_ready());
+        EXPECT_TRUE(warmer.is_ready());
+        EXPECT_TRUE(warmer.progress() == 1.0) << warmer.progress();
+        EXPECT_FALSE(warmer.start());
+
+        str = U(char_type, "bugaga");
+        for (size_t i = 0; i < 1000; ++i) {
+            ASSERT_TRUE((size_t)mapped.find(str) == i) << i;
+            str += 'a' + (i % 26);
+        }
+    }
+
+    // Bit-packed values are prefaulted too.
+    wstux::wd::builder<char_type> packed_builder(wstux::wd::value_coding::packed);
+    str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(packed_builder.insert(str, i * 1000));
+        str += 'a' + (i % 26);
+    }
+    ASSERT_TRUE(packed_builder.build(dict));
+    ASSERT_TRUE(dict.is_values_packed());
+    ASSERT_TRUE(dict.save(path));
+    wstux::wd::word_dict<char_type> mapped;
+    ASSERT_TRUE(mapped.map(path));
+    EXPECT_TRUE(mapped.values_size() == dict.values_size()) << mapped.values_size() << " != " << dict.values_size();
+    EXPECT_TRUE(mapped.values_size() > 0);
+
+    wstux::wd::dict_warmer<char_type> warmer(mapped);
+    EXPECT_TRUE(warmer.start());
+    warmer.wait();
+    EXPECT_TRUE(warmer.is_ready());
+    EXPECT_TRUE(warmer.progress() == 1.0) << warmer.progress();
+    str = U(char_type, "bugaga");
+    for (size_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE((size_t)mapped.find(str) == i * 1000) << i;
+        str += 'a' + (i % 26);
+    }
+
+    std::remove(path.c_str());
+}
+
 int main(int /*argc*/, char** /*argv*/)
 {
     return RUN_ALL_TESTS();